@@ -0,0 +1,107 @@
+#include "restclient-cpp/restclient.h"
+#include "forked_server.h"
+#include <benchmark/benchmark.h>
+#include <sys/resource.h>
+#include <condition_variable>
+#include <mutex>
+
+// CPU time per request of the asynchronous engine at increasing fan-out.
+// With the epoll/socket_action loop the cost per request should stay flat
+// from 100 to 10,000 concurrent transfers.
+
+namespace
+{
+  ForkedServer<LocalServer>& Server()
+  {
+    static ForkedServer<LocalServer> server;
+    return server;
+  }
+
+  double ProcessCpuSeconds()
+  {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+  }
+
+  class CompletionLatch : public RestClientCompletionCallback
+  {
+   public:
+    explicit CompletionLatch(int count) : remaining(count), failed(0)
+    {
+    }
+
+    virtual void OnComplete(RestClient::Response& response)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (response.code != 200)
+        failed++;
+      if (--remaining == 0)
+        done.notify_one();
+    }
+
+    int Wait()
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      done.wait(lock, [this] { return remaining == 0; });
+      return failed;
+    }
+
+   private:
+    std::mutex              mutex;
+    std::condition_variable done;
+    int                     remaining;
+    int                     failed;
+  };
+
+  // client and server sockets for 10k transfers exceed the default limit
+  struct RaiseFileLimit
+  {
+    RaiseFileLimit()
+    {
+      struct rlimit limit;
+      getrlimit(RLIMIT_NOFILE, &limit);
+      limit.rlim_cur = limit.rlim_max;
+      setrlimit(RLIMIT_NOFILE, &limit);
+    }
+  } raiseFileLimit;
+}
+
+static void BM_AsyncConcurrentGets(benchmark::State& state)
+{
+  const int           concurrency = static_cast<int>(state.range(0));
+  RestClient::Request request;
+  double              cpuSeconds  = 0;
+  long                failed      = 0;
+
+  request.url = Server().Url("/");
+
+  // keep a handle per transfer and open the connections before measuring
+  RestClient::PoolSettings settings;
+  settings.maxIdleHandles = concurrency;
+  RestClient::SetPoolSettings(settings);
+  {
+    CompletionLatch warmup(concurrency);
+    for (int i = 0; i < concurrency; i++)
+      RestClient::GetAsync(request, &warmup);
+    warmup.Wait();
+  }
+
+  for (auto _ : state)
+  {
+    CompletionLatch latch(concurrency);
+    double          before = ProcessCpuSeconds();
+
+    for (int i = 0; i < concurrency; i++)
+      RestClient::GetAsync(request, &latch);
+
+    failed     += latch.Wait();
+    cpuSeconds += ProcessCpuSeconds() - before;
+  }
+
+  state.SetItemsProcessed(state.iterations() * concurrency);
+  state.counters["cpu_us_per_request"] = cpuSeconds * 1e6 / (state.iterations() * concurrency);
+  state.counters["failed"]             = static_cast<double>(failed);
+}
+BENCHMARK(BM_AsyncConcurrentGets)->Arg(100)->Arg(1000)->Arg(10000)->UseRealTime()->Unit(benchmark::kMillisecond);
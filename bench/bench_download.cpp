@@ -0,0 +1,102 @@
+#include "restclient-cpp/restclient.h"
+#include "forked_server.h"
+#include <benchmark/benchmark.h>
+#include <sys/resource.h>
+#include <fstream>
+#include <string>
+
+// Throughput and client CPU per GB of a large download written to a file,
+// through std::ofstream as Get(request, outputFile, callback) does and
+// through the preallocated, memory-mapped RestClientMappedFileSink. The
+// unsized variant has no Content-Length and takes the buffered pwrite path.
+
+namespace
+{
+  const unsigned long long kDownloadSize = 256ull * 1024 * 1024;
+
+  class DownloadServer : public LocalServer
+  {
+   protected:
+    virtual void Handle(const Request& request, Response& response)
+    {
+      response.generatedSize  = kDownloadSize;
+      response.closeDelimited = request.path == "/unsized";
+    }
+  };
+
+  ForkedServer<DownloadServer>& Server()
+  {
+    static ForkedServer<DownloadServer> server;
+    return server;
+  }
+
+  double ProcessCpuSeconds()
+  {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+  }
+
+  const char* DownloadPath()
+  {
+    return "/tmp/restclient-bench-download";
+  }
+
+  void Report(benchmark::State& state, double cpuSeconds, long failed)
+  {
+    double gigabytes = static_cast<double>(state.iterations()) * kDownloadSize / 1e9;
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * kDownloadSize));
+    state.counters["cpu_s_per_GB"] = cpuSeconds / gigabytes;
+    state.counters["failed"]       = static_cast<double>(failed);
+  }
+}
+
+static void BM_DownloadStream(benchmark::State& state)
+{
+  RestClient::Request request;
+  double              cpuSeconds = 0;
+  long                failed     = 0;
+
+  request.url = Server().Url("/");
+
+  for (auto _ : state)
+  {
+    double before = ProcessCpuSeconds();
+    {
+      std::ofstream file(DownloadPath(), std::ios::binary | std::ios::trunc);
+      if (RestClient::Get(request, &file, NULL).code != 200)
+        failed++;
+    }
+    cpuSeconds += ProcessCpuSeconds() - before;
+  }
+
+  Report(state, cpuSeconds, failed);
+  unlink(DownloadPath());
+}
+BENCHMARK(BM_DownloadStream)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_DownloadMapped(benchmark::State& state)
+{
+  RestClient::Request request;
+  double              cpuSeconds = 0;
+  long                failed     = 0;
+
+  request.url = Server().Url(state.range(0) ? "/" : "/unsized");
+
+  for (auto _ : state)
+  {
+    double before = ProcessCpuSeconds();
+    {
+      RestClientMappedFileSink sink(DownloadPath());
+      if (RestClient::Get(request, &sink).code != 200)
+        failed++;
+    }
+    cpuSeconds += ProcessCpuSeconds() - before;
+  }
+
+  Report(state, cpuSeconds, failed);
+  unlink(DownloadPath());
+}
+BENCHMARK(BM_DownloadMapped)->ArgName("sized")->Arg(1)->Arg(0)->UseRealTime()->Unit(benchmark::kMillisecond);
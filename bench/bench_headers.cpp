@@ -0,0 +1,162 @@
+#include "restclient-cpp/headers.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <vector>
+
+// Header handling cost per response for a realistic 30 header block, as
+// the header callback sees it: one line at a time. Eager parsing indexes
+// every line as it arrives, lazy parsing only copies the block and pays
+// for the index on the first lookup.
+
+namespace
+{
+  const std::vector<std::string>& ResponseLines()
+  {
+    static std::vector<std::string> lines;
+    if (lines.empty())
+    {
+      lines.push_back("Date: Mon, 12 Oct 2026 09:14:07 GMT\r\n");
+      lines.push_back("Content-Type: application/json; charset=utf-8\r\n");
+      lines.push_back("Content-Length: 1834\r\n");
+      lines.push_back("Connection: keep-alive\r\n");
+      lines.push_back("Server: nginx/1.25.3\r\n");
+      lines.push_back("Cache-Control: private, max-age=0, must-revalidate\r\n");
+      lines.push_back("ETag: W/\"72a-18f3c9d2b40\"\r\n");
+      lines.push_back("Last-Modified: Sun, 11 Oct 2026 22:41:19 GMT\r\n");
+      lines.push_back("Vary: Accept-Encoding, Origin\r\n");
+      lines.push_back("Set-Cookie: session=4f2a9c81d7e3; Path=/; HttpOnly; Secure\r\n");
+      lines.push_back("Set-Cookie: region=eu-west-1; Path=/; Max-Age=3600\r\n");
+      lines.push_back("Strict-Transport-Security: max-age=31536000; includeSubDomains\r\n");
+      lines.push_back("X-Content-Type-Options: nosniff\r\n");
+      lines.push_back("X-Frame-Options: DENY\r\n");
+      lines.push_back("X-XSS-Protection: 0\r\n");
+      lines.push_back("Referrer-Policy: strict-origin-when-cross-origin\r\n");
+      lines.push_back("Content-Security-Policy: default-src 'self'; frame-ancestors 'none'\r\n");
+      lines.push_back("Access-Control-Allow-Origin: https://app.example.com\r\n");
+      lines.push_back("Access-Control-Allow-Credentials: true\r\n");
+      lines.push_back("Access-Control-Expose-Headers: X-Request-Id, X-RateLimit-Remaining\r\n");
+      lines.push_back("X-Request-Id: 6d1f0b52-8c3e-4a7b-9e21-d04c5a7f3b18\r\n");
+      lines.push_back("X-RateLimit-Limit: 5000\r\n");
+      lines.push_back("X-RateLimit-Remaining: 4987\r\n");
+      lines.push_back("X-RateLimit-Reset: 1791796447\r\n");
+      lines.push_back("Via: 1.1 varnish\r\n");
+      lines.push_back("X-Cache: MISS\r\n");
+      lines.push_back("X-Served-By: cache-fra-eddf8230123\r\n");
+      lines.push_back("Age: 0\r\n");
+      lines.push_back("Accept-Ranges: bytes\r\n");
+      lines.push_back("Alt-Svc: h3=\":443\"; ma=86400\r\n");
+    }
+    return lines;
+  }
+
+  bool IsNotSpace(char c)
+  {
+    return !std::isspace(static_cast<unsigned char>(c));
+  }
+
+  // the copy, find and trim the header callback did before the tokenizer
+  void LegacySplit(const std::string& line, std::string& key, std::string& value)
+  {
+    size_t separator = line.find_first_of(":");
+    key = line.substr(0, separator);
+    value = line.substr(separator + 1);
+    key.erase(std::find_if(key.rbegin(), key.rend(), IsNotSpace).base(), key.end());
+    key.erase(key.begin(), std::find_if(key.begin(), key.end(), IsNotSpace));
+    value.erase(std::find_if(value.rbegin(), value.rend(), IsNotSpace).base(), value.end());
+    value.erase(value.begin(), std::find_if(value.begin(), value.end(), IsNotSpace));
+  }
+
+  void Receive(RestClientHeaders& headers, const std::vector<std::string>& lines)
+  {
+    headers.Clear();
+    for (size_t i = 0; i < lines.size(); i++)
+      headers.Add(lines[i].data(), lines[i].size());
+  }
+}
+
+// state.range(0): 1 for lazy parsing, state.range(1): 1 to look one header up
+static void BM_ResponseHeaders(benchmark::State& state)
+{
+  const std::vector<std::string>& lines = ResponseLines();
+  bool lookup = state.range(1) != 0;
+  RestClientHeaders::Field field;
+
+  for (auto _ : state)
+  {
+    RestClientHeaders headers;
+    headers.SetLazy(state.range(0) != 0);
+    Receive(headers, lines);
+    if (lookup)
+    {
+      bool found = headers.Find(RestClientHeaders::kContentType, field);
+      benchmark::DoNotOptimize(found);
+    }
+    benchmark::DoNotOptimize(headers);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ResponseHeaders)
+    ->ArgNames({"lazy", "lookup"})
+    ->Args({0, 0})
+    ->Args({1, 0})
+    ->Args({0, 1})
+    ->Args({1, 1});
+
+// Splitting the 30 lines into trimmed name and value. Real lines carry a
+// byte or two of whitespace, padded lines show the vector trimming.
+// state.range(0): RestClientHeaders::Isa, skipped where the CPU lacks it
+// state.range(1): extra whitespace around every value
+static void BM_TokenizeLines(benchmark::State& state)
+{
+  std::vector<std::string> lines = ResponseLines();
+  RestClientHeaders::Isa isa = static_cast<RestClientHeaders::Isa>(state.range(0));
+  RestClientHeaders::Field field;
+
+  for (size_t i = 0; i < lines.size(); i++)
+  {
+    size_t colon = lines[i].find(':');
+    lines[i].insert(colon + 1, std::string(state.range(1), ' '));
+    lines[i].insert(lines[i].size() - 2, std::string(state.range(1), '\t'));
+  }
+
+  if (isa > RestClientHeaders::BestIsa())
+  {
+    state.SkipWithError("instruction set not supported");
+    return;
+  }
+
+  for (auto _ : state)
+  {
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+      bool found = RestClientHeaders::Tokenize(lines[i].data(), lines[i].size(), field, isa);
+      benchmark::DoNotOptimize(found);
+      benchmark::DoNotOptimize(field);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * lines.size());
+}
+BENCHMARK(BM_TokenizeLines)
+    ->ArgNames({"isa", "padding"})
+    ->ArgsProduct({{RestClientHeaders::kScalar, RestClientHeaders::kSSE2, RestClientHeaders::kAVX2}, {0, 128}});
+
+static void BM_TokenizeLinesLegacy(benchmark::State& state)
+{
+  const std::vector<std::string>& lines = ResponseLines();
+  std::string key;
+  std::string value;
+
+  for (auto _ : state)
+  {
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+      LegacySplit(lines[i], key, value);
+      benchmark::DoNotOptimize(key);
+      benchmark::DoNotOptimize(value);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * lines.size());
+}
+BENCHMARK(BM_TokenizeLinesLegacy);
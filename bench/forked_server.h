@@ -0,0 +1,71 @@
+/**
+ * @file forked_server.h
+ * @brief runs a LocalServer in a child process for benchmarks
+ */
+
+#ifndef BENCH_FORKED_SERVER_H_
+#define BENCH_FORKED_SERVER_H_
+
+#include "local_server.h"
+
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <string>
+
+/**
+ * Keeps the server's CPU time out of the benchmark process, so process CPU
+ * measurements only account for the client. Fork before the client starts
+ * any threads.
+ */
+template<class Server>
+class ForkedServer
+{
+ public:
+    ForkedServer() : pid(-1), port(0)
+    {
+      int fds[2];
+
+      if (pipe(fds) != 0)
+        return;
+
+      pid = fork();
+      if (pid == 0)
+      {
+        Server server;
+        close(fds[0]);
+        server.Start();
+        port = server.Port();
+        if (write(fds[1], &port, sizeof(port)) != sizeof(port))
+          _exit(1);
+        pause();
+        _exit(0);
+      }
+
+      close(fds[1]);
+      if (read(fds[0], &port, sizeof(port)) != sizeof(port))
+        port = 0;
+      close(fds[0]);
+    }
+
+    ~ForkedServer()
+    {
+      if (pid > 0)
+      {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+      }
+    }
+
+    std::string Url(const std::string& path) const
+    {
+      return "http://127.0.0.1:" + std::to_string(port) + path;
+    }
+
+ private:
+    pid_t pid;
+    int   port;
+};
+
+#endif  // BENCH_FORKED_SERVER_H_
@@ -0,0 +1,66 @@
+/**
+ * @file bodyfile.h
+ * @brief response bodies kept on disk
+ */
+
+#ifndef INCLUDE_BODYFILE_H_
+#define INCLUDE_BODYFILE_H_
+
+#include <cstddef>
+#include <string>
+
+/**
+ * A response body that outgrew BodySettings::spillThreshold. It lives in a
+ * temporary file that is unlinked right away, so nothing is left behind
+ * if the process dies, and is closed with the last response referring to
+ * it. Copies share the file.
+ *
+ * Read copies from any offset, Map maps the whole file once and keeps the
+ * view until the file is closed. Both may run from several threads, but
+ * not while the transfer writing the body still appends to it.
+ */
+class RestClientBodyFile
+{
+public:
+    RestClientBodyFile();
+    RestClientBodyFile( const RestClientBodyFile& other );
+    RestClientBodyFile& operator=( const RestClientBodyFile& other );
+    ~RestClientBodyFile();
+
+#if __cplusplus >= 201103L
+    // inline, the library itself may be built without C++11
+    RestClientBodyFile( RestClientBodyFile&& other ) noexcept : state( other.state )
+    {
+        other.state = NULL;
+    }
+
+    RestClientBodyFile& operator=( RestClientBodyFile&& other ) noexcept
+    {
+        if( this != &other )
+        {
+            Reset();
+            swap( other );
+        }
+
+        return *this;
+    }
+#endif
+
+    bool Create( const std::string& directory );
+    bool Append( const char* data, size_t length );
+    void Reset();
+    void swap( RestClientBodyFile& other );
+
+    bool        Open() const;
+    int         Fd() const;
+    size_t      Size() const;
+    size_t      Read( size_t offset, char* buffer, size_t length ) const;
+    const char* Map() const;
+
+private:
+    struct State;
+
+    State* state;  // shared by copies, NULL while no file is open
+};
+
+#endif  // INCLUDE_BODYFILE_H_
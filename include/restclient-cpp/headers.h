@@ -0,0 +1,163 @@
+/**
+ * @file headers.h
+ * @brief flat storage for response headers
+ */
+
+#ifndef INCLUDE_HEADERS_H_
+#define INCLUDE_HEADERS_H_
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Response headers kept as the raw lines in one buffer plus a vector of
+ * offsets into it, so a response with a few dozen headers costs a handful
+ * of allocations instead of several per header. Lookups are case
+ * insensitive and go through an index sorted by name.
+ *
+ * Every occurrence of a header is kept in arrival order, repeated headers
+ * such as Set-Cookie are walked with ValueRange. Clear keeps the buffers
+ * for the next response of a redirect chain.
+ *
+ * Lines are split by Tokenize, which finds the colon and strips the
+ * whitespace around name and value with SSE2 or AVX2 when the CPU has
+ * them. Whitespace is what isspace accepts in the C locale.
+ *
+ * Well-known names are classified through a perfect hash as they arrive,
+ * Find( Known, Field& ) then reads them without comparing strings.
+ *
+ * In lazy mode Add only appends the line and the block is indexed on the
+ * first lookup, so responses whose headers are never read skip the
+ * parsing. That lookup writes to the index, concurrent readers of the
+ * same lazy headers need a lock until it happened once.
+ *
+ * The lower case members mirror the std::map this replaces.
+ */
+class RestClientHeaders
+{
+public:
+    /** a header as pointers into the buffer, valid until the headers change */
+    typedef struct Field_s
+    {
+        const char* name;
+        size_t      nameLength;
+        const char* value;
+        size_t      valueLength;
+    } Field;
+
+    /** well-known headers, classified once when they arrive */
+    typedef enum
+    {
+        kAcceptRanges,
+        kAge,
+        kCacheControl,
+        kConnection,
+        kContentEncoding,
+        kContentLength,
+        kContentRange,
+        kContentType,
+        kDate,
+        kETag,
+        kExpires,
+        kKeepAlive,
+        kLastModified,
+        kLocation,
+        kRetryAfter,
+        kServer,
+        kSetCookie,
+        kTransferEncoding,
+        kVary,
+        kWWWAuthenticate,
+        kUnknown
+    } Known;
+
+    /** instruction sets of the line tokenizer */
+    typedef enum
+    {
+        kScalar,
+        kSSE2,
+        kAVX2
+    } Isa;
+
+    /** every header of one name in arrival order */
+    class ValueRange
+    {
+    public:
+        ValueRange();
+
+        bool   Next( Field& field );
+        size_t Size() const;
+
+    private:
+        friend class RestClientHeaders;
+
+        const RestClientHeaders* headers;
+        size_t                   position;
+        size_t                   last;
+    };
+
+    RestClientHeaders();
+
+    static Known       Classify( const char* name, size_t nameLength );
+    static const char* Name( Known known );
+
+    // line tokenizer, vectorized where the CPU allows
+    static Isa    BestIsa();
+    static bool   Tokenize     ( const char* line, size_t length, Field& field );
+    static bool   Tokenize     ( const char* line, size_t length, Field& field, Isa isa );
+    static size_t LeadingSpace ( const char* data, size_t length );
+    static size_t LeadingSpace ( const char* data, size_t length, Isa isa );
+    static size_t TrailingSpace( const char* data, size_t length );
+    static size_t TrailingSpace( const char* data, size_t length, Isa isa );
+
+    void Add( const char* line, size_t length );
+    void Clear();
+    void SetLazy( bool lazy );
+    bool Lazy() const;
+
+    size_t Size() const;
+    Field  At( size_t index ) const;
+
+    bool        Find ( const char* name, size_t nameLength, Field& field ) const;
+    bool        Find ( Known known, Field& field ) const;
+    bool        Has  ( const std::string& name ) const;
+    std::string Value( const std::string& name ) const;
+    size_t      Count( const std::string& name ) const;
+    ValueRange  Values( const char* name, size_t nameLength ) const;
+    ValueRange  Values( const std::string& name ) const;
+
+    // std::map compatibility
+    std::string operator[]( const std::string& name ) const;
+    size_t      count( const std::string& name ) const;
+    size_t      size() const;
+    bool        empty() const;
+    void        swap( RestClientHeaders& other );
+
+    std::map<std::string, std::string> ToMap() const;
+    operator std::map<std::string, std::string>() const;
+
+private:
+    typedef struct Entry_s
+    {
+        unsigned int nameOffset;
+        unsigned int nameLength;
+        unsigned int valueOffset;
+        unsigned int valueLength;
+    } Entry;
+
+    void Parse() const;
+    void Index( size_t offset, size_t length ) const;
+    int  Compare( const Entry& entry, const char* name, size_t nameLength ) const;
+    bool Lookup ( const char* name, size_t nameLength, size_t& first, size_t& last ) const;
+
+    std::string                 raw;              // header lines as received
+    bool                        lazy;
+    mutable size_t              parsed;           // bytes of raw already indexed
+    mutable std::vector<Entry>  entries;          // in arrival order
+    mutable std::vector<size_t> sorted;           // entries by name, arrival order among equal names
+    mutable size_t              known[kUnknown];  // last entry of each well-known header plus one, 0 if absent
+};
+
+#endif  // INCLUDE_HEADERS_H_
@@ -12,10 +12,20 @@
 #include <curl/curl.h>
 #include <string>
 #include <map>
+#include <vector>
 #include <cstdlib>
 #include "meta.h"
+#include "headers.h"
+#include "bodyfile.h"
 #include <algorithm>
 #include <fstream>
+#if __cplusplus >= 201103L
+#include <future>
+#include <initializer_list>
+#endif
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 
 class RestClientTransferCallback
 {
@@ -26,6 +36,13 @@ public:
     virtual int UpdateTransferInfo( long dltotal, long dlnow, long ultotal, long ulnow ) = 0;
 };
 
+class RestClientCompletionCallback;
+class RestClientBatchCallback;
+class RestClientBodySink;
+class RestClientPreparedRequest;
+class RestClientSession;
+class RestClientHandlePool;
+
 class RestClient
 {
   public:
@@ -33,27 +50,106 @@ class RestClient
      * public data definitions
      */
     typedef std::map<std::string, std::string> headermap;
+
+    /** caps on what a transfer may receive, 0 for no limit */
+    typedef struct Limits_s
+    {
+        size_t maxBodyBytes;    // body of the final response, wherever it goes
+        size_t maxHeaderBytes;  // headers of every response of the transfer, redirects and 1xx included
+
+        Limits_s() : maxBodyBytes( 0 ), maxHeaderBytes( 0 )
+        {}
+    } Limits;
     
     typedef struct Request_s
     {
         headermap   headers;
         std::string url;
+        Limits      limits;  // fields left at 0 take the limit of the session
     } Request;
 
+    /** Response::code of transfers that did not complete */
+    typedef enum
+    {
+        kFailed          = -1,  // body "Failed to query."
+        kBodyTooLarge    = -2,  // body passed Limits::maxBodyBytes
+        kHeadersTooLarge = -3,  // headers passed Limits::maxHeaderBytes
+        kOverBudget      = -4   // bodies in memory passed BodySettings::bufferBudget
+    } ErrorCode;
+
     typedef struct _Internal Internal;
     
     /** response struct for queries */
     typedef struct Response_s
     {
-        int           code;
-        std::string   body;
-        headermap     headers;
-        std::ostream* file;
-        CURL*         curl;
-        struct curl_slist* headerChunk;
+        int                 code;
+        std::string         body;
+        RestClientHeaders   headers;
+        std::ostream*       file;        // stream passed to Get, written through a RestClientStreamSink
+        RestClientBodyFile  bodyFile;    // holds the body instead once it outgrew BodySettings::spillThreshold
 
-        Response_s() : code( 0 ), body( "" ), headers(), file( NULL ), curl( NULL ), headerChunk( NULL )
+        Response_s() : code( 0 ), body( "" ), headers(), file( NULL ), bodyFile()
         {}
+
+        // hands the body buffer back to the pool when one is configured
+        ~Response_s()
+        {
+            RestClient::ReleaseBody( body );
+        }
+
+        /** @brief bytes in the body, wherever it is kept */
+        size_t BodySize() const
+        {
+            return bodyFile.Open() ? bodyFile.Size() : body.size();
+        }
+
+        /**
+         * @brief copy part of the body, wherever it is kept
+         *
+         * @return bytes copied, 0 at or past the end
+         */
+        size_t ReadBody( size_t offset, char* buffer, size_t length ) const
+        {
+            if( bodyFile.Open() )
+                return bodyFile.Read( offset, buffer, length );
+
+            return offset < body.size() ? body.copy( buffer, length, offset ) : 0;
+        }
+
+        /** @brief the whole body in memory or mapped from its file, NULL if it cannot be mapped */
+        const char* BodyData() const
+        {
+            return bodyFile.Open() ? bodyFile.Map() : body.data();
+        }
+
+#if __cplusplus >= 201703L
+        /** @brief the body without a copy, valid while the response lives unchanged */
+        std::string_view BodyView() const
+        {
+            if( bodyFile.Open() )
+                return bodyFile.Map() != NULL ? std::string_view( bodyFile.Map(), bodyFile.Size() ) : std::string_view();
+
+            return body;
+        }
+#endif
+
+#if __cplusplus >= 201103L
+        // move-only, the buffers written by libcurl are handed over and never copied
+        Response_s( Response_s&& ) = default;
+        Response_s& operator=( Response_s&& ) = default;
+        Response_s( const Response_s& ) = delete;
+        Response_s& operator=( const Response_s& ) = delete;
+#endif
+
+        /** @brief exchange buffers with another response, the C++98 way to move one */
+        void swap( Response_s& other )
+        {
+            std::swap( code, other.code );
+            std::swap( file, other.file );
+            body.swap( other.body );
+            headers.swap( other.headers );
+            bodyFile.swap( other.bodyFile );
+        }
     } Response;
     
     /** */
@@ -68,6 +164,19 @@ class RestClient
         std::string value;
         FormType    type;
     } FormItem;
+
+    /** request header borrowed from the caller, neither part needs a terminating NUL */
+    typedef RestClientHeaders::Field HeaderField;
+
+    /** form item borrowed from the caller, neither part needs a terminating NUL */
+    typedef struct FormField_s
+    {
+        const char* name;
+        size_t      nameLength;
+        const char* value;
+        size_t      valueLength;
+        FormType    type;
+    } FormField;
     
     /** struct used for uploading data */
     typedef struct
@@ -76,20 +185,245 @@ class RestClient
         size_t      length;
     } UploadObject;
 
+    /** easy handle pool tuning */
+    typedef struct PoolSettings_s
+    {
+        size_t maxIdleHandles;  // handles kept for reuse, 0 disables pooling
+        long   idleTimeout;     // seconds an idle handle is kept, 0 keeps it forever
+        size_t threadCacheOrigins;  // origins each thread keeps a handle for in the static methods, 0 disables the cache
+
+        PoolSettings_s() : maxIdleHandles( 16 ), idleTimeout( 60 ), threadCacheOrigins( 4 )
+        {}
+    } PoolSettings;
+
+    /** easy handle pool counters */
+    typedef struct PoolStatistics_s
+    {
+        unsigned long handlesCreated;
+        unsigned long handlesReused;
+        unsigned long handlesEvicted;
+        unsigned long idleHandles;
+        unsigned long connectionsOpened;
+        unsigned long connectionsReused;  // transfers that did not open a new connection
+
+        PoolStatistics_s() : handlesCreated( 0 ), handlesReused( 0 ), handlesEvicted( 0 ), idleHandles( 0 ), connectionsOpened( 0 ), connectionsReused( 0 )
+        {}
+    } PoolStatistics;
+
+    /** caches shared by all easy handles in the process */
+    typedef struct ShareSettings_s
+    {
+        bool dns;
+        bool sslSessions;
+        bool connections;  // libcurl does not support using shared connections from concurrent threads
+
+        ShareSettings_s() : dns( true ), sslSessions( true ), connections( false )
+        {}
+    } ShareSettings;
+
+    /** options for running a batch of requests */
+    typedef struct BatchOptions_s
+    {
+        size_t                   maxParallel;  // transfers in flight at once, 0 runs all at once
+        RestClientBatchCallback* callback;     // streams completions as they arrive
+
+        BatchOptions_s() : maxParallel( 16 ), callback( NULL )
+        {}
+    } BatchOptions;
+
+    /** opt-in HTTP/2 multiplexing */
+    typedef struct Http2Settings_s
+    {
+        bool enabled;
+        bool priorKnowledge;        // speak HTTP/2 on plain http:// URLs without upgrade
+        long maxConcurrentStreams;  // streams multiplexed over one connection
+
+        Http2Settings_s() : enabled( false ), priorKnowledge( false ), maxConcurrentStreams( 100 )
+        {}
+    } Http2Settings;
+
+    /** trust for https:// peers */
+    typedef struct TlsSettings_s
+    {
+        std::string caFile;  // PEM bundle of trusted certificates, empty for the system store
+
+        TlsSettings_s() : caFile()
+        {}
+    } TlsSettings;
+
+    /** streams carried by one connection of the async engine */
+    typedef struct ConnectionStatistics_s
+    {
+        std::string   remote;  // address:port of the peer
+        long          localPort;
+        unsigned long streams;
+        unsigned long activeStreams;
+        unsigned long peakStreams;  // a finished stream counts until the engine reaps it
+
+        ConnectionStatistics_s() : remote(), localPort( 0 ), streams( 0 ), activeStreams( 0 ), peakStreams( 0 )
+        {}
+    } ConnectionStatistics;
+
+    /**
+     * per host limits of the request scheduler, 0 for no limit. Limits hold
+     * for requests started after SetSchedulerSettings returns, requests
+     * already running when the first limit is set are not counted against it.
+     */
+    typedef struct SchedulerSettings_s
+    {
+        long maxInFlightPerHost;     // requests running against one scheme://host:port
+        long maxConnectionsPerHost;  // connections open to one scheme://host:port
+        long maxInFlight;            // requests running in total
+
+        SchedulerSettings_s() : maxInFlightPerHost( 0 ), maxConnectionsPerHost( 0 ), maxInFlight( 0 )
+        {}
+    } SchedulerSettings;
+
+    /**
+     * queueing seen by one scheme://host:port. Asynchronous requests are
+     * always counted. Blocking requests bypass the scheduler while no limit
+     * is set and only show up in dispatched and inFlight while one is.
+     */
+    typedef struct HostStatistics_s
+    {
+        std::string   host;
+        unsigned long inFlight;
+        unsigned long queued;        // requests waiting right now
+        unsigned long peakQueued;
+        unsigned long dispatched;
+        double        totalWait;     // seconds spent queued by all dispatched requests
+        double        maxWait;
+
+        HostStatistics_s() : host(), inFlight( 0 ), queued( 0 ), peakQueued( 0 ), dispatched( 0 ), totalWait( 0 ), maxWait( 0 )
+        {}
+    } HostStatistics;
+
+    /** handling of bodies kept in Response::body */
+    typedef struct BodySettings_s
+    {
+        size_t      reserveLimit;    // largest Content-Length reserved up front, 0 never reserves
+        size_t      spillThreshold;  // bodies growing past it move to Response::bodyFile, 0 keeps them in memory
+        std::string spillDirectory;  // for the body files, empty for $TMPDIR or /tmp
+        size_t      bufferBudget;    // bytes the bodies of all running transfers may hold in memory together, 0 for no limit
+
+        BodySettings_s() : reserveLimit( 64 * 1024 * 1024 ), spillThreshold( 0 ), spillDirectory(), bufferBudget( 0 )
+        {}
+    } BodySettings;
+
+    /** recycling of response body buffers, set before threads send requests */
+    typedef struct BodyPoolSettings_s
+    {
+        size_t maxBytes;       // capacity kept in all free lists together, 0 disables the pool
+        size_t maxBufferSize;  // larger bodies allocate and free as usual
+        size_t threadBuffers;  // buffers per size class a thread keeps for itself
+
+        BodyPoolSettings_s() : maxBytes( 0 ), maxBufferSize( 8 * 1024 * 1024 ), threadBuffers( 2 )
+        {}
+    } BodyPoolSettings;
+
+    /** body buffer pool counters */
+    typedef struct BodyPoolStatistics_s
+    {
+        unsigned long hits;         // bodies that got a recycled buffer
+        unsigned long misses;       // bodies that allocated a buffer of their class
+        unsigned long recycled;     // buffers taken back from destroyed responses
+        unsigned long dropped;      // buffers freed because the pool was at its cap
+        size_t        pooledBytes;  // capacity waiting in the free lists
+
+        BodyPoolStatistics_s() : hits( 0 ), misses( 0 ), recycled( 0 ), dropped( 0 ), pooledBytes( 0 )
+        {}
+    } BodyPoolStatistics;
+
+    /** splitting of Download into concurrent range requests */
+    typedef struct DownloadOptions_s
+    {
+        size_t segments;        // range requests in flight at once, 1 downloads in one stream
+        size_t minSegmentSize;  // objects are not split into shorter ranges
+        bool   resumable;       // keep finished ranges in path.resume and continue from them on the next call
+
+        DownloadOptions_s() : segments( 4 ), minSegmentSize( 4 * 1024 * 1024 ), resumable( false )
+        {}
+    } DownloadOptions;
+
+    /** handling of Response::headers */
+    typedef struct HeaderSettings_s
+    {
+        bool lazy;  // keep the raw header block and parse it on the first lookup
+
+        HeaderSettings_s() : lazy( false )
+        {}
+    } HeaderSettings;
+
     //
-    static void Init();
-    static void CleanUp();
+    static bool Init();
+    static bool Init( const ShareSettings& share );
+    static bool CleanUp();
 
-    // Auth
+    // Handle pool
+    static void           SetPoolSettings( const PoolSettings& settings );
+    static PoolStatistics GetPoolStatistics();
+
+    // Response bodies
+    static void               SetBodySettings( const BodySettings& settings );
+    static void               SetBodyPoolSettings( const BodyPoolSettings& settings );
+    static BodyPoolStatistics GetBodyPoolStatistics();
+    static size_t             GetBufferedBytes();
+
+    // Response headers
+    static void SetHeaderSettings( const HeaderSettings& settings );
+
+    // Scheduler
+    static void                        SetSchedulerSettings( const SchedulerSettings& settings );
+    static std::vector<HostStatistics> GetHostStatistics();
+
+    // HTTP/2
+    static void                              SetHttp2Settings( const Http2Settings& settings );
+    static std::vector<ConnectionStatistics> GetConnectionStatistics();
+
+    // TLS
+    static void SetTlsSettings( const TlsSettings& settings );
+
+    // Auth and limits of the default session, set them before other threads send requests
     static void ClearAuth();
     static void SetAuth( const std::string& username, const std::string& password );
+    static void SetLimits( const Limits& limits );
     
     // HTTP GET
     static Response Get( const Request& request );
     static Response Get( const Request& request, const std::ostream* outputFile, const RestClientTransferCallback* info );
+    static Response Get( const Request& request, RestClientBodySink* sink );
     
     static Response Post( const Request& request, const std::map<std::string, FormItem>& form );
 
+    // Download to a file, in concurrent byte ranges where the server allows it
+    static Response Download( const Request& request, const std::string& path, const DownloadOptions& options, const RestClientTransferCallback* info );
+
+    // Asynchronous requests, the callback runs on the I/O thread
+    static bool GetAsync ( const Request& request, RestClientCompletionCallback* callback );
+    static bool GetAsync ( const Request& request, RestClientBodySink* sink, RestClientCompletionCallback* callback );
+    static bool PostAsync( const Request& request, const std::map<std::string, FormItem>& form, RestClientCompletionCallback* callback );
+#if __cplusplus >= 201103L
+    static std::future<Response> GetAsync ( const Request& request );
+    static std::future<Response> PostAsync( const Request& request, const std::map<std::string, FormItem>& form );
+#endif
+
+    // Borrowed buffers, only read during the call and never copied into strings
+    static Response Get     ( const char* url, size_t urlLength, const HeaderField* headers, size_t headerCount );
+    static Response Post    ( const char* url, size_t urlLength, const HeaderField* headers, size_t headerCount, const FormField* form, size_t formCount );
+    static bool     GetAsync( const char* url, size_t urlLength, const HeaderField* headers, size_t headerCount, RestClientCompletionCallback* callback );
+#if __cplusplus >= 201703L
+    static HeaderField Header( std::string_view name, std::string_view value );
+    static FormField   Form  ( std::string_view name, std::string_view value, FormType type = kString );
+
+    static Response Get     ( std::string_view url, std::initializer_list<HeaderField> headers = {} );
+    static Response Post    ( std::string_view url, std::initializer_list<HeaderField> headers, std::initializer_list<FormField> form );
+    static bool     GetAsync( std::string_view url, std::initializer_list<HeaderField> headers, RestClientCompletionCallback* callback );
+#endif
+
+    // Batch of GET requests run concurrently, responses in request order
+    static std::vector<Response> Perform( const std::vector<Request>& requests );
+    static std::vector<Response> Perform( const std::vector<Request>& requests, const BatchOptions& options );
+
 //    // HTTP PUT
 //    static response put(const std::string& url, const std::string& ctype,
 //                        const std::string& data);
@@ -97,28 +431,62 @@ class RestClient
 //    static response del(const std::string& url);
 
   private:
-    static bool CurlSharedEasyInit   ( const Request& request, Response& response );
-    static bool CurlSharedEasyCleanUp( Response& response );
+    friend class RestClientPreparedRequest;
+    friend class RestClientSession;
+
+    class Exchange;
+    class Transfer;
+
+    static bool     CurlSharedEasyInit    ( const RestClientSession& session, const Request& request, bool blocking, Exchange& exchange );
+    static bool     CurlSharedEasyInit    ( const RestClientSession& session, const char* url, const HeaderField* headers, size_t headerCount, bool blocking, Exchange& exchange );
+    static bool     CurlSharedEasyInit    ( const RestClientSession& session, const char* url, bool sessionUserAgent, bool blocking, Exchange& exchange );
+    static bool     CurlSharedEasyInit    ( RestClientHandlePool& pool, const char* url, const struct curl_slist* headerList, const char* userAgent, const std::string& userPassword, Exchange& exchange );
+    static CURLcode CurlSharedEasyPerform ( const char* url, Exchange& exchange );
+    static void     CurlSharedEasyComplete( CURLcode curlResponse, Exchange& exchange );
+    static bool     CurlSharedEasyCleanUp ( Exchange& exchange );
+    static void     SubmitTransfer        ( Transfer* transfer, const char* url );
+
+    static Response CurlSharedGet ( const RestClientSession& session, const Request& request, RestClientBodySink* sink, const RestClientTransferCallback* info );
+    static void     CurlSharedGet ( const char* url, RestClientBodySink* sink, const RestClientTransferCallback* info, Exchange& exchange );
+    static void     CurlSharedPost( const char* url, struct curl_httppost* formPost, Exchange& exchange );
+    static Response CurlSharedHead( const RestClientSession& session, const Request& request );
+    static Response CurlSharedDownload( const RestClientSession& session, const Request& request, const std::string& path, const DownloadOptions& options, const RestClientTransferCallback* info );
+    static bool     CurlSharedAsync( const char* url, struct curl_httppost* formPost, RestClientBodySink* sink, Transfer* transfer );
+
+    static struct curl_slist* CurlHeaderList( const headermap& defaults, const headermap& headers );
+    static struct curl_slist* CurlHeaderList( const headermap& defaults, const HeaderField* headers, size_t headerCount );
+
+    static struct curl_httppost* CurlFormBuild( const std::map<std::string, FormItem>& form );
+    static struct curl_httppost* CurlFormBuild( const FormField* form, size_t formCount );
     
     static size_t CurlTransferCallback( void *p, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow );
     static size_t CurlWriteCallback   ( void *ptr, size_t size, size_t nmemb, void *userdata );
     static size_t CurlHeaderCallback  ( void *ptr, size_t size, size_t nmemb, void *userdata );
     static size_t CurlReadCallback    ( void *ptr, size_t size, size_t nmemb, void *userdata );
 
+    static void ReserveBody ( Exchange& exchange );
+    static bool ChargeBudget( Exchange& exchange, size_t size );
+    static void RefundBudget( Exchange& exchange );
+    static bool SpillBody   ( Exchange& exchange );
+    static void ReleaseBody( std::string& body );
+
     static const char* kDefaultUserAgent;
-    static std::string UserPassword;
+    static Http2Settings Http2;
+    static TlsSettings   Tls;
+    static BodySettings  Body;
+    static HeaderSettings Headers;
     
     // trim from start
     static inline std::string &ltrim( std::string &s )
     {
-        s.erase(s.begin(), std::find_if(s.begin(), s.end(), std::not1(std::ptr_fun<int, int>(std::isspace))));
+        s.erase( 0, RestClientHeaders::LeadingSpace( s.data(), s.size() ) );
         return s;
     }
 
     // trim from end
     static inline std::string &rtrim( std::string &s )
     {
-        s.erase( std::find_if(s.rbegin(), s.rend(), std::not1( std::ptr_fun<int, int>( std::isspace ) ) ).base(), s.end() );
+        s.erase( s.size() - RestClientHeaders::TrailingSpace( s.data(), s.size() ) );
         return s;
     }
 
@@ -129,4 +497,363 @@ class RestClient
     }
 };
 
+class RestClientCompletionCallback
+{
+public:
+    virtual ~RestClientCompletionCallback()
+    {};
+
+    virtual void OnComplete( RestClient::Response& response ) = 0;
+};
+
+class RestClientBatchCallback
+{
+public:
+    virtual ~RestClientBatchCallback()
+    {};
+
+    // runs on the thread calling Perform, index refers to the request vector
+    virtual void OnResponse( size_t index, RestClient::Response& response ) = 0;
+};
+
+/**
+ * Receives a response body as it arrives. OnHeaders runs once the status
+ * line and headers of a response are in and decides whether its body goes
+ * to the sink or stays in Response::body. Returning false from OnData
+ * aborts the transfer. OnComplete runs when the transfer is over, whether
+ * it succeeded or not.
+ */
+class RestClientBodySink
+{
+public:
+    virtual ~RestClientBodySink()
+    {};
+
+    virtual bool OnHeaders( const RestClient::Response& /* response */ )
+    {
+        return true;
+    }
+
+    virtual bool OnData( const char* data, size_t length ) = 0;
+
+    virtual void OnComplete( const RestClient::Response& /* response */ )
+    {}
+};
+
+/** appends the body to a string */
+class RestClientStringSink : public RestClientBodySink
+{
+public:
+    explicit RestClientStringSink( std::string& target );
+
+    virtual bool OnData( const char* data, size_t length );
+
+private:
+    std::string& target;
+};
+
+/** writes 2xx bodies to a stream, other bodies stay in Response::body */
+class RestClientStreamSink : public RestClientBodySink
+{
+public:
+    explicit RestClientStreamSink( std::ostream& stream );
+
+    virtual bool OnHeaders ( const RestClient::Response& response );
+    virtual bool OnData    ( const char* data, size_t length );
+    virtual void OnComplete( const RestClient::Response& response );
+
+private:
+    std::ostream& stream;
+};
+
+/** writes 2xx bodies to a file descriptor, other bodies stay in Response::body */
+class RestClientFdSink : public RestClientBodySink
+{
+public:
+    explicit RestClientFdSink( int fd );
+
+    virtual bool OnHeaders( const RestClient::Response& response );
+    virtual bool OnData   ( const char* data, size_t length );
+
+private:
+    int fd;
+};
+
+/**
+ * Writes 2xx bodies to a file, other bodies stay in Response::body. A body
+ * announcing its Content-Length is preallocated with posix_fallocate and
+ * copied straight into a shared mapping of the file. Bodies of unknown
+ * length, or whose space could not be reserved, are collected in a buffer
+ * and written with pwrite. The file ends up at the size received.
+ */
+class RestClientMappedFileSink : public RestClientBodySink
+{
+public:
+    explicit RestClientMappedFileSink( const std::string& path );
+    ~RestClientMappedFileSink();
+
+    virtual bool OnHeaders ( const RestClient::Response& response );
+    virtual bool OnData    ( const char* data, size_t length );
+    virtual void OnComplete( const RestClient::Response& response );
+
+    bool   Mapped() const;   // the last body went through the mapping
+    size_t Written() const;  // bytes of the last body in the file
+
+private:
+    RestClientMappedFileSink( const RestClientMappedFileSink& );
+    RestClientMappedFileSink& operator=( const RestClientMappedFileSink& );
+
+    bool Flush();
+    void Close();
+
+    std::string path;
+    int         fd;
+    char*       map;        // NULL unless the length was known and reserved
+    size_t      mapLength;
+    size_t      written;    // bytes placed in the file or the buffer
+    size_t      flushed;    // bytes of the file written with pwrite
+    std::string pending;    // not yet written with pwrite
+    bool        failed;     // no space for the announced length
+};
+
+/** hands the body to a plain function, which returns false to abort */
+class RestClientCallbackSink : public RestClientBodySink
+{
+public:
+    typedef bool ( *DataFunction )( const char* data, size_t length, void* userdata );
+
+    RestClientCallbackSink( DataFunction function, void* userdata );
+
+    virtual bool OnData( const char* data, size_t length );
+
+private:
+    DataFunction function;
+    void*        userdata;
+};
+
+/**
+ * Client state for one service: credentials, user agent, default headers
+ * and a pool of easy handles with their warm connections. The static
+ * RestClient methods use a default session, sessions of their own let
+ * threads or services keep separate credentials and connection pools.
+ *
+ * Setters are not synchronized. Configure a session before sharing it, or
+ * give each thread its own; requests on a configured session may run from
+ * any number of threads. A session must outlive its asynchronous
+ * transfers and be destroyed before RestClient::CleanUp. The share,
+ * scheduler, HTTP/2, body and header settings stay process wide.
+ */
+class RestClientSession
+{
+public:
+    RestClientSession();
+    ~RestClientSession();
+
+    // Auth
+    void ClearAuth();
+    void SetAuth( const std::string& username, const std::string& password );
+
+    // Sent with every request, request headers of the same name win
+    void SetUserAgent( const std::string& userAgent );
+    void SetDefaultHeaders( const RestClient::headermap& headers );
+
+    // Limits of every request, request limits win where they are set
+    void SetLimits( const RestClient::Limits& limits );
+
+    // Handle pool
+    void                       SetPoolSettings( const RestClient::PoolSettings& settings );
+    RestClient::PoolStatistics GetPoolStatistics() const;
+
+    // HTTP GET
+    RestClient::Response Get( const RestClient::Request& request ) const;
+    RestClient::Response Get( const RestClient::Request& request, RestClientBodySink* sink ) const;
+
+    RestClient::Response Post( const RestClient::Request& request, const std::map<std::string, RestClient::FormItem>& form ) const;
+
+    // Download to a file, in concurrent byte ranges where the server allows it
+    RestClient::Response Download( const RestClient::Request& request, const std::string& path, const RestClient::DownloadOptions& options, const RestClientTransferCallback* info ) const;
+
+    // Asynchronous requests, the callback runs on the I/O thread
+    bool GetAsync ( const RestClient::Request& request, RestClientCompletionCallback* callback ) const;
+    bool GetAsync ( const RestClient::Request& request, RestClientBodySink* sink, RestClientCompletionCallback* callback ) const;
+    bool PostAsync( const RestClient::Request& request, const std::map<std::string, RestClient::FormItem>& form, RestClientCompletionCallback* callback ) const;
+
+    // Borrowed buffers, only read during the call and never copied into strings
+    RestClient::Response Get     ( const char* url, size_t urlLength, const RestClient::HeaderField* headers, size_t headerCount ) const;
+    RestClient::Response Post    ( const char* url, size_t urlLength, const RestClient::HeaderField* headers, size_t headerCount, const RestClient::FormField* form, size_t formCount ) const;
+    bool                 GetAsync( const char* url, size_t urlLength, const RestClient::HeaderField* headers, size_t headerCount, RestClientCompletionCallback* callback ) const;
+#if __cplusplus >= 201703L
+    RestClient::Response Get     ( std::string_view url, std::initializer_list<RestClient::HeaderField> headers = {} ) const;
+    RestClient::Response Post    ( std::string_view url, std::initializer_list<RestClient::HeaderField> headers, std::initializer_list<RestClient::FormField> form ) const;
+    bool                 GetAsync( std::string_view url, std::initializer_list<RestClient::HeaderField> headers, RestClientCompletionCallback* callback ) const;
+#endif
+
+    // Batch of GET requests run concurrently, responses in request order
+    std::vector<RestClient::Response> Perform( const std::vector<RestClient::Request>& requests ) const;
+    std::vector<RestClient::Response> Perform( const std::vector<RestClient::Request>& requests, const RestClient::BatchOptions& options ) const;
+
+private:
+    friend class RestClient;
+    friend class RestClientPreparedRequest;
+
+    RestClientSession( const RestClientSession& );
+    RestClientSession& operator=( const RestClientSession& );
+
+    RestClientHandlePool* pool;
+    std::string           userPassword;
+    std::string           userAgent;
+    RestClient::headermap headers;
+    RestClient::Limits    limits;
+};
+
+/**
+ * A request whose headers, credentials and user agent are compiled once
+ * into a curl header list it owns, so it can be run any number of times
+ * with only the URL or the form changing and without building strings per
+ * call. Credentials, user agent and default headers of the session are
+ * captured when the request is prepared, its handles come from the
+ * session's pool.
+ *
+ * Running it from several threads at once is safe, the header list is only
+ * read. Asynchronous transfers keep using the header list, the prepared
+ * request and its session must outlive them.
+ */
+class RestClientPreparedRequest
+{
+public:
+    explicit RestClientPreparedRequest( const RestClient::Request& request );
+    RestClientPreparedRequest( const RestClientSession& session, const RestClient::Request& request );
+    ~RestClientPreparedRequest();
+
+    void               SetUrl( const std::string& url );
+    const std::string& Url() const;
+
+    RestClient::Response Get () const;
+    RestClient::Response Get ( const std::string& url ) const;
+    RestClient::Response Get ( const std::string& url, RestClientBodySink* sink ) const;
+    RestClient::Response Post( const std::map<std::string, RestClient::FormItem>& form ) const;
+    RestClient::Response Post( const std::string& url, const std::map<std::string, RestClient::FormItem>& form ) const;
+
+    // Asynchronous requests, the callback runs on the I/O thread
+    bool GetAsync ( RestClientCompletionCallback* callback ) const;
+    bool GetAsync ( const std::string& url, RestClientBodySink* sink, RestClientCompletionCallback* callback ) const;
+    bool PostAsync( const std::string& url, const std::map<std::string, RestClient::FormItem>& form, RestClientCompletionCallback* callback ) const;
+
+private:
+    RestClientPreparedRequest( const RestClientPreparedRequest& );
+    RestClientPreparedRequest& operator=( const RestClientPreparedRequest& );
+
+    void Compile( const RestClientSession& session, const RestClient::Request& request );
+
+    std::string           url;
+    RestClientHandlePool* pool;          // of the session
+    struct curl_slist*    headerList;    // NULL without headers
+    std::string           userAgent;     // empty if the headers carry one
+    std::string           userPassword;  // basic auth at the time of preparing
+    RestClient::Limits    limits;        // of the request over those of the session
+};
+
+#if __cplusplus >= 201103L
+/**
+ * completion callback fulfilling a promise, deletes itself once done
+ */
+class RestClientPromiseCallback : public RestClientCompletionCallback
+{
+public:
+    std::future<RestClient::Response> Future()
+    {
+        return promise.get_future();
+    }
+
+    virtual void OnComplete( RestClient::Response& response )
+    {
+        promise.set_value( std::move( response ) );
+        delete this;
+    }
+
+private:
+    std::promise<RestClient::Response> promise;
+};
+
+inline std::future<RestClient::Response> RestClient::GetAsync( const Request& request )
+{
+    RestClientPromiseCallback*        callback = new RestClientPromiseCallback();
+    std::future<RestClient::Response> future   = callback->Future();
+
+    if( !GetAsync( request, callback ) )
+    {
+        Response response;
+        response.body = "Failed to query.";
+        response.code = -1;
+
+        callback->OnComplete( response );
+    }
+
+    return future;
+}
+
+inline std::future<RestClient::Response> RestClient::PostAsync( const Request& request, const std::map<std::string, FormItem>& form )
+{
+    RestClientPromiseCallback*        callback = new RestClientPromiseCallback();
+    std::future<RestClient::Response> future   = callback->Future();
+
+    if( !PostAsync( request, form, callback ) )
+    {
+        Response response;
+        response.body = "Failed to query.";
+        response.code = -1;
+
+        callback->OnComplete( response );
+    }
+
+    return future;
+}
+#endif
+
+#if __cplusplus >= 201703L
+inline RestClient::HeaderField RestClient::Header( std::string_view name, std::string_view value )
+{
+    HeaderField field = { name.data(), name.size(), value.data(), value.size() };
+
+    return field;
+}
+
+inline RestClient::FormField RestClient::Form( std::string_view name, std::string_view value, FormType type )
+{
+    FormField field = { name.data(), name.size(), value.data(), value.size(), type };
+
+    return field;
+}
+
+inline RestClient::Response RestClient::Get( std::string_view url, std::initializer_list<HeaderField> headers )
+{
+    return Get( url.data(), url.size(), headers.begin(), headers.size() );
+}
+
+inline RestClient::Response RestClient::Post( std::string_view url, std::initializer_list<HeaderField> headers, std::initializer_list<FormField> form )
+{
+    return Post( url.data(), url.size(), headers.begin(), headers.size(), form.begin(), form.size() );
+}
+
+inline bool RestClient::GetAsync( std::string_view url, std::initializer_list<HeaderField> headers, RestClientCompletionCallback* callback )
+{
+    return GetAsync( url.data(), url.size(), headers.begin(), headers.size(), callback );
+}
+
+inline RestClient::Response RestClientSession::Get( std::string_view url, std::initializer_list<RestClient::HeaderField> headers ) const
+{
+    return Get( url.data(), url.size(), headers.begin(), headers.size() );
+}
+
+inline RestClient::Response RestClientSession::Post( std::string_view url, std::initializer_list<RestClient::HeaderField> headers, std::initializer_list<RestClient::FormField> form ) const
+{
+    return Post( url.data(), url.size(), headers.begin(), headers.size(), form.begin(), form.size() );
+}
+
+inline bool RestClientSession::GetAsync( std::string_view url, std::initializer_list<RestClient::HeaderField> headers, RestClientCompletionCallback* callback ) const
+{
+    return GetAsync( url.data(), url.size(), headers.begin(), headers.size(), callback );
+}
+#endif
+
 #endif  // INCLUDE_RESTCLIENT_H_
@@ -0,0 +1,237 @@
+/**
+ * @file bodyfile.cpp
+ * @brief implementation of response bodies kept on disk
+ */
+
+/*========================
+         INCLUDES
+  ========================*/
+#include "bodyfile.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+struct RestClientBodyFile::State
+{
+    int    fd;
+    size_t size;
+    long   references;  // updated atomically
+    void*  map;         // whole file, published once with a compare and swap
+
+    State() : fd( -1 ), size( 0 ), references( 1 ), map( NULL )
+    {}
+};
+
+RestClientBodyFile::RestClientBodyFile() : state( NULL )
+{
+}
+
+RestClientBodyFile::RestClientBodyFile( const RestClientBodyFile& other ) : state( other.state )
+{
+    if( state != NULL )
+        __sync_fetch_and_add( &state->references, 1 );
+}
+
+RestClientBodyFile& RestClientBodyFile::operator=( const RestClientBodyFile& other )
+{
+    RestClientBodyFile copy( other );
+
+    swap( copy );
+
+    return *this;
+}
+
+RestClientBodyFile::~RestClientBodyFile()
+{
+    Reset();
+}
+
+/**
+ * @brief open an empty, already unlinked file for the body
+ *
+ * Uses O_TMPFILE where the kernel and file system have it, so the file
+ * never shows up in the directory, and an unlinked mkstemp file otherwise.
+ *
+ * @param directory for the file, empty for $TMPDIR or /tmp
+ *
+ * @return false if no file could be created
+ */
+bool RestClientBodyFile::Create( const std::string& directory )
+{
+    std::string path = directory;
+    int         fd   = -1;
+
+    Reset();
+
+    if( path.empty() )
+    {
+        const char* tmpdir = getenv( "TMPDIR" );
+
+        path = ( tmpdir != NULL && *tmpdir != '\0' ) ? tmpdir : "/tmp";
+    }
+
+#ifdef O_TMPFILE
+    fd = open( path.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600 );
+#endif
+
+    if( fd < 0 )
+    {
+        std::string name = path + "/restclient-body-XXXXXX";
+
+        fd = mkstemp( &name[0] );
+
+        if( fd < 0 )
+            return false;
+
+        unlink( name.c_str() );
+        fcntl( fd, F_SETFD, FD_CLOEXEC );
+    }
+
+    state     = new State();
+    state->fd = fd;
+
+    return true;
+}
+
+/**
+ * @brief write more of the body at the end of the file
+ *
+ * @return false if the file could not take all of it
+ */
+bool RestClientBodyFile::Append( const char* data, size_t length )
+{
+    if( state == NULL )
+        return false;
+
+    while( length > 0 )
+    {
+        ssize_t written = write( state->fd, data, length );
+
+        if( written < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+
+            return false;
+        }
+
+        data        += written;
+        length      -= written;
+        state->size += written;
+    }
+
+    return true;
+}
+
+/**
+ * @brief let go of the file, the last copy closes it
+ */
+void RestClientBodyFile::Reset()
+{
+    if( state == NULL )
+        return;
+
+    if( __sync_sub_and_fetch( &state->references, 1 ) == 0 )
+    {
+        if( state->map != NULL )
+            munmap( state->map, state->size );
+
+        close( state->fd );
+
+        delete state;
+    }
+
+    state = NULL;
+}
+
+void RestClientBodyFile::swap( RestClientBodyFile& other )
+{
+    State* mine = state;
+
+    state       = other.state;
+    other.state = mine;
+}
+
+bool RestClientBodyFile::Open() const
+{
+    return state != NULL;
+}
+
+int RestClientBodyFile::Fd() const
+{
+    return state != NULL ? state->fd : -1;
+}
+
+size_t RestClientBodyFile::Size() const
+{
+    return state != NULL ? state->size : 0;
+}
+
+/**
+ * @brief copy part of the body
+ *
+ * @param offset into the body
+ * @param buffer receiving up to length bytes
+ *
+ * @return bytes copied, 0 at or past the end
+ */
+size_t RestClientBodyFile::Read( size_t offset, char* buffer, size_t length ) const
+{
+    size_t copied = 0;
+
+    if( state == NULL || offset >= state->size )
+        return 0;
+
+    if( length > state->size - offset )
+        length = state->size - offset;
+
+    while( copied < length )
+    {
+        ssize_t count = pread( state->fd, buffer + copied, length - copied, offset + copied );
+
+        if( count < 0 && errno == EINTR )
+            continue;
+
+        if( count <= 0 )
+            break;
+
+        copied += count;
+    }
+
+    return copied;
+}
+
+/**
+ * @brief the whole body mapped read only
+ *
+ * The first call maps the file, later calls and copies get the same view.
+ *
+ * @return start of the body, NULL for an empty body or if mapping failed
+ */
+const char* RestClientBodyFile::Map() const
+{
+    if( state == NULL || state->size == 0 )
+        return NULL;
+
+    if( state->map != NULL )
+        return static_cast<const char*>( state->map );
+
+    void* map = mmap( NULL, state->size, PROT_READ, MAP_SHARED, state->fd, 0 );
+
+    if( map == MAP_FAILED )
+        return NULL;
+
+    void* previous = __sync_val_compare_and_swap( &state->map, static_cast<void*>( NULL ), map );
+
+    // a thread mapping at the same time won
+    if( previous != NULL )
+    {
+        munmap( map, state->size );
+        return static_cast<const char*>( previous );
+    }
+
+    return static_cast<const char*>( map );
+}
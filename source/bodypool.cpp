@@ -0,0 +1,360 @@
+/**
+ * @file bodypool.cpp
+ * @brief implementation of the response body buffer pool
+ */
+
+/*========================
+         INCLUDES
+  ========================*/
+#include "bodypool.h"
+
+// set once the pool is gone, responses destroyed later free their body
+static bool PoolClosed = false;
+
+RestClientBodyPool::RestClientBodyPool() : key(), mutex(), locals(), settings(), pooledBytes( 0 ), hits( 0 ), misses( 0 ), recycled( 0 ), dropped( 0 )
+{
+    pthread_key_create( &key, RestClientBodyPool::ThreadExit );
+}
+
+RestClientBodyPool::~RestClientBodyPool()
+{
+    std::vector<Local*> remaining;
+
+    PoolClosed = true;
+
+    mutex.Lock();
+
+    remaining.assign( locals.begin(), locals.end() );
+    locals.clear();
+
+    mutex.Unlock();
+
+    pthread_key_delete( key );
+
+    for( size_t i = 0; i < remaining.size(); i++ )
+        delete remaining[i];
+}
+
+/**
+ * @brief whether the pool was destroyed during static destruction
+ */
+bool RestClientBodyPool::Closed()
+{
+    return PoolClosed;
+}
+
+bool RestClientBodyPool::Enabled() const
+{
+    return settings.maxBytes > 0;
+}
+
+/**
+ * @brief give an empty body a buffer of at least size bytes
+ *
+ * Takes a recycled buffer of the size class if the calling thread or the
+ * shared list has one, allocates the full class size otherwise so the
+ * buffer fits its class once it comes back.
+ *
+ * @param size bytes the body is expected to hold
+ * @param body to receive the buffer, must be empty
+ */
+void RestClientBodyPool::Acquire( size_t size, std::string& body )
+{
+    size_t index = 0;
+
+    if( size > settings.maxBufferSize || !ClassOf( size, true, index ) )
+    {
+        body.reserve( size );
+        return;
+    }
+
+    Local* local = ThreadLocal( false );
+    bool   found = false;
+
+    if( local != NULL && !local->lists[index].empty() )
+    {
+        body.swap( local->lists[index].back() );
+        local->lists[index].pop_back();
+        found = true;
+    }
+    else
+    {
+        RestClientScopedLock lock( mutex );
+
+        if( !lists[index].empty() )
+        {
+            body.swap( lists[index].back() );
+            lists[index].pop_back();
+            found = true;
+        }
+    }
+
+    if( found )
+    {
+        __sync_fetch_and_sub( &pooledBytes, body.capacity() );
+        __sync_fetch_and_add( &hits, 1 );
+        return;
+    }
+
+    __sync_fetch_and_add( &misses, 1 );
+
+    body.reserve( static_cast<size_t>( 1 ) << ( index + kMinClassBits ) );
+}
+
+/**
+ * @brief keep the buffer of a body that is going away
+ *
+ * The buffer goes to the calling thread's list for its class, to the shared
+ * list once that is full, and is left to the body to free if the pool is
+ * at its cap. Runs from the Response destructor and does not throw.
+ *
+ * @param body whose buffer to take, empty afterwards
+ */
+void RestClientBodyPool::Release( std::string& body )
+{
+    size_t capacity = body.capacity();
+    size_t index    = 0;
+
+    if( !Enabled() )
+    {
+        Local* local = ThreadLocal( false );
+
+        // lists left from before the pool was disabled
+        if( local != NULL )
+            Drop( local );
+
+        return;
+    }
+
+    if( capacity > settings.maxBufferSize || !ClassOf( capacity, false, index ) )
+        return;
+
+    if( __sync_add_and_fetch( &pooledBytes, capacity ) > settings.maxBytes )
+    {
+        __sync_fetch_and_sub( &pooledBytes, capacity );
+        __sync_fetch_and_add( &dropped, 1 );
+        return;
+    }
+
+    body.clear();
+
+    try
+    {
+        Local* local = ThreadLocal( true );
+
+        if( local->lists[index].size() < settings.threadBuffers )
+        {
+            Push( local->lists[index], body );
+        }
+        else
+        {
+            RestClientScopedLock lock( mutex );
+
+            Push( lists[index], body );
+        }
+    }
+    catch( ... )
+    {
+        // no room for the list entry, the body frees its buffer as usual
+        __sync_fetch_and_sub( &pooledBytes, capacity );
+        __sync_fetch_and_add( &dropped, 1 );
+        return;
+    }
+
+    __sync_fetch_and_add( &recycled, 1 );
+}
+
+/**
+ * @brief free the buffers of every list
+ *
+ * Empties the lists of other threads too, like RestClient::CleanUp it must
+ * not run while requests are in flight.
+ */
+void RestClientBodyPool::Drain()
+{
+    RestClientScopedLock             lock( mutex );
+    std::set<Local*>::const_iterator iterator;
+    size_t                           freed = 0;
+
+    for( size_t i = 0; i < kClasses; i++ )
+    {
+        for( size_t j = 0; j < lists[i].size(); j++ )
+            freed += lists[i][j].capacity();
+
+        FreeList().swap( lists[i] );
+    }
+
+    for( iterator = locals.begin(); iterator != locals.end(); iterator++ )
+    {
+        for( size_t i = 0; i < kClasses; i++ )
+        {
+            for( size_t j = 0; j < ( *iterator )->lists[i].size(); j++ )
+                freed += ( *iterator )->lists[i][j].capacity();
+
+            FreeList().swap( ( *iterator )->lists[i] );
+        }
+    }
+
+    __sync_fetch_and_sub( &pooledBytes, freed );
+}
+
+/**
+ * @brief change the limits, disabling the pool frees the shared list
+ *
+ * Thread lists are freed by their threads as they release their next
+ * body. Set it before threads send requests.
+ */
+void RestClientBodyPool::Configure( const RestClient::BodyPoolSettings& newSettings )
+{
+    size_t freed = 0;
+
+    mutex.Lock();
+
+    settings = newSettings;
+
+    if( !Enabled() )
+    {
+        for( size_t i = 0; i < kClasses; i++ )
+        {
+            for( size_t j = 0; j < lists[i].size(); j++ )
+                freed += lists[i][j].capacity();
+
+            FreeList().swap( lists[i] );
+        }
+    }
+
+    mutex.Unlock();
+
+    __sync_fetch_and_sub( &pooledBytes, freed );
+}
+
+RestClient::BodyPoolStatistics RestClientBodyPool::Statistics()
+{
+    RestClient::BodyPoolStatistics statistics;
+
+    statistics.hits        = __sync_fetch_and_add( &hits, 0 );
+    statistics.misses      = __sync_fetch_and_add( &misses, 0 );
+    statistics.recycled    = __sync_fetch_and_add( &recycled, 0 );
+    statistics.dropped     = __sync_fetch_and_add( &dropped, 0 );
+    statistics.pooledBytes = __sync_fetch_and_add( &pooledBytes, 0 );
+
+    return statistics;
+}
+
+/**
+ * @brief free lists of the calling thread
+ *
+ * @param create register lists if the thread has none yet
+ */
+RestClientBodyPool::Local* RestClientBodyPool::ThreadLocal( bool create )
+{
+    Local* local = static_cast<Local*>( pthread_getspecific( key ) );
+
+    if( local != NULL || !create )
+        return local;
+
+    local        = new Local();
+    local->owner = this;
+
+    mutex.Lock();
+    locals.insert( local );
+    mutex.Unlock();
+
+    pthread_setspecific( key, local );
+
+    return local;
+}
+
+/**
+ * @brief free the buffers of one thread
+ */
+void RestClientBodyPool::Drop( Local* local )
+{
+    size_t freed = 0;
+
+    for( size_t i = 0; i < kClasses; i++ )
+    {
+        for( size_t j = 0; j < local->lists[i].size(); j++ )
+            freed += local->lists[i][j].capacity();
+
+        FreeList().swap( local->lists[i] );
+    }
+
+    if( freed > 0 )
+        __sync_fetch_and_sub( &pooledBytes, freed );
+}
+
+/**
+ * @brief append a buffer to a free list
+ *
+ * Before C++11 a growing vector copies its strings and the copies of empty
+ * strings drop their capacity, so the list grows by swapping them over.
+ */
+void RestClientBodyPool::Push( FreeList& list, std::string& body )
+{
+    if( list.size() == list.capacity() )
+    {
+        FreeList grown;
+
+        grown.reserve( list.empty() ? 4 : list.size() * 2 );
+        grown.resize( list.size() );
+
+        for( size_t i = 0; i < list.size(); i++ )
+            grown[i].swap( list[i] );
+
+        list.swap( grown );
+    }
+
+    list.push_back( std::string() );
+    list.back().swap( body );
+}
+
+/**
+ * @brief size class of a buffer
+ *
+ * @param size requested bytes, or the capacity of a returned buffer
+ * @param roundUp pick the class holding size rather than the one size holds
+ * @param index receiving the class
+ *
+ * @return false if no class fits
+ */
+bool RestClientBodyPool::ClassOf( size_t size, bool roundUp, size_t& index )
+{
+    const size_t minimum = static_cast<size_t>( 1 ) << kMinClassBits;
+    size_t       bits    = 0;
+
+    if( size < minimum )
+    {
+        if( !roundUp )
+            return false;
+
+        size = minimum;
+    }
+
+    while( ( size >> bits ) > 1 )
+        bits++;
+
+    if( roundUp && size > ( static_cast<size_t>( 1 ) << bits ) )
+        bits++;
+
+    if( bits - kMinClassBits >= kClasses )
+        return false;
+
+    index = bits - kMinClassBits;
+
+    return true;
+}
+
+void RestClientBodyPool::ThreadExit( void* data )
+{
+    Local*              local = static_cast<Local*>( data );
+    RestClientBodyPool* pool  = local->owner;
+
+    pool->mutex.Lock();
+    pool->locals.erase( local );
+    pool->mutex.Unlock();
+
+    pool->Drop( local );
+
+    delete local;
+}
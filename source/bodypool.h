@@ -0,0 +1,82 @@
+/**
+ * @file bodypool.h
+ * @brief recycled buffers for response bodies
+ */
+
+#ifndef SOURCE_BODYPOOL_H_
+#define SOURCE_BODYPOOL_H_
+
+#include <pthread.h>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "restclient.h"
+#include "threading.h"
+
+/**
+ * Keeps the buffers of destroyed response bodies for the next responses.
+ * Buffers are sorted into power of two size classes from 4 KiB up. Each
+ * thread keeps a few buffers per class for itself and reaches them without
+ * a lock, the rest go to a shared free list. The capacity kept in all lists
+ * together never exceeds BodyPoolSettings::maxBytes, buffers beyond it are
+ * freed.
+ *
+ * Buffers move as std::string swaps, a recycled body hands its capacity to
+ * the next one without copying or allocating.
+ */
+class RestClientBodyPool
+{
+public:
+    RestClientBodyPool();
+    ~RestClientBodyPool();
+
+    static bool Closed();
+
+    bool Enabled() const;
+    void Acquire( size_t size, std::string& body );
+    void Release( std::string& body );
+    void Drain();
+
+    void                                 Configure( const RestClient::BodyPoolSettings& settings );
+    RestClient::BodyPoolStatistics       Statistics();
+
+private:
+    RestClientBodyPool( const RestClientBodyPool& );
+    RestClientBodyPool& operator=( const RestClientBodyPool& );
+
+    static const size_t kMinClassBits = 12;
+    static const size_t kClasses      = 20;  // 4 KiB to 2 GiB
+
+    typedef std::vector<std::string> FreeList;
+
+    // touched by its own thread only, Drain aside
+    typedef struct Local_s
+    {
+        RestClientBodyPool* owner;
+        FreeList            lists[kClasses];
+
+        Local_s() : owner( NULL )
+        {}
+    } Local;
+
+    Local* ThreadLocal( bool create );
+    void   Drop( Local* local );
+
+    static void   Push   ( FreeList& list, std::string& body );
+    static bool   ClassOf( size_t size, bool roundUp, size_t& index );
+    static void   ThreadExit( void* local );
+
+    pthread_key_t                  key;
+    RestClientMutex                mutex;  // guards lists and locals, never taken on a thread local hit
+    FreeList                       lists[kClasses];
+    std::set<Local*>               locals;
+    RestClient::BodyPoolSettings   settings;
+    size_t                         pooledBytes;  // capacity in all free lists, updated atomically
+    unsigned long                  hits;
+    unsigned long                  misses;
+    unsigned long                  recycled;
+    unsigned long                  dropped;
+};
+
+#endif  // SOURCE_BODYPOOL_H_
@@ -0,0 +1,236 @@
+/**
+ * @file handlepool.cpp
+ * @brief implementation of the easy handle pool
+ */
+
+/*========================
+         INCLUDES
+  ========================*/
+#include "handlepool.h"
+#include "share.h"
+
+#include <time.h>
+
+RestClientHandlePool::RestClientHandlePool( RestClientShare& share ) : share( share ), mutex(), idle(), settings(), statistics()
+{
+    share.Register( this );
+}
+
+RestClientHandlePool::~RestClientHandlePool()
+{
+    share.Unregister( this );
+
+    Drain();
+}
+
+/**
+ * @brief hand out an idle handle or create a new one
+ *
+ * @return easy handle ready for configuration, NULL on failure
+ */
+CURL* RestClientHandlePool::Acquire()
+{
+    CURL*              handle = NULL;
+    std::vector<CURL*> expired;
+
+    mutex.Lock();
+
+    CollectExpired( Now(), expired );
+
+    if( idle.size() > 0 )
+    {
+        handle = idle.back().curl;
+        idle.pop_back();
+
+        statistics.handlesReused++;
+    }
+    else
+    {
+        statistics.handlesCreated++;
+    }
+
+    mutex.Unlock();
+
+    // closing connections can block, keep it outside the lock
+    CleanUpHandles( expired );
+
+    if( handle == NULL )
+    {
+        handle = curl_easy_init();
+
+        // once for its lifetime, the share survives curl_easy_reset
+        if( handle != NULL )
+            share.Attach( handle );
+    }
+
+    return handle;
+}
+
+/**
+ * @brief return a handle to the pool
+ *
+ * The handle is reset with curl_easy_reset which drops all options but
+ * keeps live connections, the DNS cache and TLS session ids.
+ *
+ * @param handle to return
+ * @param transferred true if a transfer completed on the handle
+ */
+void RestClientHandlePool::Release( CURL* handle, bool transferred )
+{
+    std::vector<CURL*> expired;
+    long               connects = 0;
+    long               now      = Now();
+
+    if( handle == NULL )
+        return;
+
+    if( transferred )
+        curl_easy_getinfo( handle, CURLINFO_NUM_CONNECTS, &connects );
+
+    curl_easy_reset( handle );
+
+    mutex.Lock();
+
+    if( transferred )
+    {
+        if( connects == 0 )
+            statistics.connectionsReused++;
+        else
+            statistics.connectionsOpened += connects;
+    }
+
+    CollectExpired( now, expired );
+
+    if( settings.maxIdleHandles > 0 )
+    {
+        IdleHandle entry;
+
+        // a full pool drops its least recently used handle, not the warm one coming back
+        if( idle.size() >= settings.maxIdleHandles )
+        {
+            expired.push_back( idle.front().curl );
+            idle.erase( idle.begin() );
+
+            statistics.handlesEvicted++;
+        }
+
+        entry.curl       = handle;
+        entry.releasedAt = now;
+
+        idle.push_back( entry );
+    }
+    else
+    {
+        expired.push_back( handle );
+
+        statistics.handlesEvicted++;
+    }
+
+    mutex.Unlock();
+
+    CleanUpHandles( expired );
+}
+
+/**
+ * @brief close all idle handles
+ */
+void RestClientHandlePool::Drain()
+{
+    std::vector<CURL*> handles;
+
+    mutex.Lock();
+
+    for( size_t i = 0; i < idle.size(); i++ )
+        handles.push_back( idle[i].curl );
+
+    idle.clear();
+
+    mutex.Unlock();
+
+    CleanUpHandles( handles );
+}
+
+void RestClientHandlePool::Configure( const RestClient::PoolSettings& newSettings )
+{
+    std::vector<CURL*> expired;
+
+    mutex.Lock();
+
+    settings = newSettings;
+
+    // shrink to the new size, dropping the least recently used handles
+    while( idle.size() > settings.maxIdleHandles )
+    {
+        expired.push_back( idle.front().curl );
+        idle.erase( idle.begin() );
+
+        statistics.handlesEvicted++;
+    }
+
+    mutex.Unlock();
+
+    CleanUpHandles( expired );
+}
+
+/**
+ * @brief counters, handles past the idle timeout are dropped first
+ */
+RestClient::PoolStatistics RestClientHandlePool::Statistics()
+{
+    std::vector<CURL*> expired;
+
+    mutex.Lock();
+
+    CollectExpired( Now(), expired );
+
+    RestClient::PoolStatistics result = statistics;
+    result.idleHandles                = idle.size();
+
+    mutex.Unlock();
+
+    CleanUpHandles( expired );
+
+    return result;
+}
+
+/**
+ * @brief move handles idle for longer than the timeout into expired
+ *
+ * Must be called with the mutex held. The idle list is ordered by release
+ * time, so expired handles are always at the front.
+ */
+void RestClientHandlePool::CollectExpired( long now, std::vector<CURL*>& expired )
+{
+    size_t count = 0;
+
+    if( settings.idleTimeout <= 0 )
+        return;
+
+    while( count < idle.size() && now - idle[count].releasedAt >= settings.idleTimeout )
+    {
+        expired.push_back( idle[count].curl );
+        count++;
+    }
+
+    if( count > 0 )
+    {
+        idle.erase( idle.begin(), idle.begin() + count );
+
+        statistics.handlesEvicted += count;
+    }
+}
+
+long RestClientHandlePool::Now()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return static_cast<long>( ts.tv_sec );
+}
+
+void RestClientHandlePool::CleanUpHandles( const std::vector<CURL*>& handles )
+{
+    for( size_t i = 0; i < handles.size(); i++ )
+        curl_easy_cleanup( handles[i] );
+}
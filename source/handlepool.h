@@ -0,0 +1,59 @@
+/**
+ * @file handlepool.h
+ * @brief pool of reusable libcurl easy handles
+ */
+
+#ifndef SOURCE_HANDLEPOOL_H_
+#define SOURCE_HANDLEPOOL_H_
+
+#include <curl/curl.h>
+#include <vector>
+
+#include "restclient.h"
+#include "threading.h"
+
+class RestClientShare;
+
+/**
+ * Keeps released easy handles around so their connection cache, DNS cache
+ * and TLS session ids survive between requests. Handles are handed out most
+ * recently used first, which keeps the warmest connections busy and lets the
+ * cold ones age out through the idle timeout. A full pool drops its least
+ * recently used handle to make room.
+ */
+class RestClientHandlePool
+{
+public:
+    explicit RestClientHandlePool( RestClientShare& share );
+    ~RestClientHandlePool();
+
+    CURL* Acquire();
+    void  Release( CURL* handle, bool transferred );
+    void  Drain();
+
+    void                       Configure( const RestClient::PoolSettings& settings );
+    RestClient::PoolStatistics Statistics();
+
+private:
+    RestClientHandlePool( const RestClientHandlePool& );
+    RestClientHandlePool& operator=( const RestClientHandlePool& );
+
+    typedef struct IdleHandle_s
+    {
+        CURL* curl;
+        long  releasedAt;
+    } IdleHandle;
+
+    void CollectExpired( long now, std::vector<CURL*>& expired );
+
+    static long Now();
+    static void CleanUpHandles( const std::vector<CURL*>& handles );
+
+    RestClientShare&           share;  // new handles are attached to it
+    RestClientMutex            mutex;
+    std::vector<IdleHandle>    idle;
+    RestClient::PoolSettings   settings;
+    RestClient::PoolStatistics statistics;
+};
+
+#endif  // SOURCE_HANDLEPOOL_H_
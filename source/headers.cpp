@@ -0,0 +1,521 @@
+/**
+ * @file headers.cpp
+ * @brief implementation of the flat response header storage
+ */
+
+/*========================
+         INCLUDES
+  ========================*/
+#include "headers.h"
+
+#include <cctype>
+#include <algorithm>
+#include <cstring>
+#include <strings.h>
+
+// room for a typical response before the buffers have to grow
+static const size_t kReservedBytes   = 1024;
+static const size_t kReservedEntries = 32;
+
+// spelling of every RestClientHeaders::Known
+static const char* const kKnownNames[RestClientHeaders::kUnknown] =
+{
+    "Accept-Ranges",
+    "Age",
+    "Cache-Control",
+    "Connection",
+    "Content-Encoding",
+    "Content-Length",
+    "Content-Range",
+    "Content-Type",
+    "Date",
+    "ETag",
+    "Expires",
+    "Keep-Alive",
+    "Last-Modified",
+    "Location",
+    "Retry-After",
+    "Server",
+    "Set-Cookie",
+    "Transfer-Encoding",
+    "Vary",
+    "WWW-Authenticate"
+};
+
+// slot of KnownHash for every well-known name, searched offline so that no
+// two names collide, keep it in sync with kKnownNames
+static const size_t kKnownSlots = 32;
+
+static const RestClientHeaders::Known kKnownBySlot[kKnownSlots] =
+{
+    RestClientHeaders::kLastModified,     // 0
+    RestClientHeaders::kDate,             // 1
+    RestClientHeaders::kServer,           // 2
+    RestClientHeaders::kExpires,          // 3
+    RestClientHeaders::kContentEncoding,  // 4
+    RestClientHeaders::kContentType,      // 5
+    RestClientHeaders::kContentRange,     // 6
+    RestClientHeaders::kAge,              // 7
+    RestClientHeaders::kUnknown,          // 8
+    RestClientHeaders::kUnknown,          // 9
+    RestClientHeaders::kWWWAuthenticate,  // 10
+    RestClientHeaders::kVary,             // 11
+    RestClientHeaders::kUnknown,          // 12
+    RestClientHeaders::kUnknown,          // 13
+    RestClientHeaders::kUnknown,          // 14
+    RestClientHeaders::kContentLength,    // 15
+    RestClientHeaders::kKeepAlive,        // 16
+    RestClientHeaders::kTransferEncoding, // 17
+    RestClientHeaders::kLocation,         // 18
+    RestClientHeaders::kUnknown,          // 19
+    RestClientHeaders::kUnknown,          // 20
+    RestClientHeaders::kUnknown,          // 21
+    RestClientHeaders::kUnknown,          // 22
+    RestClientHeaders::kUnknown,          // 23
+    RestClientHeaders::kCacheControl,     // 24
+    RestClientHeaders::kUnknown,          // 25
+    RestClientHeaders::kRetryAfter,       // 26
+    RestClientHeaders::kUnknown,          // 27
+    RestClientHeaders::kETag,             // 28
+    RestClientHeaders::kAcceptRanges,     // 29
+    RestClientHeaders::kSetCookie,        // 30
+    RestClientHeaders::kConnection        // 31
+};
+
+static inline unsigned int Lower( char c )
+{
+    return static_cast<unsigned int>( tolower( static_cast<unsigned char>( c ) ) );
+}
+
+/**
+ * @brief slot of a header name in kKnownBySlot
+ *
+ * Length plus first, middle and last character, all case insensitive.
+ */
+static inline size_t KnownHash( const char* name, size_t nameLength )
+{
+    return ( nameLength + 4 * Lower( name[0] ) + 5 * Lower( name[nameLength - 1] ) + Lower( name[nameLength / 2] ) ) % kKnownSlots;
+}
+
+RestClientHeaders::RestClientHeaders() : raw(), lazy( false ), parsed( 0 ), entries(), sorted()
+{
+    memset( known, 0, sizeof( known ) );
+}
+
+/**
+ * @brief well-known header a name stands for
+ *
+ * @param name header name, case insensitive
+ * @param nameLength of name
+ *
+ * @return its Known slot, kUnknown for every other name
+ */
+RestClientHeaders::Known RestClientHeaders::Classify( const char* name, size_t nameLength )
+{
+    if( nameLength == 0 )
+        return kUnknown;
+
+    Known candidate = kKnownBySlot[KnownHash( name, nameLength )];
+
+    if( candidate == kUnknown )
+        return kUnknown;
+
+    const char* knownName = kKnownNames[candidate];
+
+    // one comparison settles it, the hash has no collisions among known names
+    if( strlen( knownName ) != nameLength || strncasecmp( knownName, name, nameLength ) != 0 )
+        return kUnknown;
+
+    return candidate;
+}
+
+/**
+ * @brief canonical spelling of a well-known header, NULL for kUnknown
+ */
+const char* RestClientHeaders::Name( RestClientHeaders::Known known )
+{
+    if( known < 0 || known >= kUnknown )
+        return NULL;
+
+    return kKnownNames[known];
+}
+
+/**
+ * @brief store one header line as handed over by libcurl
+ *
+ * Name and value are trimmed, lines without a colon are ignored. In lazy
+ * mode the line is only appended and indexed on the first lookup.
+ *
+ * @param line header line including its line break
+ * @param length of the line
+ */
+void RestClientHeaders::Add( const char* line, size_t length )
+{
+    if( raw.empty() )
+        raw.reserve( kReservedBytes );
+
+    raw.append( line, length );
+
+    if( lazy )
+        return;
+
+    Index( parsed, length );
+    parsed = raw.size();
+}
+
+/**
+ * @brief index the lines appended since the last lookup
+ *
+ * Lines are found with memchr, which the C library scans a vector at a
+ * time.
+ */
+void RestClientHeaders::Parse() const
+{
+    const char* data = raw.data();
+
+    while( parsed < raw.size() )
+    {
+        const char* line  = data + parsed;
+        const char* end   = static_cast<const char*>( memchr( line, '\n', raw.size() - parsed ) );
+        size_t      length = ( end == NULL ) ? raw.size() - parsed : end - line + 1;
+
+        Index( parsed, length );
+        parsed += length;
+    }
+}
+
+/**
+ * @brief add the entry for the line at offset of raw
+ */
+void RestClientHeaders::Index( size_t offset, size_t length ) const
+{
+    const char* line = raw.data() + offset;
+    Field       field;
+
+    if( !Tokenize( line, length, field ) )
+        return;
+
+    if( entries.empty() )
+    {
+        entries.reserve( kReservedEntries );
+        sorted.reserve( kReservedEntries );
+    }
+
+    Entry entry;
+
+    entry.nameOffset  = static_cast<unsigned int>( field.name - raw.data() );
+    entry.nameLength  = static_cast<unsigned int>( field.nameLength );
+    entry.valueOffset = static_cast<unsigned int>( field.value - raw.data() );
+    entry.valueLength = static_cast<unsigned int>( field.valueLength );
+
+    entries.push_back( entry );
+
+    const char* name = raw.data() + entry.nameOffset;
+    Known       slot = Classify( name, entry.nameLength );
+
+    if( slot != kUnknown )
+        known[slot] = entries.size();
+
+    // insert behind every entry of the same name to keep arrival order
+    size_t position = sorted.size();
+
+    while( position > 0 && Compare( entries[sorted[position - 1]], name, entry.nameLength ) > 0 )
+        position--;
+
+    sorted.insert( sorted.begin() + position, entries.size() - 1 );
+}
+
+/**
+ * @brief forget every header but keep the buffers for the next response
+ */
+void RestClientHeaders::Clear()
+{
+    raw.clear();
+    entries.clear();
+    sorted.clear();
+    parsed = 0;
+
+    memset( known, 0, sizeof( known ) );
+}
+
+/**
+ * @brief switch lazy parsing, lines already stored stay as they are
+ */
+void RestClientHeaders::SetLazy( bool lazy )
+{
+    this->lazy = lazy;
+
+    if( !lazy )
+        Parse();
+}
+
+bool RestClientHeaders::Lazy() const
+{
+    return lazy;
+}
+
+size_t RestClientHeaders::Size() const
+{
+    Parse();
+
+    return entries.size();
+}
+
+/**
+ * @brief header by arrival order
+ */
+RestClientHeaders::Field RestClientHeaders::At( size_t index ) const
+{
+    Parse();
+
+    const Entry& entry = entries[index];
+    Field        field;
+
+    field.name        = raw.data() + entry.nameOffset;
+    field.nameLength  = entry.nameLength;
+    field.value       = raw.data() + entry.valueOffset;
+    field.valueLength = entry.valueLength;
+
+    return field;
+}
+
+/**
+ * @brief last header of a name without copying it
+ *
+ * @param name to look up, case insensitive
+ * @param nameLength of name
+ * @param field set to the header if found
+ *
+ * @return true if the header is present
+ */
+bool RestClientHeaders::Find( const char* name, size_t nameLength, RestClientHeaders::Field& field ) const
+{
+    size_t first = 0;
+    size_t last  = 0;
+
+    if( !Lookup( name, nameLength, first, last ) )
+        return false;
+
+    field = At( sorted[last - 1] );
+
+    return true;
+}
+
+/**
+ * @brief last header of a well-known name, without any string comparison
+ *
+ * @param known header to read
+ * @param field set to the header if found
+ *
+ * @return true if the header is present
+ */
+bool RestClientHeaders::Find( RestClientHeaders::Known known, RestClientHeaders::Field& field ) const
+{
+    if( known < 0 || known >= kUnknown )
+        return false;
+
+    Parse();
+
+    if( this->known[known] == 0 )
+        return false;
+
+    field = At( this->known[known] - 1 );
+
+    return true;
+}
+
+bool RestClientHeaders::Has( const std::string& name ) const
+{
+    size_t first = 0;
+    size_t last  = 0;
+
+    return Lookup( name.data(), name.size(), first, last );
+}
+
+/**
+ * @brief value of the last header of a name, empty if there is none
+ */
+std::string RestClientHeaders::Value( const std::string& name ) const
+{
+    Field field;
+
+    if( !Find( name.data(), name.size(), field ) )
+        return std::string();
+
+    return std::string( field.value, field.valueLength );
+}
+
+/**
+ * @brief number of headers of a name
+ */
+size_t RestClientHeaders::Count( const std::string& name ) const
+{
+    size_t first = 0;
+    size_t last  = 0;
+
+    Lookup( name.data(), name.size(), first, last );
+
+    return last - first;
+}
+
+/**
+ * @brief every header of a name without copying them
+ *
+ * @param name to look up, case insensitive
+ * @param nameLength of name
+ *
+ * @return range to walk with Next, valid until the headers change
+ */
+RestClientHeaders::ValueRange RestClientHeaders::Values( const char* name, size_t nameLength ) const
+{
+    ValueRange range;
+
+    range.headers = this;
+    Lookup( name, nameLength, range.position, range.last );
+
+    return range;
+}
+
+RestClientHeaders::ValueRange RestClientHeaders::Values( const std::string& name ) const
+{
+    return Values( name.data(), name.size() );
+}
+
+std::string RestClientHeaders::operator[]( const std::string& name ) const
+{
+    return Value( name );
+}
+
+size_t RestClientHeaders::count( const std::string& name ) const
+{
+    return Has( name ) ? 1 : 0;
+}
+
+size_t RestClientHeaders::size() const
+{
+    Parse();
+
+    return entries.size();
+}
+
+bool RestClientHeaders::empty() const
+{
+    Parse();
+
+    return entries.empty();
+}
+
+void RestClientHeaders::swap( RestClientHeaders& other )
+{
+    raw.swap( other.raw );
+    std::swap( lazy, other.lazy );
+    std::swap( parsed, other.parsed );
+    entries.swap( other.entries );
+    sorted.swap( other.sorted );
+
+    for( size_t i = 0; i < kUnknown; i++ )
+    {
+        size_t index = known[i];
+
+        known[i]       = other.known[i];
+        other.known[i] = index;
+    }
+}
+
+/**
+ * @brief copy into a map, later headers replace earlier ones of the same name
+ */
+std::map<std::string, std::string> RestClientHeaders::ToMap() const
+{
+    std::map<std::string, std::string> result;
+
+    Parse();
+
+    for( size_t i = 0; i < entries.size(); i++ )
+    {
+        Field field = At( i );
+
+        result[std::string( field.name, field.nameLength )] = std::string( field.value, field.valueLength );
+    }
+
+    return result;
+}
+
+RestClientHeaders::operator std::map<std::string, std::string>() const
+{
+    return ToMap();
+}
+
+/**
+ * @brief order an entry against a name, case insensitive
+ */
+int RestClientHeaders::Compare( const RestClientHeaders::Entry& entry, const char* name, size_t nameLength ) const
+{
+    size_t common = entry.nameLength < nameLength ? entry.nameLength : nameLength;
+    int    result = strncasecmp( raw.data() + entry.nameOffset, name, common );
+
+    if( result != 0 )
+        return result;
+
+    if( entry.nameLength == nameLength )
+        return 0;
+
+    return entry.nameLength < nameLength ? -1 : 1;
+}
+
+/**
+ * @brief range of the sorted index holding a name
+ *
+ * @return true if [first, last) is not empty
+ */
+bool RestClientHeaders::Lookup( const char* name, size_t nameLength, size_t& first, size_t& last ) const
+{
+    Parse();
+
+    size_t low  = 0;
+    size_t high = sorted.size();
+
+    while( low < high )
+    {
+        size_t middle = low + ( high - low ) / 2;
+
+        if( Compare( entries[sorted[middle]], name, nameLength ) < 0 )
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    first = low;
+    last  = low;
+
+    while( last < sorted.size() && Compare( entries[sorted[last]], name, nameLength ) == 0 )
+        last++;
+
+    return first != last;
+}
+
+RestClientHeaders::ValueRange::ValueRange() : headers( NULL ), position( 0 ), last( 0 )
+{
+}
+
+/**
+ * @brief step to the next header of the range
+ *
+ * @param field set to the header if there is one left
+ *
+ * @return false once the range is exhausted
+ */
+bool RestClientHeaders::ValueRange::Next( RestClientHeaders::Field& field )
+{
+    if( position >= last )
+        return false;
+
+    field = headers->At( headers->sorted[position++] );
+
+    return true;
+}
+
+size_t RestClientHeaders::ValueRange::Size() const
+{
+    return last - position;
+}
@@ -0,0 +1,676 @@
+/**
+ * @file multiengine.cpp
+ * @brief implementation of the curl_multi engine
+ */
+
+/*========================
+         INCLUDES
+  ========================*/
+#include "multiengine.h"
+
+#include <cstdio>
+#include <cstring>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#if defined( __linux__ )
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#endif
+
+// connections remembered for the statistics once no stream uses them
+static const size_t kMaxIdleConnectionStatistics = 1024;
+
+RestClientMultiEngine::RestClientMultiEngine() : mutex(), pending(), running(), options(), optionsChanged( false ), maxStreams( 0 ), originStreams(), held(), connections(), multi( NULL ), epollFd( -1 ), timerFd( -1 ), wakeFd( -1 ), thread(), started( false ), stopping( false )
+{
+}
+
+RestClientMultiEngine::~RestClientMultiEngine()
+{
+    Stop();
+}
+
+/**
+ * @brief queue a transfer on the I/O thread
+ *
+ * @param transfer with a fully configured easy handle
+ * @param origin scheme://host:port the transfer goes to
+ *
+ * @return false if the engine could not be started or is shutting down
+ */
+bool RestClientMultiEngine::Submit( RestClientMultiTransfer* transfer, const std::string& origin )
+{
+    transfer->origin = origin;
+
+    mutex.Lock();
+
+    if( stopping || ( !started && !Start() ) )
+    {
+        mutex.Unlock();
+        return false;
+    }
+
+    pending.push_back( transfer );
+
+    // wake under the lock so Stop cannot close the wakeup channel meanwhile
+    Wake();
+
+    mutex.Unlock();
+
+    return true;
+}
+
+/**
+ * @brief stop the I/O thread and abort all outstanding transfers
+ */
+void RestClientMultiEngine::Stop()
+{
+    mutex.Lock();
+
+    if( !started || stopping )
+    {
+        mutex.Unlock();
+        return;
+    }
+
+    stopping = true;
+
+    Wake();
+
+    mutex.Unlock();
+
+    pthread_join( thread, NULL );
+
+    curl_multi_cleanup( multi );
+
+    if( epollFd >= 0 )
+        close( epollFd );
+
+    if( timerFd >= 0 )
+        close( timerFd );
+
+    if( wakeFd >= 0 )
+        close( wakeFd );
+
+    mutex.Lock();
+
+    multi    = NULL;
+    epollFd  = -1;
+    timerFd  = -1;
+    wakeFd   = -1;
+    started  = false;
+    stopping = false;
+
+    mutex.Unlock();
+}
+
+/**
+ * @brief change the multi handle options
+ *
+ * The options are applied on the I/O thread, curl_multi_setopt must not
+ * race with the transfers it drives.
+ */
+void RestClientMultiEngine::Configure( const RestClientMultiEngine::Options& newOptions )
+{
+    RestClientScopedLock lock( mutex );
+
+    options        = newOptions;
+    optionsChanged = true;
+
+    if( started && !stopping )
+        Wake();
+}
+
+/**
+ * @brief snapshot of the streams carried per connection
+ */
+std::vector<RestClient::ConnectionStatistics> RestClientMultiEngine::ConnectionStatistics()
+{
+    RestClientScopedLock                          lock( mutex );
+    std::vector<RestClient::ConnectionStatistics> result;
+
+    std::map<std::string, RestClient::ConnectionStatistics>::const_iterator iterator;
+
+    for( iterator = connections.begin(); iterator != connections.end(); iterator++ )
+        result.push_back( iterator->second );
+
+    return result;
+}
+
+/**
+ * @brief create the multi handle and spawn the I/O thread
+ *
+ * Must be called with the mutex held.
+ */
+bool RestClientMultiEngine::Start()
+{
+    multi = curl_multi_init();
+    if( multi == NULL )
+        return false;
+
+    curl_multi_setopt( multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX );
+
+    // picked up by the I/O thread before it adds the first transfer
+    optionsChanged = true;
+
+#if defined( __linux__ )
+    epollFd = epoll_create1( EPOLL_CLOEXEC );
+    timerFd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+    wakeFd  = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+    if( epollFd >= 0 && timerFd >= 0 && wakeFd >= 0 )
+    {
+        struct epoll_event event;
+        memset( &event, 0, sizeof( event ) );
+
+        event.events  = EPOLLIN;
+        event.data.fd = timerFd;
+        epoll_ctl( epollFd, EPOLL_CTL_ADD, timerFd, &event );
+
+        event.data.fd = wakeFd;
+        epoll_ctl( epollFd, EPOLL_CTL_ADD, wakeFd, &event );
+
+        curl_multi_setopt( multi, CURLMOPT_SOCKETFUNCTION, RestClientMultiEngine::SocketCallback );
+        curl_multi_setopt( multi, CURLMOPT_SOCKETDATA, this );
+        curl_multi_setopt( multi, CURLMOPT_TIMERFUNCTION, RestClientMultiEngine::TimerCallback );
+        curl_multi_setopt( multi, CURLMOPT_TIMERDATA, this );
+    }
+    else
+    {
+        // no epoll available, RunPoll takes over
+        if( epollFd >= 0 )
+            close( epollFd );
+
+        if( timerFd >= 0 )
+            close( timerFd );
+
+        if( wakeFd >= 0 )
+            close( wakeFd );
+
+        epollFd = timerFd = wakeFd = -1;
+    }
+#endif
+
+    if( pthread_create( &thread, NULL, RestClientMultiEngine::ThreadMain, this ) != 0 )
+    {
+        curl_multi_cleanup( multi );
+        multi = NULL;
+
+        return false;
+    }
+
+    started = true;
+
+    return true;
+}
+
+/**
+ * @brief interrupt the I/O thread wait
+ */
+void RestClientMultiEngine::Wake()
+{
+    if( wakeFd >= 0 )
+    {
+        uint64_t one = 1;
+
+        // a full counter already guarantees a pending wakeup
+        if( write( wakeFd, &one, sizeof( one ) ) < 0 )
+            return;
+    }
+    else
+    {
+        curl_multi_wakeup( multi );
+    }
+}
+
+void* RestClientMultiEngine::ThreadMain( void* userdata )
+{
+    reinterpret_cast<RestClientMultiEngine*>( userdata )->Run();
+
+    return NULL;
+}
+
+void RestClientMultiEngine::Run()
+{
+    if( epollFd >= 0 )
+        RunEpoll();
+    else
+        RunPoll();
+
+    AbortAll();
+}
+
+/**
+ * @brief portable loop, scans every transfer on each wakeup
+ */
+void RestClientMultiEngine::RunPoll()
+{
+    int stillRunning = 0;
+
+    for( ;; )
+    {
+        mutex.Lock();
+        bool quit = stopping;
+        mutex.Unlock();
+
+        if( quit )
+            break;
+
+        AddPending();
+
+        curl_multi_perform( multi, &stillRunning );
+
+        ProcessDone();
+
+        curl_multi_poll( multi, NULL, 0, 1000, NULL );
+    }
+}
+
+/**
+ * @brief event loop handing only ready sockets to curl_multi_socket_action
+ */
+void RestClientMultiEngine::RunEpoll()
+{
+#if defined( __linux__ )
+    struct epoll_event events[256];
+    int                stillRunning = 0;
+
+    for( ;; )
+    {
+        int ready = epoll_wait( epollFd, events, sizeof( events ) / sizeof( events[0] ), -1 );
+
+        if( ready < 0 && errno != EINTR )
+            break;
+
+        for( int i = 0; i < ready; i++ )
+        {
+            int      fd = events[i].data.fd;
+            uint64_t value;
+
+            if( fd == wakeFd )
+            {
+                if( read( wakeFd, &value, sizeof( value ) ) < 0 )
+                    continue;
+
+                mutex.Lock();
+                bool quit = stopping;
+                mutex.Unlock();
+
+                if( quit )
+                    return;
+
+                AddPending();
+            }
+            else if( fd == timerFd )
+            {
+                if( read( timerFd, &value, sizeof( value ) ) < 0 )
+                    continue;
+
+                curl_multi_socket_action( multi, CURL_SOCKET_TIMEOUT, 0, &stillRunning );
+            }
+            else
+            {
+                int action = 0;
+
+                if( events[i].events & EPOLLIN )
+                    action |= CURL_CSELECT_IN;
+
+                if( events[i].events & EPOLLOUT )
+                    action |= CURL_CSELECT_OUT;
+
+                if( events[i].events & ( EPOLLERR | EPOLLHUP ) )
+                    action |= CURL_CSELECT_ERR;
+
+                curl_multi_socket_action( multi, fd, action, &stillRunning );
+            }
+        }
+
+        ProcessDone();
+    }
+#endif
+}
+
+/**
+ * @brief keep the epoll set in line with the sockets libcurl wants watched
+ */
+int RestClientMultiEngine::SocketCallback( CURL* /* handle */, curl_socket_t socket, int what, void* userp, void* socketp )
+{
+#if defined( __linux__ )
+    RestClientMultiEngine* self = reinterpret_cast<RestClientMultiEngine*>( userp );
+    struct epoll_event     event;
+
+    if( what == CURL_POLL_REMOVE )
+    {
+        epoll_ctl( self->epollFd, EPOLL_CTL_DEL, socket, NULL );
+        curl_multi_assign( self->multi, socket, NULL );
+
+        return 0;
+    }
+
+    memset( &event, 0, sizeof( event ) );
+
+    if( what & CURL_POLL_IN )
+        event.events |= EPOLLIN;
+
+    if( what & CURL_POLL_OUT )
+        event.events |= EPOLLOUT;
+
+    event.data.fd = socket;
+
+    // socketp is set once the socket is part of the epoll set
+    if( socketp == NULL )
+    {
+        if( epoll_ctl( self->epollFd, EPOLL_CTL_ADD, socket, &event ) != 0 && errno == EEXIST )
+            epoll_ctl( self->epollFd, EPOLL_CTL_MOD, socket, &event );
+
+        curl_multi_assign( self->multi, socket, self );
+    }
+    else
+    {
+        epoll_ctl( self->epollFd, EPOLL_CTL_MOD, socket, &event );
+    }
+#endif
+
+    return 0;
+}
+
+/**
+ * @brief arm the timerfd for the timeout libcurl asks for
+ */
+int RestClientMultiEngine::TimerCallback( CURLM* /* multi */, long timeoutMs, void* userp )
+{
+#if defined( __linux__ )
+    RestClientMultiEngine* self = reinterpret_cast<RestClientMultiEngine*>( userp );
+    struct itimerspec      timer;
+
+    memset( &timer, 0, sizeof( timer ) );
+
+    if( timeoutMs == 0 )
+    {
+        // expire right away, zero would disarm the timer
+        timer.it_value.tv_nsec = 1;
+    }
+    else if( timeoutMs > 0 )
+    {
+        timer.it_value.tv_sec  = timeoutMs / 1000;
+        timer.it_value.tv_nsec = ( timeoutMs % 1000 ) * 1000000;
+    }
+
+    timerfd_settime( self->timerFd, 0, &timer, NULL );
+#endif
+
+    return 0;
+}
+
+/**
+ * @brief take over changed options on the I/O thread
+ */
+void RestClientMultiEngine::ApplyOptions()
+{
+    Options current;
+
+    mutex.Lock();
+
+    bool changed   = optionsChanged;
+    current        = options;
+    optionsChanged = false;
+
+    mutex.Unlock();
+
+    if( !changed )
+        return;
+
+    maxStreams = current.maxConcurrentStreams;
+
+    curl_multi_setopt( multi, CURLMOPT_MAX_HOST_CONNECTIONS, current.maxHostConnections );
+
+#if LIBCURL_VERSION_NUM >= 0x074300
+    // streams the server may open towards us
+    if( maxStreams > 0 )
+        curl_multi_setopt( multi, CURLMOPT_MAX_CONCURRENT_STREAMS, maxStreams );
+#endif
+
+    // a raised or lifted limit frees streams for held transfers
+    std::vector<std::string> origins;
+    std::map<std::string, std::deque<RestClientMultiTransfer*> >::const_iterator iterator;
+
+    for( iterator = held.begin(); iterator != held.end(); iterator++ )
+        origins.push_back( iterator->first );
+
+    for( size_t i = 0; i < origins.size(); i++ )
+        Admit( origins[i] );
+}
+
+/**
+ * @brief move queued transfers into the multi handle
+ */
+void RestClientMultiEngine::AddPending()
+{
+    std::vector<RestClientMultiTransfer*> added;
+
+    ApplyOptions();
+
+    mutex.Lock();
+    added.swap( pending );
+    mutex.Unlock();
+
+    for( size_t i = 0; i < added.size(); i++ )
+    {
+        std::map<std::string, std::deque<RestClientMultiTransfer*> >::iterator queue = held.find( added[i]->origin );
+
+        // keep the order within an origin, only the head of the queue may pass
+        if( queue != held.end() || ( maxStreams > 0 && originStreams[added[i]->origin] >= maxStreams ) )
+            held[added[i]->origin].push_back( added[i] );
+        else
+            Add( added[i] );
+    }
+}
+
+/**
+ * @brief put a transfer into the multi handle
+ */
+void RestClientMultiEngine::Add( RestClientMultiTransfer* transfer )
+{
+    CURL* handle = transfer->Handle();
+
+    transfer->engine = this;
+
+    curl_easy_setopt( handle, CURLOPT_PRIVATE, transfer );
+
+#if LIBCURL_VERSION_NUM >= 0x075000
+    // learn which connection carries the stream once libcurl picked one
+    curl_easy_setopt( handle, CURLOPT_PREREQFUNCTION, RestClientMultiEngine::PrereqCallback );
+    curl_easy_setopt( handle, CURLOPT_PREREQDATA, transfer );
+#endif
+
+    if( curl_multi_add_handle( multi, handle ) != CURLM_OK )
+    {
+        transfer->Done( CURLE_FAILED_INIT );
+        return;
+    }
+
+    originStreams[transfer->origin]++;
+    running.insert( transfer );
+}
+
+/**
+ * @brief add held transfers of an origin while it has free streams
+ */
+void RestClientMultiEngine::Admit( const std::string& origin )
+{
+    std::map<std::string, std::deque<RestClientMultiTransfer*> >::iterator queue = held.find( origin );
+
+    if( queue == held.end() )
+        return;
+
+    while( !queue->second.empty() && ( maxStreams <= 0 || originStreams[origin] < maxStreams ) )
+    {
+        RestClientMultiTransfer* transfer = queue->second.front();
+
+        queue->second.pop_front();
+        Add( transfer );
+    }
+
+    if( queue->second.empty() )
+        held.erase( queue );
+}
+
+/**
+ * @brief hand finished transfers back to their owners
+ */
+void RestClientMultiEngine::ProcessDone()
+{
+    CURLMsg* message  = NULL;
+    int      messages = 0;
+
+    while( ( message = curl_multi_info_read( multi, &messages ) ) != NULL )
+    {
+        if( message->msg != CURLMSG_DONE )
+            continue;
+
+        CURL*                    handle   = message->easy_handle;
+        CURLcode                 result   = message->data.result;
+        char*                    userdata = NULL;
+        RestClientMultiTransfer* transfer = NULL;
+
+        curl_easy_getinfo( handle, CURLINFO_PRIVATE, &userdata );
+        transfer = reinterpret_cast<RestClientMultiTransfer*>( userdata );
+
+        curl_multi_remove_handle( multi, handle );
+        running.erase( transfer );
+
+        // Done may delete the transfer
+        std::string origin = transfer->origin;
+
+        Finish( transfer, result );
+        Admit( origin );
+    }
+}
+
+/**
+ * @brief settle the stream accounting and complete the transfer
+ */
+void RestClientMultiEngine::Finish( RestClientMultiTransfer* transfer, CURLcode result )
+{
+    std::map<std::string, long>::iterator streams = originStreams.find( transfer->origin );
+
+    if( streams != originStreams.end() && --streams->second <= 0 )
+        originStreams.erase( streams );
+
+    StreamFinished( transfer );
+
+    transfer->Done( result );
+}
+
+/**
+ * @brief fail everything that is still queued or in flight
+ */
+void RestClientMultiEngine::AbortAll()
+{
+    std::set<RestClientMultiTransfer*>::iterator iterator;
+
+    for( iterator = running.begin(); iterator != running.end(); iterator++ )
+    {
+        curl_multi_remove_handle( multi, ( *iterator )->Handle() );
+        Finish( *iterator, CURLE_ABORTED_BY_CALLBACK );
+    }
+
+    running.clear();
+
+    std::map<std::string, std::deque<RestClientMultiTransfer*> >::iterator queue;
+
+    for( queue = held.begin(); queue != held.end(); queue++ )
+    {
+        for( size_t i = 0; i < queue->second.size(); i++ )
+            queue->second[i]->Done( CURLE_ABORTED_BY_CALLBACK );
+    }
+
+    held.clear();
+
+    mutex.Lock();
+    std::vector<RestClientMultiTransfer*> queued;
+    queued.swap( pending );
+    mutex.Unlock();
+
+    for( size_t i = 0; i < queued.size(); i++ )
+        queued[i]->Done( CURLE_ABORTED_BY_CALLBACK );
+}
+
+/**
+ * @brief called by libcurl once a transfer has its connection
+ */
+int RestClientMultiEngine::PrereqCallback( void* clientp, char* primaryIp, char* /* localIp */, int primaryPort, int localPort )
+{
+    RestClientMultiTransfer* transfer = reinterpret_cast<RestClientMultiTransfer*>( clientp );
+
+    transfer->engine->StreamStarted( transfer, primaryIp, primaryPort, localPort );
+
+#if LIBCURL_VERSION_NUM >= 0x075000
+    return CURL_PREREQFUNC_OK;
+#else
+    return 0;
+#endif
+}
+
+void RestClientMultiEngine::StreamStarted( RestClientMultiTransfer* transfer, const char* remote, int remotePort, int localPort )
+{
+    char key[128];
+
+    // a redirect may move the transfer to another connection
+    StreamFinished( transfer );
+
+    snprintf( key, sizeof( key ), "%s:%d/%d", remote, remotePort, localPort );
+
+    RestClientScopedLock lock( mutex );
+
+    RestClient::ConnectionStatistics& statistics = connections[key];
+
+    if( statistics.streams == 0 )
+    {
+        char address[96];
+
+        snprintf( address, sizeof( address ), "%s:%d", remote, remotePort );
+
+        statistics.remote    = address;
+        statistics.localPort = localPort;
+    }
+
+    statistics.streams++;
+    statistics.activeStreams++;
+
+    if( statistics.activeStreams > statistics.peakStreams )
+        statistics.peakStreams = statistics.activeStreams;
+
+    transfer->connection = key;
+}
+
+void RestClientMultiEngine::StreamFinished( RestClientMultiTransfer* transfer )
+{
+    if( transfer->connection.empty() )
+        return;
+
+    RestClientScopedLock lock( mutex );
+
+    std::map<std::string, RestClient::ConnectionStatistics>::iterator found = connections.find( transfer->connection );
+
+    if( found != connections.end() && found->second.activeStreams > 0 )
+        found->second.activeStreams--;
+
+    transfer->connection.clear();
+
+    // forget idle connections once there are too many to report usefully
+    if( connections.size() > kMaxIdleConnectionStatistics )
+    {
+        std::map<std::string, RestClient::ConnectionStatistics>::iterator iterator = connections.begin();
+
+        while( iterator != connections.end() )
+        {
+            if( iterator->second.activeStreams == 0 )
+                connections.erase( iterator++ );
+            else
+                iterator++;
+        }
+    }
+}
@@ -0,0 +1,130 @@
+/**
+ * @file multiengine.h
+ * @brief curl_multi engine driving asynchronous transfers
+ */
+
+#ifndef SOURCE_MULTIENGINE_H_
+#define SOURCE_MULTIENGINE_H_
+
+#include <curl/curl.h>
+#include <pthread.h>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "restclient.h"
+#include "threading.h"
+
+class RestClientMultiEngine;
+
+/**
+ * A transfer owned by the engine while it is in flight. Done is called on
+ * the I/O thread once the transfer finished or was aborted and may delete
+ * the object.
+ */
+class RestClientMultiTransfer
+{
+public:
+    RestClientMultiTransfer() : engine( NULL ), origin(), connection()
+    {}
+
+    virtual ~RestClientMultiTransfer()
+    {};
+
+    virtual CURL* Handle() = 0;
+    virtual void  Done( CURLcode result ) = 0;
+
+private:
+    friend class RestClientMultiEngine;
+
+    RestClientMultiEngine* engine;
+    std::string            origin;      // scheme://host:port the stream is counted against
+    std::string            connection;  // key of the connection carrying the stream
+};
+
+/**
+ * Runs one curl_multi handle on a dedicated I/O thread. The thread is
+ * started by the first Submit and stopped by Stop, which aborts whatever
+ * is still queued or running.
+ *
+ * On Linux the thread drives curl_multi_socket_action from an epoll loop
+ * with a timerfd for libcurl's timeouts, so a wakeup only touches the
+ * sockets that are ready no matter how many transfers are in flight.
+ * Elsewhere it falls back to curl_multi_perform/curl_multi_poll.
+ *
+ * With maxConcurrentStreams set, transfers beyond that many per origin are
+ * held back until a stream of the origin completes. libcurl only applies
+ * CURLMOPT_MAX_CONCURRENT_STREAMS to streams the server opens, so the
+ * engine keeps the client side in line itself.
+ */
+class RestClientMultiEngine
+{
+public:
+    RestClientMultiEngine();
+    ~RestClientMultiEngine();
+
+    typedef struct Options_s
+    {
+        long maxConcurrentStreams;  // per origin, 0 for no limit
+        long maxHostConnections;    // 0 for no limit
+
+        Options_s() : maxConcurrentStreams( 0 ), maxHostConnections( 0 )
+        {}
+    } Options;
+
+    bool Submit( RestClientMultiTransfer* transfer, const std::string& origin );
+    void Stop();
+    void Configure( const Options& newOptions );
+
+    std::vector<RestClient::ConnectionStatistics> ConnectionStatistics();
+
+private:
+    RestClientMultiEngine( const RestClientMultiEngine& );
+    RestClientMultiEngine& operator=( const RestClientMultiEngine& );
+
+    static void* ThreadMain( void* userdata );
+
+    static int SocketCallback( CURL* handle, curl_socket_t socket, int what, void* userp, void* socketp );
+    static int TimerCallback ( CURLM* multi, long timeoutMs, void* userp );
+    static int PrereqCallback( void* clientp, char* primaryIp, char* localIp, int primaryPort, int localPort );
+
+    bool Start();
+    void Wake();
+    void Run();
+    void RunPoll();
+    void RunEpoll();
+    void ApplyOptions();
+    void AddPending();
+    void Add( RestClientMultiTransfer* transfer );
+    void Admit( const std::string& origin );
+    void ProcessDone();
+    void Finish( RestClientMultiTransfer* transfer, CURLcode result );
+    void AbortAll();
+
+    void StreamStarted ( RestClientMultiTransfer* transfer, const char* remote, int remotePort, int localPort );
+    void StreamFinished( RestClientMultiTransfer* transfer );
+
+    RestClientMutex                       mutex;
+    std::vector<RestClientMultiTransfer*> pending;
+    std::set<RestClientMultiTransfer*>    running;
+    Options                               options;
+    bool                                  optionsChanged;
+    long                                  maxStreams;  // I/O thread copy of the option
+
+    // I/O thread only
+    std::map<std::string, long>                                  originStreams;
+    std::map<std::string, std::deque<RestClientMultiTransfer*> > held;
+
+    std::map<std::string, RestClient::ConnectionStatistics> connections;
+    CURLM*                                multi;
+    int                                   epollFd;
+    int                                   timerFd;
+    int                                   wakeFd;
+    pthread_t                             thread;
+    bool                                  started;
+    bool                                  stopping;
+};
+
+#endif  // SOURCE_MULTIENGINE_H_
@@ -8,443 +8,1202 @@
          INCLUDES
   ========================*/
 #include "restclient.h"
+#include "bodypool.h"
+#include "handlepool.h"
+#include "multiengine.h"
+#include "scheduler.h"
+#include "share.h"
+#include "threadcache.h"
 
+#include <cctype>
 #include <cstring>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
 #include <string>
 #include <iostream>
 #include <map>
+#include <unistd.h>
 
 // initialize user agent string
 const char* RestClient::kDefaultUserAgent = "restclient-cpp-mfr/" VERSION;
 
-// initialize authentication variable
-std::string RestClient::UserPassword =  std::string();
+// HTTP/2 stays off until requested
+RestClient::Http2Settings RestClient::Http2 = RestClient::Http2Settings();
+
+// certificates are checked against the system store unless a bundle is set
+RestClient::TlsSettings RestClient::Tls = RestClient::TlsSettings();
+
+// Content-Length reservations capped against hostile headers
+RestClient::BodySettings RestClient::Body = RestClient::BodySettings();
+
+// headers are parsed as they arrive unless lazy parsing is requested
+RestClient::HeaderSettings RestClient::Headers = RestClient::HeaderSettings();
+
+// bytes held by the bodies of running transfers while BodySettings::bufferBudget is set, updated atomically
+static size_t BufferedBytes = 0;
+
+// CURLOPT_HTTP_VERSION used while HTTP/2 is enabled
+static long Http2Version = CURL_HTTP_VERSION_2TLS;
+
+// DNS, TLS session and connection caches shared by all handles
+static RestClientShare Share;
+
+// easy handles the blocking static methods keep per thread, cleaned up before the share
+static RestClientThreadCache ThreadCache;
+
+// recycled body buffers, outlives the engine whose transfers release into it
+static RestClientBodyPool BodyPool;
+
+// auth and easy handles of the static methods, destroyed before the share its handles are attached to
+static RestClientSession DefaultSession;
+
+// per host limits for every transfer, outlives the engine that releases into it
+static RestClientHostScheduler Scheduler;
+
+// I/O thread for the asynchronous methods, stopped before the pool goes away
+static RestClientMultiEngine Engine;
+
+// multi handle options collected from the scheduler and HTTP/2 settings
+static RestClientMultiEngine::Options EngineOptions;
+
+/**
+ * @brief transport state of a request, kept out of the response it fills
+ *
+ * libcurl writes straight into the referenced response, which is the one
+ * handed to the caller, so the body is never copied on its way out.
+ */
+class RestClient::Exchange
+{
+public:
+    explicit Exchange( RestClient::Response& target ) : response( target ), curl( NULL ), headerChunk( NULL ), pool( NULL ), origin(), threadCached( false ), sink( NULL ), sinkActive( false ), limits(), headerBytes( 0 ), bodyBytes( 0 ), charged( 0 ), failure( RestClient::kFailed )
+    {}
+
+    RestClient::Response& response;
+    CURL*                 curl;
+    struct curl_slist*    headerChunk;
+    RestClientHandlePool* pool;          // curl goes back here once the transfer is over
+    std::string           origin;        // scheduler key of the URL, set by the blocking methods
+    bool                  threadCached;  // curl goes back to the cache of the calling thread instead
+    RestClientBodySink*   sink;          // takes the body instead of Response::body when it accepts it
+    bool                  sinkActive;    // decided once the headers of each response are in
+    RestClient::Limits    limits;
+    size_t                headerBytes;   // received by the whole transfer
+    size_t                bodyBytes;     // of the current response
+    size_t                charged;       // counted against BodySettings::bufferBudget
+    int                   failure;       // Response::code if the transfer fails
+
+private:
+    Exchange( const Exchange& );
+    Exchange& operator=( const Exchange& );
+};
+
+/**
+ * @brief limits of a request, falling back to those of its session
+ */
+static RestClient::Limits RestClientLimits( const RestClient::Limits& session, const RestClient::Limits& request )
+{
+    RestClient::Limits limits;
+
+    limits.maxBodyBytes   = request.maxBodyBytes > 0 ? request.maxBodyBytes : session.maxBodyBytes;
+    limits.maxHeaderBytes = request.maxHeaderBytes > 0 ? request.maxHeaderBytes : session.maxHeaderBytes;
+
+    return limits;
+}
+
+/**
+ * @brief decimal number at the start of a header value
+ *
+ * @param end receiving the first character after the digits, may be NULL
+ *
+ * @return false without digits or if the number does not fit
+ */
+static bool RestClientParseNumber( const char* value, size_t length, unsigned long long& number, const char** end )
+{
+    size_t i = 0;
+
+    number = 0;
+
+    for( ; i < length && isdigit( static_cast<unsigned char>( value[i] ) ); i++ )
+    {
+        if( number > ( static_cast<unsigned long long>( -1 ) - 9 ) / 10 )
+            return false;
+
+        number = number * 10 + ( value[i] - '0' );
+    }
+
+    if( end != NULL )
+        *end = value + i;
+
+    return i > 0;
+}
+
+/**
+ * @brief announced Content-Length of a response
+ */
+static bool RestClientContentLength( const RestClientHeaders& headers, unsigned long long& length )
+{
+    RestClientHeaders::Field field;
+    const char*              end = NULL;
+
+    if( !headers.Find( RestClientHeaders::kContentLength, field ) )
+        return false;
+
+    return RestClientParseNumber( field.value, field.valueLength, length, &end ) && end == field.value + field.valueLength;
+}
+
+/**
+ * @brief body of a response whose transfer failed
+ */
+static const char* RestClientFailureText( int code )
+{
+    switch( code )
+    {
+        case RestClient::kBodyTooLarge:
+            return "Response body too large.";
+        case RestClient::kHeadersTooLarge:
+            return "Response headers too large.";
+        case RestClient::kOverBudget:
+            return "Response bodies over budget.";
+        default:
+            return "Failed to query.";
+    }
+}
+
+/**
+ * @brief NUL terminated copy of a borrowed string, on the stack unless it is long
+ */
+class RestClientCString
+{
+public:
+    RestClientCString( const char* data, size_t length ) : heap(), str( local )
+    {
+        if( length >= sizeof( local ) )
+        {
+            heap.assign( data, length );
+            str = heap.c_str();
+            return;
+        }
+
+        memcpy( local, data, length );
+        local[length] = '\0';
+    }
+
+    const char* Get() const
+    {
+        return str;
+    }
+
+private:
+    RestClientCString( const RestClientCString& );
+    RestClientCString& operator=( const RestClientCString& );
+
+    char        local[512];
+    std::string heap;
+    const char* str;
+};
+
+/**
+ * @brief append "name: value" to a curl header list
+ */
+static struct curl_slist* CurlHeaderAppend( struct curl_slist* list, const char* name, size_t nameLength, const char* value, size_t valueLength )
+{
+    char        local[512];
+    std::string heap;
+    size_t      length = nameLength + 2 + valueLength;
+    char*       line   = local;
+
+    if( length >= sizeof( local ) )
+    {
+        heap.resize( length + 1 );
+        line = &heap[0];
+    }
+
+    memcpy( line, name, nameLength );
+    memcpy( line + nameLength, ": ", 2 );
+    memcpy( line + nameLength + 2, value, valueLength );
+    line[length] = '\0';
+
+    return curl_slist_append( list, line );
+}
+
+/**
+ * @brief whether a borrowed header list carries a name, ignoring case
+ */
+static bool CurlHeaderHas( const RestClient::HeaderField* headers, size_t headerCount, const char* name, size_t nameLength )
+{
+    for( size_t i = 0; i < headerCount; i++ )
+    {
+        if( headers[i].nameLength == nameLength && strncasecmp( headers[i].name, name, nameLength ) == 0 )
+            return true;
+    }
+
+    return false;
+}
 
 // Authentication Methods implementation
 void RestClient::ClearAuth()
 {
-    RestClient::UserPassword.clear();
+    DefaultSession.ClearAuth();
 }
 
 void RestClient::SetAuth( const std::string& username, const std::string& password )
 {
-    RestClient::UserPassword.clear();
+    DefaultSession.SetAuth( username, password );
+}
+
+void RestClient::SetLimits( const RestClient::Limits& limits )
+{
+    DefaultSession.SetLimits( limits );
+}
 
-    RestClient::UserPassword += username + ":" + password;
+bool RestClient::Init()
+{
+    return Init( ShareSettings() );
 }
 
-void RestClient::Init()
+/**
+ * @brief set up libcurl and the caches shared by all handles
+ *
+ * Calling it again replaces the share, like CleanUp it must not run while
+ * requests are in flight.
+ *
+ * @return false if the previous share is still in use and was kept
+ */
+bool RestClient::Init( const RestClient::ShareSettings& share )
 {
     curl_global_init( CURL_GLOBAL_ALL );
+
+    // cached handles are attached to the share being replaced
+    ThreadCache.Drain();
+
+    return Share.Init( share );
 }
 
-void RestClient::CleanUp()
+/**
+ * @return false if handles outside the pools still use the share, it stays alive then
+ */
+bool RestClient::CleanUp()
 {
+    Scheduler.CancelQueued();
+    Engine.Stop();
+    ThreadCache.Drain();
+    BodyPool.Drain();
+
+    // drains the pools of all sessions
+    bool released = Share.CleanUp();
+
     curl_global_cleanup();
+
+    return released;
 }
 
-bool RestClient::CurlSharedEasyInit( const RestClient::Request& request, RestClient::Response& response )
+void RestClient::SetPoolSettings( const RestClient::PoolSettings& settings )
 {
-    bool               retVal      = false;
-    struct curl_slist* headerChunk = NULL;
+    DefaultSession.SetPoolSettings( settings );
+    ThreadCache.Configure( settings.threadCacheOrigins );
+}
 
-    response.curl = curl_easy_init();
-    if( response.curl != NULL )
-    {
-        // set basic authentication if present
-        if( RestClient::UserPassword.length() > 0 )
-        {
-            curl_easy_setopt( response.curl, CURLOPT_HTTPAUTH, CURLAUTH_BASIC );
-            curl_easy_setopt( response.curl, CURLOPT_USERPWD, RestClient::UserPassword.c_str() );
-        }
+RestClient::PoolStatistics RestClient::GetPoolStatistics()
+{
+    RestClient::PoolStatistics statistics = DefaultSession.GetPoolStatistics();
 
-        if( request.headers.size() > 0 )
-        {
-            headermap::const_iterator iterator;
-            std::string               value;
-            
-            for( iterator = request.headers.begin(); iterator != request.headers.end(); iterator++ )
-            {
-                value       = iterator->first + ": " + iterator->second;
-                headerChunk = curl_slist_append( headerChunk, value.c_str() );
-            }
-            
-            curl_easy_setopt( response.curl, CURLOPT_HTTPHEADER, headerChunk );
-            
-            if( request.headers.find( "User-Agent" ) == request.headers.end() )
-                curl_easy_setopt( response.curl, CURLOPT_USERAGENT, RestClient::kDefaultUserAgent );
-        }
-        else
-        {
-            curl_easy_setopt( response.curl, CURLOPT_USERAGENT, RestClient::kDefaultUserAgent );
-        }
+    ThreadCache.AddStatistics( statistics );
 
-        // do not install signal handlers
-        curl_easy_setopt( response.curl, CURLOPT_NOSIGNAL, 1 );
+    return statistics;
+}
 
-        // set query URL
-        curl_easy_setopt( response.curl, CURLOPT_URL, request.url.c_str() );
+void RestClient::SetBodySettings( const RestClient::BodySettings& settings )
+{
+    RestClient::Body = settings;
+}
 
-        // set callback function
-        curl_easy_setopt( response.curl, CURLOPT_WRITEFUNCTION, RestClient::CurlWriteCallback );
+void RestClient::SetBodyPoolSettings( const RestClient::BodyPoolSettings& settings )
+{
+    BodyPool.Configure( settings );
+}
 
-        // set data object to pass to callback function
-        curl_easy_setopt( response.curl, CURLOPT_WRITEDATA, &response );
+RestClient::BodyPoolStatistics RestClient::GetBodyPoolStatistics()
+{
+    return BodyPool.Statistics();
+}
 
-        // set the header callback function
-        curl_easy_setopt( response.curl, CURLOPT_HEADERFUNCTION, RestClient::CurlHeaderCallback );
+/**
+ * @brief bytes the bodies of running transfers hold in memory
+ *
+ * Only counted while BodySettings::bufferBudget is set.
+ */
+size_t RestClient::GetBufferedBytes()
+{
+    return __sync_fetch_and_add( &BufferedBytes, 0 );
+}
 
-        // callback object for headers
-        curl_easy_setopt( response.curl, CURLOPT_HEADERDATA, &response );
-        
-        retVal = true;
-    }
+void RestClient::SetHeaderSettings( const RestClient::HeaderSettings& settings )
+{
+    RestClient::Headers = settings;
+}
 
-    return retVal;
+void RestClient::SetSchedulerSettings( const RestClient::SchedulerSettings& settings )
+{
+    Scheduler.Configure( settings );
+
+    // multiplexed transfers leave their connections to libcurl
+    EngineOptions.maxHostConnections = settings.maxConnectionsPerHost;
+    Engine.Configure( EngineOptions );
 }
 
-bool RestClient::CurlSharedEasyCleanUp( RestClient::Response& response )
+std::vector<RestClient::HostStatistics> RestClient::GetHostStatistics()
 {
-    if( response.curl != NULL )
-        curl_easy_cleanup( response.curl );
-    
-    if( response.headerChunk != NULL )
-        curl_slist_free_all( response.headerChunk );
+    return Scheduler.Statistics();
+}
 
-    response.curl        = NULL;
-    response.headerChunk = NULL;
-    
-    return true;
+void RestClient::SetHttp2Settings( const RestClient::Http2Settings& settings )
+{
+    RestClient::Http2 = settings;
+
+    // libcurl before 8.0.0 fails every stream but the first multiplexed over a
+    // prior knowledge connection, plain http:// stays on HTTP/1.1 there
+    if( settings.priorKnowledge && curl_version_info( CURLVERSION_NOW )->version_num >= 0x080000 )
+        Http2Version = CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE;
+    else
+        Http2Version = CURL_HTTP_VERSION_2TLS;
+
+    // streams per origin only need a cap while they share a connection
+    EngineOptions.maxConcurrentStreams = settings.enabled ? settings.maxConcurrentStreams : 0;
+    Engine.Configure( EngineOptions );
+}
+
+std::vector<RestClient::ConnectionStatistics> RestClient::GetConnectionStatistics()
+{
+    return Engine.ConnectionStatistics();
+}
+
+void RestClient::SetTlsSettings( const RestClient::TlsSettings& settings )
+{
+    RestClient::Tls = settings;
 }
 
 /**
- * @brief HTTP GET method
+ * @brief take a pooled handle of a session and set it up for a request
  *
+ * The header list is built for this call and owned by the response, which
+ * frees it in CurlSharedEasyCleanUp. Blocking calls of the static methods
+ * take the handle their thread last used for the origin without touching
+ * the pool lock.
+ *
+ * @param session providing handle, credentials and defaults
  * @param request to query
+ * @param blocking true if the calling thread runs the transfer itself
+ * @param exchange receiving the handle
  *
- * @return response struct
+ * @return true if a handle was available
  */
-RestClient::Response RestClient::Get( const RestClient::Request& request )
+bool RestClient::CurlSharedEasyInit( const RestClientSession& session, const RestClient::Request& request, bool blocking, RestClient::Exchange& exchange )
 {
-    return Get( request, NULL, NULL );
+    bool sessionUserAgent = request.headers.find( "User-Agent" ) == request.headers.end() && session.headers.find( "User-Agent" ) == session.headers.end();
+
+    exchange.headerChunk = CurlHeaderList( session.headers, request.headers );
+    exchange.limits      = RestClientLimits( session.limits, request.limits );
+
+    return CurlSharedEasyInit( session, request.url.c_str(), sessionUserAgent, blocking, exchange );
 }
 
 /**
- * @brief HTTP GET method
+ * @brief take a handle of a session for a request in borrowed buffers
  *
- * @param request to query
- * @param outputFile to output data stream to disk
- * @param callback to give progress info
+ * @param session providing handle, credentials and defaults
+ * @param url to query
+ * @param headers of the request, default headers of the same name are left out
+ * @param headerCount number of headers
+ * @param blocking true if the calling thread runs the transfer itself
+ * @param exchange receiving the handle
  *
- * @return response struct
+ * @return true if a handle was available
  */
-RestClient::Response RestClient::Get( const RestClient::Request& request, const std::ostream* outputFile, const RestClientTransferCallback* transferCallback )
+bool RestClient::CurlSharedEasyInit( const RestClientSession& session, const char* url, const RestClient::HeaderField* headers, size_t headerCount, bool blocking, RestClient::Exchange& exchange )
 {
-    // create return struct
-    RestClient::Response response     = RestClient::Response();
-    CURLcode             curlResponse = CURLE_OK;
-    struct curl_slist*   headerChunk  = NULL;
-    long                 httpCode     = 0;
+    bool sessionUserAgent = !CurlHeaderHas( headers, headerCount, "User-Agent", 10 ) && session.headers.find( "User-Agent" ) == session.headers.end();
 
-    if( CurlSharedEasyInit( request, response ) )
+    exchange.headerChunk = CurlHeaderList( session.headers, headers, headerCount );
+    exchange.limits      = session.limits;
+
+    return CurlSharedEasyInit( session, url, sessionUserAgent, blocking, exchange );
+}
+
+/**
+ * @brief take a handle of a session once the header list is built
+ *
+ * @param session providing handle, credentials and defaults
+ * @param url to query
+ * @param sessionUserAgent send the user agent of the session
+ * @param blocking true if the calling thread runs the transfer itself
+ * @param exchange holding the header list, receiving the handle
+ *
+ * @return true if a handle was available
+ */
+bool RestClient::CurlSharedEasyInit( const RestClientSession& session, const char* url, bool sessionUserAgent, bool blocking, RestClient::Exchange& exchange )
+{
+    if( blocking && &session == &DefaultSession )
     {
-        if( transferCallback != NULL )
-        {
-            curl_easy_setopt( response.curl, CURLOPT_XFERINFOFUNCTION, RestClient::CurlTransferCallback );
-            curl_easy_setopt( response.curl, CURLOPT_XFERINFODATA, transferCallback );
-            curl_easy_setopt( response.curl, CURLOPT_NOPROGRESS, 0L );
-        }
+        exchange.origin       = RestClientHostScheduler::Origin( url, strlen( url ) );
+        exchange.curl         = ThreadCache.Acquire( exchange.origin );
+        exchange.threadCached = true;
+    }
+
+    if( CurlSharedEasyInit( *session.pool, url, exchange.headerChunk, sessionUserAgent ? session.userAgent.c_str() : NULL, session.userPassword, exchange ) )
+        return true;
+
+    CurlSharedEasyCleanUp( exchange );
+
+    return false;
+}
+
+/**
+ * @brief take a pooled handle and set it up with compiled request options
+ *
+ * A handle already in the exchange, taken from a thread cache, is set up
+ * instead of acquiring one.
+ *
+ * @param pool to take the handle from, it goes back there on clean up
+ * @param url to query
+ * @param headerList extra request headers, NULL for none, must outlive the transfer
+ * @param userAgent to send, NULL if the headers carry one
+ * @param userPassword basic auth credentials, empty for none
+ * @param exchange receiving the handle
+ *
+ * @return true if a handle was available
+ */
+bool RestClient::CurlSharedEasyInit( RestClientHandlePool& pool, const char* url, const struct curl_slist* headerList, const char* userAgent, const std::string& userPassword, RestClient::Exchange& exchange )
+{
+    bool retVal = false;
 
-        if( outputFile != NULL )
-            response.file = (std::ostream*)outputFile;
+    if( exchange.curl == NULL )
+        exchange.curl = pool.Acquire();
 
-        // perform the actual query
-        curlResponse = curl_easy_perform( response.curl );
+    if( exchange.curl != NULL )
+    {
+        exchange.pool = &pool;
 
-        if( curlResponse != CURLE_OK )
+        // set basic authentication if present
+        if( userPassword.length() > 0 )
         {
-            response.body = "Failed to query.";
-            response.code = -1;
+            curl_easy_setopt( exchange.curl, CURLOPT_HTTPAUTH, CURLAUTH_BASIC );
+            curl_easy_setopt( exchange.curl, CURLOPT_USERPWD, userPassword.c_str() );
         }
-        else
+
+        if( headerList != NULL )
+            curl_easy_setopt( exchange.curl, CURLOPT_HTTPHEADER, headerList );
+
+        if( userAgent != NULL )
+            curl_easy_setopt( exchange.curl, CURLOPT_USERAGENT, userAgent );
+
+        // do not install signal handlers
+        curl_easy_setopt( exchange.curl, CURLOPT_NOSIGNAL, 1 );
+
+        if( RestClient::Http2.enabled )
         {
-            curl_easy_getinfo( response.curl, CURLINFO_RESPONSE_CODE, &httpCode );
-        
-            response.code = static_cast<int>( httpCode );
+            curl_easy_setopt( exchange.curl, CURLOPT_HTTP_VERSION, Http2Version );
+
+            // wait for a connection that can multiplex rather than opening a new one
+            curl_easy_setopt( exchange.curl, CURLOPT_PIPEWAIT, 1L );
         }
 
-        CurlSharedEasyCleanUp( response );
+        if( !RestClient::Tls.caFile.empty() )
+            curl_easy_setopt( exchange.curl, CURLOPT_CAINFO, RestClient::Tls.caFile.c_str() );
+
+        // set query URL
+        curl_easy_setopt( exchange.curl, CURLOPT_URL, url );
+
+        // set callback function
+        curl_easy_setopt( exchange.curl, CURLOPT_WRITEFUNCTION, RestClient::CurlWriteCallback );
+
+        // set data object to pass to callback function
+        curl_easy_setopt( exchange.curl, CURLOPT_WRITEDATA, &exchange );
+
+        // set the header callback function
+        curl_easy_setopt( exchange.curl, CURLOPT_HEADERFUNCTION, RestClient::CurlHeaderCallback );
+
+        // callback object for headers
+        curl_easy_setopt( exchange.curl, CURLOPT_HEADERDATA, &exchange );
+
+        exchange.response.headers.SetLazy( RestClient::Headers.lazy );
+        
+        retVal = true;
     }
 
-    return response;
+    return retVal;
 }
 
 /**
- * @brief HTTP POST method
+ * @brief build the curl header list of a request
  *
- * @param request to query
- * @param form to post
+ * @param defaults headers of the session, left out where the request has the same name
+ * @param headers of the request
  *
- * @return response struct
+ * @return the list, NULL without headers, free with curl_slist_free_all
  */
-RestClient::Response RestClient::Post( const Request& request, const std::map<std::string, FormItem>& form )
+struct curl_slist* RestClient::CurlHeaderList( const RestClient::headermap& defaults, const RestClient::headermap& headers )
 {
-    RestClient::Response  response     = RestClient::Response();
-    CURLcode              curlResponse = CURLE_OK;
-    long                  httpCode     = 0;
-    struct curl_slist*    headerChunk  = NULL;
-    struct curl_httppost* formPost     = NULL;
-    struct curl_httppost* lastPtr      = NULL;
+    struct curl_slist*        headerList = NULL;
+    headermap::const_iterator iterator;
 
-    if( CurlSharedEasyInit( request, response ) )
+    for( iterator = defaults.begin(); iterator != defaults.end(); iterator++ )
     {
-        if( form.size() > 0 )
-        {
-            std::map<std::string,FormItem>::const_iterator iterator;
-            
-            for( iterator = form.begin(); iterator != form.end(); iterator++ )
-            {
-                std::string    name   = iterator->first;
-                FormItem       item   = iterator->second;
-                CURLformoption option = CURLFORM_NOTHING;
-                
-                switch( item.type )
-                {
-                    case kFile:
-                        option = CURLFORM_FILE;
-                        break;
-                    case kString:
-                        option = CURLFORM_COPYCONTENTS;
-                        break;
-                };
-                
-                curl_formadd( &formPost, &lastPtr, CURLFORM_COPYNAME, iterator->first.c_str(), option, item.value.c_str(), CURLFORM_END );
-            }
-            
-            curl_easy_setopt( response.curl, CURLOPT_HTTPPOST, formPost );
-        }
-        
-        curlResponse = curl_easy_perform( response.curl );
-        if( curlResponse != CURLE_OK )
-        {
-            response.body = "Failed to query.";
-            response.code = -1;
-        }
-        else
-        {
-            curl_easy_getinfo( response.curl, CURLINFO_RESPONSE_CODE, &httpCode );
+        if( headers.find( iterator->first ) != headers.end() )
+            continue;
 
-            response.code = static_cast<int>( httpCode );
-        }
+        headerList = CurlHeaderAppend( headerList, iterator->first.data(), iterator->first.size(), iterator->second.data(), iterator->second.size() );
+    }
+
+    for( iterator = headers.begin(); iterator != headers.end(); iterator++ )
+        headerList = CurlHeaderAppend( headerList, iterator->first.data(), iterator->first.size(), iterator->second.data(), iterator->second.size() );
+
+    return headerList;
+}
+
+/**
+ * @brief build the curl header list of a request in borrowed buffers
+ *
+ * @param defaults headers of the session, left out where the request has the same name in any case
+ * @param headers of the request
+ * @param headerCount number of headers
+ *
+ * @return the list, NULL without headers, free with curl_slist_free_all
+ */
+struct curl_slist* RestClient::CurlHeaderList( const RestClient::headermap& defaults, const RestClient::HeaderField* headers, size_t headerCount )
+{
+    struct curl_slist*        headerList = NULL;
+    headermap::const_iterator iterator;
+
+    for( iterator = defaults.begin(); iterator != defaults.end(); iterator++ )
+    {
+        if( CurlHeaderHas( headers, headerCount, iterator->first.data(), iterator->first.size() ) )
+            continue;
 
-        CurlSharedEasyCleanUp( response );
+        headerList = CurlHeaderAppend( headerList, iterator->first.data(), iterator->first.size(), iterator->second.data(), iterator->second.size() );
     }
+
+    for( size_t i = 0; i < headerCount; i++ )
+        headerList = CurlHeaderAppend( headerList, headers[i].name, headers[i].nameLength, headers[i].value, headers[i].valueLength );
+
+    return headerList;
+}
+
+bool RestClient::CurlSharedEasyCleanUp( RestClient::Exchange& exchange )
+{
+    if( exchange.curl != NULL && exchange.threadCached )
+        ThreadCache.Release( exchange.curl, exchange.origin, exchange.response.code > 0, *exchange.pool );
+    else if( exchange.curl != NULL )
+        exchange.pool->Release( exchange.curl, exchange.response.code > 0 );
     
-    return response;
+    if( exchange.headerChunk != NULL )
+        curl_slist_free_all( exchange.headerChunk );
+
+    exchange.curl         = NULL;
+    exchange.headerChunk  = NULL;
+    exchange.pool         = NULL;
+    exchange.threadCached = false;
+
+    exchange.origin.clear();
+    
+    return true;
 }
 
-//RestClient::response RestClient::post( const std::string& url, const std::string& ctype, const std::string& data )
-//{
-//  /** create return struct */
-//  RestClient::response ret = RestClient::response();
-//
-//    /** build content-type header string */
-//  std::string ctype_header = "Content-Type: " + ctype;
-//
-//  // use libcurl
-//  CURL *curl = NULL;
-//  CURLcode res = CURLE_OK;
-//
-//  curl = curl_easy_init();
-//  if (curl)
-//  {
-//    /** set basic authentication if present*/
-//    if(RestClient::user_pass.length()>0){
-//      curl_easy_setopt(curl, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
-//      curl_easy_setopt(curl, CURLOPT_USERPWD, RestClient::user_pass.c_str());
-//    }
-//      
-//    if(RestClient::cookies.length()>0){
-//      curl_easy_setopt(curl, CURLOPT_COOKIE, RestClient::cookies.c_str());
-//    }
-//
-//    /** set user agent */
-//    curl_easy_setopt(curl, CURLOPT_USERAGENT, RestClient::user_agent);
-//    /** set query URL */
-//    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-//    /** Now specify we want to POST data */
-//    curl_easy_setopt(curl, CURLOPT_POST, 1L);
-//    /** set post fields */
-//    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.c_str());
-//    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, data.size());
-//    /** set callback function */
-//    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, RestClient::CurlWriteCallback);
-//    /** set data object to pass to callback function */
-//    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &ret);
-//    /** set the header callback function */
-//    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, RestClient::CurlHeaderCallback);
-//    /** callback object for headers */
-//    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &ret);
-//    /** set content-type header */
-//    curl_slist* header = NULL;
-//    header = curl_slist_append(header, ctype_header.c_str());
-//    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header);
-//    /** perform the actual query */
-//    res = curl_easy_perform(curl);
-//    if (res != CURLE_OK)
-//    {
-//      ret.body = "Failed to query.";
-//      ret.code = -1;
-//      return ret;
-//    }
-//    long http_code = 0;
-//    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-//    ret.code = static_cast<int>(http_code);
-//
-//    curl_slist_free_all(header);
-//    curl_easy_cleanup(curl);
-//    curl_global_cleanup();
-//  }
-//
-//  return ret;
-//}
+/**
+ * @brief store the outcome of a finished transfer in the response
+ *
+ * @param curlResponse result of the transfer
+ * @param exchange whose response to update
+ */
+void RestClient::CurlSharedEasyComplete( CURLcode curlResponse, RestClient::Exchange& exchange )
+{
+    long httpCode = 0;
 
-//RestClient::response RestClient::post( const request& request, const std::map<std::string, formItem>& form )
-//{
-//    /** create return struct */
-//    RestClient::response ret = RestClient::response();
-//    
-//    // use libcurl
-//    CURL *curl = NULL;
-//    CURLcode res = CURLE_OK;
-//    struct curl_slist *headerChunk = NULL;
-//    struct curl_httppost *formpost = NULL;
-//    struct curl_httppost *lastptr = NULL;
-//    
-//    curl = curl_easy_init();
-//    if (curl)
-//    {
-//        /** set basic authentication if present*/
-//        if(RestClient::user_pass.length()>0){
-//            curl_easy_setopt(curl, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
-//            curl_easy_setopt(curl, CURLOPT_USERPWD, RestClient::user_pass.c_str());
-//        }
-//        
-//        if(request.headers.size()>0){
-//            headermap::const_iterator iterator;
-//            
-//            for(iterator = request.headers.begin(); iterator != request.headers.end(); iterator++){
-//                std::string value = iterator->first+": "+iterator->second;
-//                
-//                headerChunk = curl_slist_append(headerChunk, value.c_str());
-//            }
-//            
-//            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headerChunk);
-//            
-//            if(request.headers.find("User-Agent") == request.headers.end()){
-//                /** set user agent */
-//                curl_easy_setopt(curl, CURLOPT_USERAGENT, RestClient::user_agent);
-//            }
-//        } else {
-//            /** set user agent */
-//            curl_easy_setopt(curl, CURLOPT_USERAGENT, RestClient::user_agent);
-//        }
-// 
-//        if(form.size()>0){
-//            std::map<std::string,formItem>::const_iterator iterator;
-//            
-//            for(iterator = form.begin(); iterator != form.end(); iterator++){
-//                std::string    name   = iterator->first;
-//                formItem       item   = iterator->second;
-//                CURLformoption option = CURLFORM_NOTHING;
-//
-//                switch(item.type)
-//                {
-//                    case kFile:
-//                        option = CURLFORM_FILE;
-//                        break;
-//                    case kString:
-//                        option = CURLFORM_COPYNAME;
-//                        break;
-//                };
-//                
-//                curl_formadd(&formpost,
-//                             &lastptr,
-//                             CURLFORM_COPYNAME, iterator->first.c_str(),
-//                             option, item.value.c_str(),
-//                             CURLFORM_END);
-//            }
-//
-//            curl_easy_setopt(curl, CURLOPT_HTTPPOST, formpost);
-//        }
-//        
-//        /** do not install signal handlers */
-//        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
-//        /** set query URL */
-//        curl_easy_setopt(curl, CURLOPT_URL, request.url.c_str());
-//        /** Now specify we want to POST data */
-//        //curl_easy_setopt(curl, CURLOPT_POST, 1L);
-//        /** set callback function */
-//        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, RestClient::CurlWriteCallback);
-//        /** set data object to pass to callback function */
-//        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &ret);
-//        /** set the header callback function */
-//        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, RestClient::CurlHeaderCallback);
-//        /** callback object for headers */
-//        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &ret);
-//        /** set content-type header */
-//        /** perform the actual query */
-//        res = curl_easy_perform(curl);
-//        if (res != CURLE_OK)
-//        {
-//            ret.body = "Failed to query.";
-//            ret.code = -1;
-//            return ret;
-//        }
-//        long http_code = 0;
-//        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-//        ret.code = static_cast<int>(http_code);
-//        
-//        curl_easy_cleanup(curl);
-//        curl_global_cleanup();
-//    }
-//    
-//    return ret;
-//}
+    RefundBudget( exchange );
+
+    if( curlResponse != CURLE_OK )
+    {
+        exchange.response.body = RestClientFailureText( exchange.failure );
+        exchange.response.code = exchange.failure;
+
+        exchange.response.bodyFile.Reset();
+    }
+    else
+    {
+        curl_easy_getinfo( exchange.curl, CURLINFO_RESPONSE_CODE, &httpCode );
+
+        exchange.response.code = static_cast<int>( httpCode );
+    }
+
+    if( exchange.sink != NULL )
+        exchange.sink->OnComplete( exchange.response );
+}
 
 /**
- * @brief HTTP PUT method
+ * @brief build a multipart form for libcurl
  *
- * @param url to query
- * @param ctype content type as string
- * @param data HTTP PUT body
+ * @param form items to add
+ *
+ * @return form post to hand to CURLOPT_HTTPPOST, NULL for an empty form
+ */
+struct curl_httppost* RestClient::CurlFormBuild( const std::map<std::string, FormItem>& form )
+{
+    struct curl_httppost* formPost = NULL;
+    struct curl_httppost* lastPtr  = NULL;
+
+    std::map<std::string,FormItem>::const_iterator iterator;
+
+    for( iterator = form.begin(); iterator != form.end(); iterator++ )
+    {
+        const FormItem& item   = iterator->second;
+        CURLformoption  option = CURLFORM_NOTHING;
+
+        switch( item.type )
+        {
+            case kFile:
+                option = CURLFORM_FILE;
+                break;
+            case kString:
+                option = CURLFORM_COPYCONTENTS;
+                break;
+        };
+
+        curl_formadd( &formPost, &lastPtr, CURLFORM_COPYNAME, iterator->first.c_str(), option, item.value.c_str(), CURLFORM_END );
+    }
+
+    return formPost;
+}
+
+/**
+ * @brief build a multipart form from borrowed buffers
+ *
+ * Names and contents are copied by libcurl, file names only need a
+ * terminating NUL for the call.
+ *
+ * @param form items to post
+ * @param formCount number of items
+ *
+ * @return form post to hand to CURLOPT_HTTPPOST, NULL for an empty form
+ */
+struct curl_httppost* RestClient::CurlFormBuild( const RestClient::FormField* form, size_t formCount )
+{
+    struct curl_httppost* formPost = NULL;
+    struct curl_httppost* lastPtr  = NULL;
+
+    for( size_t i = 0; i < formCount; i++ )
+    {
+        const FormField& item = form[i];
+
+        if( item.type == kFile )
+        {
+            RestClientCString file( item.value, item.valueLength );
+
+            curl_formadd( &formPost, &lastPtr, CURLFORM_COPYNAME, item.name, CURLFORM_NAMELENGTH, static_cast<long>( item.nameLength ), CURLFORM_FILE, file.Get(), CURLFORM_END );
+        }
+        else
+        {
+            curl_formadd( &formPost, &lastPtr, CURLFORM_COPYNAME, item.name, CURLFORM_NAMELENGTH, static_cast<long>( item.nameLength ), CURLFORM_COPYCONTENTS, item.value, CURLFORM_CONTENTSLENGTH, static_cast<long>( item.valueLength ), CURLFORM_END );
+        }
+    }
+
+    return formPost;
+}
+
+/**
+ * @brief run a blocking transfer once the scheduler lets it
+ *
+ * Without scheduler limits the transfer runs right away, a thread cache
+ * hit then takes none of the library's mutexes. Only libcurl still locks
+ * the shared DNS cache, once per transfer, while DNS sharing is on.
+ *
+ * @param url the handle was set up for
+ * @param exchange holding the configured handle
+ *
+ * @return result of curl_easy_perform
+ */
+CURLcode RestClient::CurlSharedEasyPerform( const char* url, RestClient::Exchange& exchange )
+{
+    if( !Scheduler.Limited() )
+        return curl_easy_perform( exchange.curl );
+
+    if( exchange.origin.empty() )
+        exchange.origin = RestClientHostScheduler::Origin( url, strlen( url ) );
+
+    Scheduler.Enter( exchange.origin );
+
+    CURLcode result = curl_easy_perform( exchange.curl );
+
+    Scheduler.Leave( exchange.origin, false );
+
+    return result;
+}
+
+/**
+ * @brief HTTP GET method
+ *
+ * @param request to query
  *
  * @return response struct
  */
-//RestClient::response RestClient::put(const std::string& url,
-//                                     const std::string& ctype,
-//                                     const std::string& data)
-//{
-//  /** create return struct */
-//  RestClient::response ret = RestClient::response();
-//  /** build content-type header string */
-//  std::string ctype_header = "Content-Type: " + ctype;
-//
-//  /** initialize upload object */
-//  RestClient::upload_object up_obj;
-//  up_obj.data = data.c_str();
-//  up_obj.length = data.size();
-//
-//  // use libcurl
-//  CURL *curl = NULL;
-//  CURLcode res = CURLE_OK;
-//
-//  curl = curl_easy_init();
-//  if (curl)
-//  {
-//    /** set basic authentication if present*/
-//    if(RestClient::user_pass.length()>0){
-//      curl_easy_setopt(curl, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
+RestClient::Response RestClient::Get( const RestClient::Request& request )
+{
+    return DefaultSession.Get( request );
+}
+
+/**
+ * @brief HTTP GET method
+ *
+ * @param request to query
+ * @param outputFile to output data stream to disk
+ * @param callback to give progress info
+ *
+ * @return response struct
+ */
+RestClient::Response RestClient::Get( const RestClient::Request& request, const std::ostream* outputFile, const RestClientTransferCallback* transferCallback )
+{
+    if( outputFile == NULL )
+        return CurlSharedGet( DefaultSession, request, NULL, transferCallback );
+
+    RestClientStreamSink sink( *const_cast<std::ostream*>( outputFile ) );
+    RestClient::Response response = CurlSharedGet( DefaultSession, request, &sink, transferCallback );
+
+    response.file = const_cast<std::ostream*>( outputFile );
+
+    return response;
+}
+
+/**
+ * @brief HTTP GET method streaming the body into a sink
+ *
+ * @param request to query
+ * @param sink receiving the body, bodies it declines stay in the response
+ *
+ * @return response struct
+ */
+RestClient::Response RestClient::Get( const RestClient::Request& request, RestClientBodySink* sink )
+{
+    return DefaultSession.Get( request, sink );
+}
+
+/**
+ * @brief blocking GET shared by the public overloads
+ *
+ * @param session providing handle, credentials and defaults
+ * @param request to query
+ * @param sink receiving the body, NULL keeps it in the response
+ * @param transferCallback to give progress info, may be NULL
+ *
+ * @return response struct
+ */
+RestClient::Response RestClient::CurlSharedGet( const RestClientSession& session, const RestClient::Request& request, RestClientBodySink* sink, const RestClientTransferCallback* transferCallback )
+{
+    // create return struct, libcurl writes into it directly
+    RestClient::Response response;
+    RestClient::Exchange exchange( response );
+
+    if( CurlSharedEasyInit( session, request, true, exchange ) )
+        CurlSharedGet( request.url.c_str(), sink, transferCallback, exchange );
+
+    return response;
+}
+
+/**
+ * @brief run a blocking GET on a set up handle and release it
+ *
+ * @param url the handle was set up for
+ * @param sink receiving the body, NULL keeps it in the response
+ * @param transferCallback to give progress info, may be NULL
+ * @param exchange holding the configured handle
+ */
+void RestClient::CurlSharedGet( const char* url, RestClientBodySink* sink, const RestClientTransferCallback* transferCallback, RestClient::Exchange& exchange )
+{
+    CURLcode curlResponse = CURLE_OK;
+
+    if( transferCallback != NULL )
+    {
+        curl_easy_setopt( exchange.curl, CURLOPT_XFERINFOFUNCTION, RestClient::CurlTransferCallback );
+        curl_easy_setopt( exchange.curl, CURLOPT_XFERINFODATA, transferCallback );
+        curl_easy_setopt( exchange.curl, CURLOPT_NOPROGRESS, 0L );
+    }
+
+    exchange.sink = sink;
+
+    // perform the actual query
+    curlResponse = CurlSharedEasyPerform( url, exchange );
+
+    CurlSharedEasyComplete( curlResponse, exchange );
+    CurlSharedEasyCleanUp( exchange );
+}
+
+/**
+ * @brief HTTP POST method
+ *
+ * @param request to query
+ * @param form to post
+ *
+ * @return response struct
+ */
+RestClient::Response RestClient::Post( const Request& request, const std::map<std::string, FormItem>& form )
+{
+    return DefaultSession.Post( request, form );
+}
+
+/**
+ * @brief run a blocking form POST on a set up handle and release it
+ *
+ * @param url the handle was set up for
+ * @param formPost to post, NULL for none, freed here
+ * @param exchange holding the configured handle
+ */
+void RestClient::CurlSharedPost( const char* url, struct curl_httppost* formPost, RestClient::Exchange& exchange )
+{
+    CURLcode curlResponse = CURLE_OK;
+
+    if( formPost != NULL )
+        curl_easy_setopt( exchange.curl, CURLOPT_HTTPPOST, formPost );
+
+    curlResponse = CurlSharedEasyPerform( url, exchange );
+
+    CurlSharedEasyComplete( curlResponse, exchange );
+    CurlSharedEasyCleanUp( exchange );
+
+    if( formPost != NULL )
+        curl_formfree( formPost );
+}
+
+/**
+ * @brief transfer handed to the multi engine by the asynchronous methods
+ */
+class RestClient::Transfer : public RestClientMultiTransfer, public RestClientScheduledRequest
+{
+public:
+    Transfer( RestClientCompletionCallback* completionCallback ) : response(), exchange( response ), formPost( NULL ), callback( completionCallback ), origin(), multiplexed( false ), admitted( false )
+    {}
+
+    virtual ~Transfer()
+    {
+        if( formPost != NULL )
+            curl_formfree( formPost );
+    }
+
+    virtual CURL* Handle()
+    {
+        return exchange.curl;
+    }
+
+    virtual void Done( CURLcode result )
+    {
+        CurlSharedEasyComplete( result, exchange );
+        CurlSharedEasyCleanUp( exchange );
+
+        // let the next request to this host go before running user code
+        if( admitted )
+            Scheduler.Leave( origin, multiplexed );
+
+        // fire and forget requests have no callback
+        if( callback != NULL )
+            callback->OnComplete( response );
+
+        delete this;
+    }
+
+    virtual void Dispatch()
+    {
+        admitted = true;
+
+        if( !Engine.Submit( this, origin ) )
+            Done( CURLE_FAILED_INIT );
+    }
+
+    virtual void Cancel()
+    {
+        Done( CURLE_ABORTED_BY_CALLBACK );
+    }
+
+    RestClient::Response          response;
+    RestClient::Exchange          exchange;
+    struct curl_httppost*         formPost;
+    RestClientCompletionCallback* callback;
+    std::string                   origin;
+    bool                          multiplexed;
+    bool                          admitted;
+};
+
+/**
+ * @brief hand a configured transfer to the scheduler
+ *
+ * The transfer reaches the multi engine once its host has a free slot. If
+ * the engine cannot take it the callback sees a failed request.
+ *
+ * @param transfer to submit, owned by the scheduler and engine from now on
+ * @param url the transfer was set up for
+ */
+void RestClient::SubmitTransfer( RestClient::Transfer* transfer, const char* url )
+{
+    transfer->origin      = RestClientHostScheduler::Origin( url, strlen( url ) );
+    transfer->multiplexed = RestClient::Http2.enabled;
+
+    Scheduler.Submit( transfer, transfer->origin, transfer->multiplexed );
+}
+
+/**
+ * @brief download to a file, in concurrent byte ranges where the server allows it
+ *
+ * @param request to query
+ * @param path of the file, created or truncated
+ * @param options number and minimum size of the ranges
+ * @param info receiving the progress of all ranges together, NULL for none
+ *
+ * @return headers of the object with an empty body, or the response that failed
+ */
+RestClient::Response RestClient::Download( const RestClient::Request& request, const std::string& path, const RestClient::DownloadOptions& options, const RestClientTransferCallback* info )
+{
+    return DefaultSession.Download( request, path, options, info );
+}
+
+/**
+ * @brief asynchronous HTTP GET method
+ *
+ * @param request to query
+ * @param callback called on the I/O thread once the transfer finished, NULL for none
+ *
+ * @return true if the request was queued, the callback is not called otherwise
+ */
+bool RestClient::GetAsync( const RestClient::Request& request, RestClientCompletionCallback* callback )
+{
+    return DefaultSession.GetAsync( request, NULL, callback );
+}
+
+/**
+ * @brief asynchronous HTTP GET method streaming the body into a sink
+ *
+ * @param request to query
+ * @param sink receiving the body on the I/O thread, NULL keeps it in the response
+ * @param callback called on the I/O thread once the transfer finished, NULL for none
+ *
+ * @return true if the request was queued, the callback is not called otherwise
+ */
+bool RestClient::GetAsync( const RestClient::Request& request, RestClientBodySink* sink, RestClientCompletionCallback* callback )
+{
+    return DefaultSession.GetAsync( request, sink, callback );
+}
+
+/**
+ * @brief asynchronous HTTP POST method
+ *
+ * @param request to query
+ * @param form to post
+ * @param callback called on the I/O thread once the transfer finished, NULL for none
+ *
+ * @return true if the request was queued, the callback is not called otherwise
+ */
+bool RestClient::PostAsync( const RestClient::Request& request, const std::map<std::string, FormItem>& form, RestClientCompletionCallback* callback )
+{
+    return DefaultSession.PostAsync( request, form, callback );
+}
+
+/**
+ * @brief HTTP GET method on borrowed buffers
+ *
+ * @param url to query, need not be NUL terminated
+ * @param urlLength length of url
+ * @param headers to send, read during the call only
+ * @param headerCount number of headers
+ *
+ * @return response struct
+ */
+RestClient::Response RestClient::Get( const char* url, size_t urlLength, const HeaderField* headers, size_t headerCount )
+{
+    return DefaultSession.Get( url, urlLength, headers, headerCount );
+}
+
+/**
+ * @brief HTTP POST method on borrowed buffers
+ *
+ * @param url to query, need not be NUL terminated
+ * @param urlLength length of url
+ * @param headers to send, read during the call only
+ * @param headerCount number of headers
+ * @param form items to post, read during the call only
+ * @param formCount number of form items
+ *
+ * @return response struct
+ */
+RestClient::Response RestClient::Post( const char* url, size_t urlLength, const HeaderField* headers, size_t headerCount, const FormField* form, size_t formCount )
+{
+    return DefaultSession.Post( url, urlLength, headers, headerCount, form, formCount );
+}
+
+/**
+ * @brief asynchronous HTTP GET method on borrowed buffers
+ *
+ * The buffers may be reused as soon as the call returns.
+ *
+ * @param url to query, need not be NUL terminated
+ * @param urlLength length of url
+ * @param headers to send
+ * @param headerCount number of headers
+ * @param callback called on the I/O thread once the transfer finished, NULL for none
+ *
+ * @return true if the request was queued, the callback is not called otherwise
+ */
+bool RestClient::GetAsync( const char* url, size_t urlLength, const HeaderField* headers, size_t headerCount, RestClientCompletionCallback* callback )
+{
+    return DefaultSession.GetAsync( url, urlLength, headers, headerCount, callback );
+}
+
+/**
+ * @brief finish setting up an asynchronous transfer and submit it
+ *
+ * @param url the transfer was set up for
+ * @param formPost to post, NULL for none, owned by the transfer from now on
+ * @param sink receiving the body on the I/O thread, NULL keeps it in the response
+ * @param transfer holding the configured handle, owned by the scheduler from now on
+ *
+ * @return true, the callback reports failures from here on
+ */
+bool RestClient::CurlSharedAsync( const char* url, struct curl_httppost* formPost, RestClientBodySink* sink, RestClient::Transfer* transfer )
+{
+    if( formPost != NULL )
+    {
+        transfer->formPost = formPost;
+
+        curl_easy_setopt( transfer->exchange.curl, CURLOPT_HTTPPOST, transfer->formPost );
+    }
+
+    transfer->exchange.sink = sink;
+
+    SubmitTransfer( transfer, url );
+
+    return true;
+}
+
+/**
+ * @brief bookkeeping for RestClient::Perform
+ *
+ * Completions arrive on the I/O thread and are only queued here; the
+ * calling thread picks them up, streams them and tops up the transfers in
+ * flight.
+ */
+class RestClientBatch
+{
+public:
+    class Slot : public RestClientCompletionCallback
+    {
+    public:
+        Slot() : batch( NULL ), index( 0 )
+        {}
+
+        virtual void OnComplete( RestClient::Response& response )
+        {
+            batch->Complete( index, response );
+        }
+
+        RestClientBatch* batch;
+        size_t           index;
+    };
+
+    explicit RestClientBatch( size_t count ) : results( count ), slots( count ), completed(), woken( false ), mutex(), condition()
+    {
+        for( size_t i = 0; i < count; i++ )
+        {
+            slots[i].batch = this;
+            slots[i].index = i;
+        }
+    }
+
+    void Complete( size_t index, RestClient::Response& response )
+    {
+        RestClientScopedLock lock( mutex );
+
+        // hand the buffers over instead of copying them
+        results[index].swap( response );
+
+        completed.push_back( index );
+        condition.Signal();
+    }
+
+    /**
+     * @brief wait for completions, or for Wake with none
+     */
+    void WaitCompleted( std::vector<size_t>& indices )
+    {
+        RestClientScopedLock lock( mutex );
+
+        while( completed.empty() && !woken )
+            condition.Wait( mutex );
+
+        woken = false;
+
+        indices.swap( completed );
+    }
+
+    void Wake()
+    {
+        RestClientScopedLock lock( mutex );
+
+        woken = true;
+        condition.Signal();
+    }
+
+    std::vector<RestClient::Response> results;
+    std::vector<Slot>                 slots;
+
+private:
+    std::vector<size_t>  completed;
+    bool                 woken;
+    RestClientMutex      mutex;
+    RestClientCondition  condition;
+};
+
+/**
+ * @brief run a batch of HTTP GET requests concurrently
+ *
+ * @param requests to query
+ *
+ * @return responses in the order of the requests
+ */
+std::vector<RestClient::Response> RestClient::Perform( const std::vector<RestClient::Request>& requests )
+{
+    return DefaultSession.Perform( requests, BatchOptions() );
+}
+
+/**
+ * @brief run a batch of HTTP GET requests concurrently
+ *
+ * All transfers share the multi handle of the asynchronous engine. The
+ * streaming callback, if any, runs on the calling thread.
+ *
+ * @param requests to query
+ * @param options parallelism cap and streaming callback
+ *
+ * @return responses in the order of the requests
+ */
+std::vector<RestClient::Response> RestClient::Perform( const std::vector<RestClient::Request>& requests, const RestClient::BatchOptions& options )
+{
+    return DefaultSession.Perform( requests, options );
+}
+
+//RestClient::response RestClient::post( const std::string& url, const std::string& ctype, const std::string& data )
+//{
+//  /** create return struct */
+//  RestClient::response ret = RestClient::response();
+//
+//    /** build content-type header string */
+//  std::string ctype_header = "Content-Type: " + ctype;
+//
+//  // use libcurl
+//  CURL *curl = NULL;
+//  CURLcode res = CURLE_OK;
+//
+//  curl = curl_easy_init();
+//  if (curl)
+//  {
+//    /** set basic authentication if present*/
+//    if(RestClient::user_pass.length()>0){
+//      curl_easy_setopt(curl, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
 //      curl_easy_setopt(curl, CURLOPT_USERPWD, RestClient::user_pass.c_str());
 //    }
 //      
@@ -456,13 +1215,197 @@ RestClient::Response RestClient::Post( const Request& request, const std::map<st
 //    curl_easy_setopt(curl, CURLOPT_USERAGENT, RestClient::user_agent);
 //    /** set query URL */
 //    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-//    /** Now specify we want to PUT data */
-//    curl_easy_setopt(curl, CURLOPT_PUT, 1L);
-//    curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
-//    /** set read callback function */
-//    curl_easy_setopt(curl, CURLOPT_READFUNCTION, RestClient::CurlReadCallback);
-//    /** set data object to pass to callback function */
-//    curl_easy_setopt(curl, CURLOPT_READDATA, &up_obj);
+//    /** Now specify we want to POST data */
+//    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+//    /** set post fields */
+//    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.c_str());
+//    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, data.size());
+//    /** set callback function */
+//    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, RestClient::CurlWriteCallback);
+//    /** set data object to pass to callback function */
+//    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &ret);
+//    /** set the header callback function */
+//    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, RestClient::CurlHeaderCallback);
+//    /** callback object for headers */
+//    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &ret);
+//    /** set content-type header */
+//    curl_slist* header = NULL;
+//    header = curl_slist_append(header, ctype_header.c_str());
+//    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header);
+//    /** perform the actual query */
+//    res = curl_easy_perform(curl);
+//    if (res != CURLE_OK)
+//    {
+//      ret.body = "Failed to query.";
+//      ret.code = -1;
+//      return ret;
+//    }
+//    long http_code = 0;
+//    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+//    ret.code = static_cast<int>(http_code);
+//
+//    curl_slist_free_all(header);
+//    curl_easy_cleanup(curl);
+//    curl_global_cleanup();
+//  }
+//
+//  return ret;
+//}
+
+//RestClient::response RestClient::post( const request& request, const std::map<std::string, formItem>& form )
+//{
+//    /** create return struct */
+//    RestClient::response ret = RestClient::response();
+//    
+//    // use libcurl
+//    CURL *curl = NULL;
+//    CURLcode res = CURLE_OK;
+//    struct curl_slist *headerChunk = NULL;
+//    struct curl_httppost *formpost = NULL;
+//    struct curl_httppost *lastptr = NULL;
+//    
+//    curl = curl_easy_init();
+//    if (curl)
+//    {
+//        /** set basic authentication if present*/
+//        if(RestClient::user_pass.length()>0){
+//            curl_easy_setopt(curl, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
+//            curl_easy_setopt(curl, CURLOPT_USERPWD, RestClient::user_pass.c_str());
+//        }
+//        
+//        if(request.headers.size()>0){
+//            headermap::const_iterator iterator;
+//            
+//            for(iterator = request.headers.begin(); iterator != request.headers.end(); iterator++){
+//                std::string value = iterator->first+": "+iterator->second;
+//                
+//                headerChunk = curl_slist_append(headerChunk, value.c_str());
+//            }
+//            
+//            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headerChunk);
+//            
+//            if(request.headers.find("User-Agent") == request.headers.end()){
+//                /** set user agent */
+//                curl_easy_setopt(curl, CURLOPT_USERAGENT, RestClient::user_agent);
+//            }
+//        } else {
+//            /** set user agent */
+//            curl_easy_setopt(curl, CURLOPT_USERAGENT, RestClient::user_agent);
+//        }
+// 
+//        if(form.size()>0){
+//            std::map<std::string,formItem>::const_iterator iterator;
+//            
+//            for(iterator = form.begin(); iterator != form.end(); iterator++){
+//                std::string    name   = iterator->first;
+//                formItem       item   = iterator->second;
+//                CURLformoption option = CURLFORM_NOTHING;
+//
+//                switch(item.type)
+//                {
+//                    case kFile:
+//                        option = CURLFORM_FILE;
+//                        break;
+//                    case kString:
+//                        option = CURLFORM_COPYNAME;
+//                        break;
+//                };
+//                
+//                curl_formadd(&formpost,
+//                             &lastptr,
+//                             CURLFORM_COPYNAME, iterator->first.c_str(),
+//                             option, item.value.c_str(),
+//                             CURLFORM_END);
+//            }
+//
+//            curl_easy_setopt(curl, CURLOPT_HTTPPOST, formpost);
+//        }
+//        
+//        /** do not install signal handlers */
+//        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
+//        /** set query URL */
+//        curl_easy_setopt(curl, CURLOPT_URL, request.url.c_str());
+//        /** Now specify we want to POST data */
+//        //curl_easy_setopt(curl, CURLOPT_POST, 1L);
+//        /** set callback function */
+//        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, RestClient::CurlWriteCallback);
+//        /** set data object to pass to callback function */
+//        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &ret);
+//        /** set the header callback function */
+//        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, RestClient::CurlHeaderCallback);
+//        /** callback object for headers */
+//        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &ret);
+//        /** set content-type header */
+//        /** perform the actual query */
+//        res = curl_easy_perform(curl);
+//        if (res != CURLE_OK)
+//        {
+//            ret.body = "Failed to query.";
+//            ret.code = -1;
+//            return ret;
+//        }
+//        long http_code = 0;
+//        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+//        ret.code = static_cast<int>(http_code);
+//        
+//        curl_easy_cleanup(curl);
+//        curl_global_cleanup();
+//    }
+//    
+//    return ret;
+//}
+
+/**
+ * @brief HTTP PUT method
+ *
+ * @param url to query
+ * @param ctype content type as string
+ * @param data HTTP PUT body
+ *
+ * @return response struct
+ */
+//RestClient::response RestClient::put(const std::string& url,
+//                                     const std::string& ctype,
+//                                     const std::string& data)
+//{
+//  /** create return struct */
+//  RestClient::response ret = RestClient::response();
+//  /** build content-type header string */
+//  std::string ctype_header = "Content-Type: " + ctype;
+//
+//  /** initialize upload object */
+//  RestClient::upload_object up_obj;
+//  up_obj.data = data.c_str();
+//  up_obj.length = data.size();
+//
+//  // use libcurl
+//  CURL *curl = NULL;
+//  CURLcode res = CURLE_OK;
+//
+//  curl = curl_easy_init();
+//  if (curl)
+//  {
+//    /** set basic authentication if present*/
+//    if(RestClient::user_pass.length()>0){
+//      curl_easy_setopt(curl, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
+//      curl_easy_setopt(curl, CURLOPT_USERPWD, RestClient::user_pass.c_str());
+//    }
+//      
+//    if(RestClient::cookies.length()>0){
+//      curl_easy_setopt(curl, CURLOPT_COOKIE, RestClient::cookies.c_str());
+//    }
+//
+//    /** set user agent */
+//    curl_easy_setopt(curl, CURLOPT_USERAGENT, RestClient::user_agent);
+//    /** set query URL */
+//    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+//    /** Now specify we want to PUT data */
+//    curl_easy_setopt(curl, CURLOPT_PUT, 1L);
+//    curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+//    /** set read callback function */
+//    curl_easy_setopt(curl, CURLOPT_READFUNCTION, RestClient::CurlReadCallback);
+//    /** set data object to pass to callback function */
+//    curl_easy_setopt(curl, CURLOPT_READDATA, &up_obj);
 //    /** set callback function */
 //    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, RestClient::CurlWriteCallback);
 //    /** set data object to pass to callback function */
@@ -499,182 +1442,1523 @@ RestClient::Response RestClient::Post( const Request& request, const std::map<st
 //  return ret;
 //}
 /**
- * @brief HTTP DELETE method
+ * @brief HTTP DELETE method
+ *
+ * @param url to query
+ *
+ * @return response struct
+ */
+//RestClient::response RestClient::del(const std::string& url)
+//{
+//  /** create return struct */
+//  RestClient::response ret = RestClient::response();
+//
+//  /** we want HTTP DELETE */
+//  const char* http_delete = "DELETE";
+//
+//  // use libcurl
+//  CURL *curl = NULL;
+//  CURLcode res = CURLE_OK;
+//    
+//  curl = curl_easy_init();
+//  if (curl)
+//  {
+//    /** set basic authentication if present*/
+//    if(RestClient::user_pass.length()>0){
+//      curl_easy_setopt(curl, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
+//      curl_easy_setopt(curl, CURLOPT_USERPWD, RestClient::user_pass.c_str());
+//    }
+//      
+//    if(RestClient::cookies.length()>0){
+//      curl_easy_setopt(curl, CURLOPT_COOKIE, RestClient::cookies.c_str());
+//    }
+//
+//    /** set user agent */
+//    curl_easy_setopt(curl, CURLOPT_USERAGENT, RestClient::user_agent);
+//    /** set query URL */
+//    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+//    /** set HTTP DELETE METHOD */
+//    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, http_delete);
+//    /** set callback function */
+//    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, RestClient::CurlWriteCallback);
+//    /** set data object to pass to callback function */
+//    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &ret);
+//    /** set the header callback function */
+//    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, RestClient::CurlHeaderCallback);
+//    /** callback object for headers */
+//    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &ret);
+//    /** perform the actual query */
+//    res = curl_easy_perform(curl);
+//    if (res != CURLE_OK)
+//    {
+//      ret.body = "Failed to query.";
+//      ret.code = -1;
+//      return ret;
+//    }
+//    long http_code = 0;
+//    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+//    ret.code = static_cast<int>(http_code);
+//
+//    curl_easy_cleanup(curl);
+//    curl_global_cleanup();
+//  }
+//
+//  return ret;
+//}
+
+/**
+ * @brief write callback function for libcurl
+ *
+ * @param data returned data of size (size*nmemb)
+ * @param size size parameter
+ * @param nmemb memblock parameter
+ * @param userdata pointer to user data to save/work with return data
+ *
+ * @return (size * nmemb)
+ */
+size_t RestClient::CurlWriteCallback( void *data, size_t size, size_t nmemb, void *userdata )
+{
+    RestClient::Exchange* exchange = reinterpret_cast<RestClient::Exchange*>( userdata );
+    size_t                length   = size * nmemb;
+
+    exchange->bodyBytes += length;
+
+    if( exchange->limits.maxBodyBytes > 0 && exchange->bodyBytes > exchange->limits.maxBodyBytes )
+    {
+        exchange->failure = RestClient::kBodyTooLarge;
+        return 0;
+    }
+
+    // the destination was picked when the headers ended
+    if( exchange->sinkActive )
+        return exchange->sink->OnData( reinterpret_cast<char*>( data ), length ) ? length : 0;
+
+    if( exchange->response.bodyFile.Open() )
+        return exchange->response.bodyFile.Append( reinterpret_cast<char*>( data ), length ) ? length : 0;
+
+    // a body about to pass the threshold moves to disk, one that cannot stops the transfer
+    if( RestClient::Body.spillThreshold > 0 && exchange->response.body.size() + length > RestClient::Body.spillThreshold )
+    {
+        if( !SpillBody( *exchange ) || !exchange->response.bodyFile.Append( reinterpret_cast<char*>( data ), length ) )
+            return 0;
+
+        return length;
+    }
+
+    if( !ChargeBudget( *exchange, exchange->response.body.size() + length ) )
+    {
+        exchange->failure = RestClient::kOverBudget;
+        return 0;
+    }
+
+    // bodies of unknown length start from a pooled buffer too
+    if( exchange->response.body.empty() && exchange->response.body.capacity() < length && BodyPool.Enabled() )
+        BodyPool.Acquire( length, exchange->response.body );
+
+    exchange->response.body.append( reinterpret_cast<char*>( data ), length );
+
+    return length;
+}
+
+/**
+ * @brief header callback for libcurl
+ *
+ * @param data returned (header line)
+ * @param size of data
+ * @param nmemb memblock
+ * @param userdata pointer to user data object to save headr data
+ * @return size * nmemb;
+ */
+size_t RestClient::CurlHeaderCallback( void *data, size_t size, size_t nmemb, void *userdata )
+{
+    RestClient::Exchange* x      = reinterpret_cast<RestClient::Exchange*>( userdata );
+    RestClient::Response* r      = &x->response;
+    const char*           line   = reinterpret_cast<const char*>( data );
+    size_t                length = size * nmemb;
+
+    x->headerBytes += length;
+
+    if ( x->limits.maxHeaderBytes > 0 && x->headerBytes > x->limits.maxHeaderBytes )
+    {
+        x->failure = RestClient::kHeadersTooLarge;
+        return 0;
+    }
+
+    // every response of the transfer starts with its status line, 1xx and redirects included
+    if ( length > 5 && memcmp( line, "HTTP/", 5 ) == 0 )
+    {
+        const char* space = static_cast<const char*>( memchr( line, ' ', length ) );
+        int         code  = 0;
+
+        if ( space != NULL )
+        {
+            for ( const char* digit = space + 1; digit < line + length && isdigit( static_cast<unsigned char>( *digit ) ); digit++ )
+                code = code * 10 + ( *digit - '0' );
+        }
+
+        // only the headers of the final response are reported
+        r->headers.Clear();
+
+        r->code       = code;
+        x->sinkActive = false;
+        x->bodyBytes  = 0;
+
+        return length;
+    }
+
+    if ( length <= 2 && ( length == 0 || line[0] == '\r' || line[0] == '\n' ) )
+    {
+        // headers are complete, decide once where this body goes
+        if ( x->sink != NULL && r->code >= 200 )
+            x->sinkActive = x->sink->OnHeaders( *r );
+
+        if ( !x->sinkActive && r->code >= 200 )
+            ReserveBody( *x );
+
+        return length; // blank line
+    }
+
+    r->headers.Add( line, length );
+
+    return length;
+}
+
+/**
+ * @brief size the body for the announced Content-Length
+ *
+ * Saves the reallocations and copies of growing the string chunk by chunk.
+ * Lengths above BodySettings::reserveLimit are not trusted and grow as
+ * usual.
+ *
+ * @param exchange whose response is about to receive its body
+ */
+void RestClient::ReserveBody( RestClient::Exchange& exchange )
+{
+    RestClient::Response& response = exchange.response;
+    unsigned long long    length   = 0;
+
+    if( response.headers.Lazy() )
+    {
+        // looking the header up would parse the whole block, ask libcurl instead
+#if LIBCURL_VERSION_NUM >= 0x073700
+        curl_off_t announced = -1;
+
+        if( curl_easy_getinfo( exchange.curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &announced ) != CURLE_OK || announced <= 0 )
+            return;
+
+        length = static_cast<unsigned long long>( announced );
+#endif
+    }
+    else
+    {
+        RestClientHeaders::Field field;
+
+        if( !response.headers.Find( RestClientHeaders::kContentLength, field ) )
+            return;
+
+        for( size_t i = 0; i < field.valueLength && length <= RestClient::Body.reserveLimit; i++ )
+        {
+            if( !isdigit( static_cast<unsigned char>( field.value[i] ) ) )
+                return;
+
+            length = length * 10 + ( field.value[i] - '0' );
+        }
+    }
+
+    if( length == 0 || length > RestClient::Body.reserveLimit )
+        return;
+
+    // the body will end up on disk, reserving would allocate what spilling saves
+    if( RestClient::Body.spillThreshold > 0 && length > RestClient::Body.spillThreshold )
+        return;
+
+    // a body the limit will abort or the budget has no room for grows as it arrives
+    if( exchange.limits.maxBodyBytes > 0 && length > exchange.limits.maxBodyBytes )
+        return;
+
+    if( !ChargeBudget( exchange, static_cast<size_t>( length ) ) )
+        return;
+
+    if( response.body.empty() && BodyPool.Enabled() )
+        BodyPool.Acquire( static_cast<size_t>( length ), response.body );
+    else
+        response.body.reserve( response.body.size() + static_cast<size_t>( length ) );
+}
+
+/**
+ * @brief move the body received so far into a temporary file
+ *
+ * The rest of the body is appended to the file as it arrives and the
+ * buffer goes back to the pool or is freed.
+ *
+ * @param exchange whose response outgrew BodySettings::spillThreshold
+ *
+ * @return false if the file could not be created or written
+ */
+bool RestClient::SpillBody( RestClient::Exchange& exchange )
+{
+    RestClient::Response& response = exchange.response;
+
+    if( !response.bodyFile.Create( RestClient::Body.spillDirectory ) )
+        return false;
+
+    if( !response.bodyFile.Append( response.body.data(), response.body.size() ) )
+    {
+        response.bodyFile.Reset();
+        return false;
+    }
+
+    ReleaseBody( response.body );
+    std::string().swap( response.body );
+
+    RefundBudget( exchange );
+
+    return true;
+}
+
+/**
+ * @brief count a body growing in memory against BodySettings::bufferBudget
+ *
+ * Only the growth beyond what the exchange already holds is counted, a
+ * reservation covers the body that fills it.
+ *
+ * @param exchange whose body grows
+ * @param size the body is about to reach
+ *
+ * @return false if the budget has no room for it
+ */
+bool RestClient::ChargeBudget( RestClient::Exchange& exchange, size_t size )
+{
+    size_t budget = RestClient::Body.bufferBudget;
+
+    if( budget == 0 || size <= exchange.charged )
+        return true;
+
+    size_t growth = size - exchange.charged;
+
+    if( __sync_add_and_fetch( &BufferedBytes, growth ) > budget )
+    {
+        __sync_fetch_and_sub( &BufferedBytes, growth );
+        return false;
+    }
+
+    exchange.charged = size;
+
+    return true;
+}
+
+/**
+ * @brief stop counting the body of an exchange, once it is done or on disk
+ */
+void RestClient::RefundBudget( RestClient::Exchange& exchange )
+{
+    if( exchange.charged == 0 )
+        return;
+
+    __sync_fetch_and_sub( &BufferedBytes, exchange.charged );
+
+    exchange.charged = 0;
+}
+
+/**
+ * @brief hand the buffer of a destroyed response to the body pool
+ *
+ * @param body of the response
+ */
+void RestClient::ReleaseBody( std::string& body )
+{
+    // responses outliving the pool at exit free their body as usual
+    if( RestClientBodyPool::Closed() )
+        return;
+
+    BodyPool.Release( body );
+}
+
+/**
+ * @brief read callback function for libcurl
+ *
+ * @param pointer of max size (size*nmemb) to write data to
+ * @param size size parameter
+ * @param nmemb memblock parameter
+ * @param userdata pointer to user data to read data from
+ *
+ * @return (size * nmemb)
+ */
+size_t RestClient::CurlReadCallback( void *data, size_t size, size_t nmemb, void *userdata )
+{
+    // get upload struct
+    RestClient::UploadObject* u = reinterpret_cast<RestClient::UploadObject*>( userdata );
+
+    // set correct sizes
+    size_t curl_size = size * nmemb;
+    size_t copy_size = ( u->length < curl_size ) ? u->length : curl_size;
+    
+    // copy data to buffer
+    memcpy( data, u->data, copy_size );
+    
+    // decrement length and increment data pointer
+    u->length -= copy_size;
+    u->data   += copy_size;
+    
+    // return copied size
+    return copy_size;
+}
+
+/**
+ * @brief transfer information callback function for libcurl
+ *
+ */
+size_t RestClient::CurlTransferCallback( void *p, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow )
+{
+    RestClientTransferCallback* callback = (RestClientTransferCallback*)p;
+    int                         retValue = 0;
+    
+    if( callback != NULL )
+    {
+        retValue = callback->UpdateTransferInfo( dltotal, dlnow, ultotal, ulnow );
+    }
+    
+    return retValue;
+}
+
+/*========================
+         SESSIONS
+  ========================*/
+RestClientSession::RestClientSession() : pool( new RestClientHandlePool( Share ) ), userPassword(), userAgent( RestClient::kDefaultUserAgent ), headers(), limits()
+{
+}
+
+RestClientSession::~RestClientSession()
+{
+    delete pool;
+}
+
+void RestClientSession::ClearAuth()
+{
+    userPassword.clear();
+}
+
+void RestClientSession::SetAuth( const std::string& username, const std::string& password )
+{
+    userPassword = username + ":" + password;
+}
+
+/**
+ * @brief user agent for requests without a User-Agent header
+ */
+void RestClientSession::SetUserAgent( const std::string& userAgent )
+{
+    this->userAgent = userAgent;
+}
+
+/**
+ * @brief headers added to every request that does not set them itself
+ */
+void RestClientSession::SetDefaultHeaders( const RestClient::headermap& headers )
+{
+    this->headers = headers;
+}
+
+/**
+ * @brief limits of requests that do not set their own
+ */
+void RestClientSession::SetLimits( const RestClient::Limits& limits )
+{
+    this->limits = limits;
+}
+
+void RestClientSession::SetPoolSettings( const RestClient::PoolSettings& settings )
+{
+    pool->Configure( settings );
+}
+
+RestClient::PoolStatistics RestClientSession::GetPoolStatistics() const
+{
+    return pool->Statistics();
+}
+
+RestClient::Response RestClientSession::Get( const RestClient::Request& request ) const
+{
+    return RestClient::CurlSharedGet( *this, request, NULL, NULL );
+}
+
+/**
+ * @brief HTTP GET method streaming the body into a sink
+ *
+ * @param request to query
+ * @param sink receiving the body, bodies it declines stay in the response
+ *
+ * @return response struct
+ */
+RestClient::Response RestClientSession::Get( const RestClient::Request& request, RestClientBodySink* sink ) const
+{
+    return RestClient::CurlSharedGet( *this, request, sink, NULL );
+}
+
+/**
+ * @brief HTTP POST method
+ *
+ * @param request to query
+ * @param form to post
+ *
+ * @return response struct
+ */
+RestClient::Response RestClientSession::Post( const RestClient::Request& request, const std::map<std::string, RestClient::FormItem>& form ) const
+{
+    RestClient::Response response;
+    RestClient::Exchange exchange( response );
+
+    if( RestClient::CurlSharedEasyInit( *this, request, true, exchange ) )
+        RestClient::CurlSharedPost( request.url.c_str(), RestClient::CurlFormBuild( form ), exchange );
+
+    return response;
+}
+
+/**
+ * @brief download to a file, in concurrent byte ranges where the server allows it
+ *
+ * @param request to query
+ * @param path of the file, created or truncated
+ * @param options number and minimum size of the ranges
+ * @param info receiving the progress of all ranges together, NULL for none
+ *
+ * @return headers of the object with an empty body, or the response that failed
+ */
+RestClient::Response RestClientSession::Download( const RestClient::Request& request, const std::string& path, const RestClient::DownloadOptions& options, const RestClientTransferCallback* info ) const
+{
+    return RestClient::CurlSharedDownload( *this, request, path, options, info );
+}
+
+bool RestClientSession::GetAsync( const RestClient::Request& request, RestClientCompletionCallback* callback ) const
+{
+    return GetAsync( request, NULL, callback );
+}
+
+/**
+ * @brief asynchronous HTTP GET method streaming the body into a sink
+ *
+ * @param request to query
+ * @param sink receiving the body on the I/O thread, NULL keeps it in the response
+ * @param callback called on the I/O thread once the transfer finished, NULL for none
+ *
+ * @return true if the request was queued, the callback is not called otherwise
+ */
+bool RestClientSession::GetAsync( const RestClient::Request& request, RestClientBodySink* sink, RestClientCompletionCallback* callback ) const
+{
+    RestClient::Transfer* transfer = new RestClient::Transfer( callback );
+
+    if( !RestClient::CurlSharedEasyInit( *this, request, false, transfer->exchange ) )
+    {
+        delete transfer;
+        return false;
+    }
+
+    return RestClient::CurlSharedAsync( request.url.c_str(), NULL, sink, transfer );
+}
+
+/**
+ * @brief asynchronous HTTP POST method
+ *
+ * @param request to query
+ * @param form to post
+ * @param callback called on the I/O thread once the transfer finished, NULL for none
+ *
+ * @return true if the request was queued, the callback is not called otherwise
+ */
+bool RestClientSession::PostAsync( const RestClient::Request& request, const std::map<std::string, RestClient::FormItem>& form, RestClientCompletionCallback* callback ) const
+{
+    RestClient::Transfer* transfer = new RestClient::Transfer( callback );
+
+    if( !RestClient::CurlSharedEasyInit( *this, request, false, transfer->exchange ) )
+    {
+        delete transfer;
+        return false;
+    }
+
+    return RestClient::CurlSharedAsync( request.url.c_str(), RestClient::CurlFormBuild( form ), NULL, transfer );
+}
+
+/**
+ * @brief HTTP GET method on borrowed buffers
+ *
+ * @param url to query, need not be NUL terminated
+ * @param urlLength length of url
+ * @param headers to send, read during the call only
+ * @param headerCount number of headers
+ *
+ * @return response struct
+ */
+RestClient::Response RestClientSession::Get( const char* url, size_t urlLength, const RestClient::HeaderField* headers, size_t headerCount ) const
+{
+    RestClient::Response response;
+    RestClient::Exchange exchange( response );
+    RestClientCString    target( url, urlLength );
+
+    if( RestClient::CurlSharedEasyInit( *this, target.Get(), headers, headerCount, true, exchange ) )
+        RestClient::CurlSharedGet( target.Get(), NULL, NULL, exchange );
+
+    return response;
+}
+
+/**
+ * @brief HTTP POST method on borrowed buffers
+ *
+ * @param url to query, need not be NUL terminated
+ * @param urlLength length of url
+ * @param headers to send, read during the call only
+ * @param headerCount number of headers
+ * @param form items to post, read during the call only
+ * @param formCount number of form items
+ *
+ * @return response struct
+ */
+RestClient::Response RestClientSession::Post( const char* url, size_t urlLength, const RestClient::HeaderField* headers, size_t headerCount, const RestClient::FormField* form, size_t formCount ) const
+{
+    RestClient::Response response;
+    RestClient::Exchange exchange( response );
+    RestClientCString    target( url, urlLength );
+
+    if( RestClient::CurlSharedEasyInit( *this, target.Get(), headers, headerCount, true, exchange ) )
+        RestClient::CurlSharedPost( target.Get(), RestClient::CurlFormBuild( form, formCount ), exchange );
+
+    return response;
+}
+
+/**
+ * @brief asynchronous HTTP GET method on borrowed buffers
+ *
+ * The buffers may be reused as soon as the call returns.
+ *
+ * @param url to query, need not be NUL terminated
+ * @param urlLength length of url
+ * @param headers to send
+ * @param headerCount number of headers
+ * @param callback called on the I/O thread once the transfer finished, NULL for none
+ *
+ * @return true if the request was queued, the callback is not called otherwise
+ */
+bool RestClientSession::GetAsync( const char* url, size_t urlLength, const RestClient::HeaderField* headers, size_t headerCount, RestClientCompletionCallback* callback ) const
+{
+    RestClient::Transfer* transfer = new RestClient::Transfer( callback );
+    RestClientCString     target( url, urlLength );
+
+    if( !RestClient::CurlSharedEasyInit( *this, target.Get(), headers, headerCount, false, transfer->exchange ) )
+    {
+        delete transfer;
+        return false;
+    }
+
+    return RestClient::CurlSharedAsync( target.Get(), NULL, NULL, transfer );
+}
+
+std::vector<RestClient::Response> RestClientSession::Perform( const std::vector<RestClient::Request>& requests ) const
+{
+    return Perform( requests, RestClient::BatchOptions() );
+}
+
+/**
+ * @brief run a batch of HTTP GET requests concurrently
+ *
+ * All transfers share the multi handle of the asynchronous engine. The
+ * streaming callback, if any, runs on the calling thread.
+ *
+ * @param requests to query
+ * @param options parallelism cap and streaming callback
+ *
+ * @return responses in the order of the requests
+ */
+std::vector<RestClient::Response> RestClientSession::Perform( const std::vector<RestClient::Request>& requests, const RestClient::BatchOptions& options ) const
+{
+    RestClientBatch     batch( requests.size() );
+    std::vector<size_t> indices;
+    size_t              limit     = options.maxParallel > 0 ? options.maxParallel : requests.size();
+    size_t              next      = 0;
+    size_t              inFlight  = 0;
+    size_t              remaining = requests.size();
+
+    while( remaining > 0 )
+    {
+        while( next < requests.size() && inFlight < limit )
+        {
+            if( GetAsync( requests[next], &batch.slots[next] ) )
+            {
+                inFlight++;
+            }
+            else
+            {
+                RestClient::Response failed;
+
+                failed.body = "Failed to query.";
+                failed.code = -1;
+
+                batch.Complete( next, failed );
+
+                inFlight++;
+            }
+
+            next++;
+        }
+
+        batch.WaitCompleted( indices );
+
+        for( size_t i = 0; i < indices.size(); i++ )
+        {
+            if( options.callback != NULL )
+                options.callback->OnResponse( indices[i], batch.results[indices[i]] );
+        }
+
+        inFlight  -= indices.size();
+        remaining -= indices.size();
+
+        indices.clear();
+    }
+
+    // returning the member would copy every body
+    std::vector<RestClient::Response> results;
+
+    results.swap( batch.results );
+
+    return results;
+}
+
+/*========================
+         DOWNLOADS
+  ========================*/
+// bytes received between two saves of a resumable download's checkpoint
+static const unsigned long long kCheckpointInterval = 8 * 1024 * 1024;
+
+/**
+ * Progress of a segmented download summed over its ranges. The ranges all
+ * run on the I/O thread, one chunk at a time, so Add only counts; the
+ * thread waiting for the download saves the checkpoint when woken.
+ */
+class RestClientDownloadProgress
+{
+public:
+    RestClientDownloadProgress( const RestClientTransferCallback* callback, unsigned long long total, unsigned long long received, RestClientBatch* checkpoint ) :
+        callback( callback ), total( total ), received( received ), unsaved( 0 ), checkpoint( checkpoint )
+    {}
+
+    /**
+     * @return false if the callback asks to abort
+     */
+    bool Add( size_t length )
+    {
+        received += length;
+        unsaved  += length;
+
+        if( checkpoint != NULL && unsaved >= kCheckpointInterval )
+        {
+            unsaved = 0;
+            checkpoint->Wake();
+        }
+
+        if( callback == NULL )
+            return true;
+
+        return const_cast<RestClientTransferCallback*>( callback )->UpdateTransferInfo( static_cast<long>( total ), static_cast<long>( received ), 0, 0 ) == 0;
+    }
+
+private:
+    const RestClientTransferCallback* callback;
+    unsigned long long                total;
+    unsigned long long                received;
+    unsigned long long                unsaved;     // bytes since the last wake up
+    RestClientBatch*                  checkpoint;  // woken to save the checkpoint, NULL unless the download is resumable
+};
+
+/**
+ * Writes one range of a segmented download at its offset in the file,
+ * continuing after the bytes it already holds. A response that is not the
+ * requested range, because the object changed or the server ignored the
+ * Range header, is rejected and aborted.
+ */
+class RestClientRangeSink : public RestClientBodySink
+{
+public:
+    RestClientRangeSink() : fd( -1 ), first( 0 ), length( 0 ), received( 0 ), rejected( false ), progress( NULL )
+    {}
+
+    virtual bool OnHeaders( const RestClient::Response& response )
+    {
+        RestClientHeaders::Field field;
+        unsigned long long       start = 0;
+
+        // error bodies stay in the response
+        if( response.code < 200 || response.code >= 300 )
+            return false;
+
+        rejected = response.code != 206 || !response.headers.Find( RestClientHeaders::kContentRange, field ) ||
+                   field.valueLength < 6 || strncasecmp( field.value, "bytes ", 6 ) != 0 ||
+                   !RestClientParseNumber( field.value + 6, field.valueLength - 6, start, NULL ) || start != first + received;
+
+        return true;
+    }
+
+    virtual bool OnData( const char* data, size_t size )
+    {
+        if( rejected || received + size > length )
+            return false;
+
+        while( size > 0 )
+        {
+            ssize_t written = pwrite( fd, data, size, static_cast<off_t>( first + received ) );
+
+            if( written < 0 )
+            {
+                if( errno == EINTR )
+                    continue;
+
+                return false;
+            }
+
+            data += written;
+            size -= written;
+
+            // the waiting thread snapshots it for the checkpoint
+            __sync_fetch_and_add( &received, written );
+
+            if( !progress->Add( written ) )
+                return false;
+        }
+
+        return true;
+    }
+
+    bool Complete() const
+    {
+        return !rejected && received == length;
+    }
+
+    int                         fd;
+    unsigned long long          first;
+    unsigned long long          length;
+    unsigned long long          received;  // bytes of the range in the file, updated atomically
+    bool                        rejected;
+    RestClientDownloadProgress* progress;
+};
+
+/**
+ * Sidecar of a resumable download, kept next to the file as path.resume.
+ * It records the validator and length of the object and how much of each
+ * range the file holds. The file data is synced before the sidecar is
+ * replaced through a rename, so the sidecar never claims bytes the file
+ * may not hold; bytes received after the last save are fetched again.
+ * Saving syncs to disk, it runs on the thread waiting for the download,
+ * never on the I/O thread.
+ */
+class RestClientDownloadCheckpoint
+{
+public:
+    RestClientDownloadCheckpoint( const std::string& file, int fd, const std::string& validator, unsigned long long length, std::vector<RestClientRangeSink>& sinks ) :
+        path( file + ".resume" ), fd( fd ), validator( validator ), length( length ), sinks( sinks )
+    {}
+
+    /**
+     * @brief take the ranges of an earlier attempt at the same object
+     *
+     * @return false if there is no sidecar or it belongs to another version
+     */
+    bool Load()
+    {
+        std::ifstream      file( path.c_str() );
+        std::string        line;
+        unsigned long long savedLength = 0;
+        std::string        savedValidator;
+        bool               versioned   = false;
+
+        sinks.clear();
+
+        while( std::getline( file, line ) )
+        {
+            RestClientRangeSink range;
+
+            if( line == "restclient-download 1" )
+                versioned = true;
+            else if( line.compare( 0, 10, "validator " ) == 0 )
+                savedValidator = line.substr( 10 );
+            else if( sscanf( line.c_str(), "length %llu", &savedLength ) == 1 )
+                continue;
+            else if( sscanf( line.c_str(), "range %llu %llu %llu", &range.first, &range.length, &range.received ) == 3 && range.received <= range.length )
+                sinks.push_back( range );
+        }
+
+        if( !versioned || savedValidator != validator || savedLength != length || sinks.empty() )
+        {
+            sinks.clear();
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief record the ranges, also while they still run
+     */
+    void Save()
+    {
+        std::string temporary = path + ".tmp";
+        std::string content   = "restclient-download 1\nvalidator " + validator + "\n";
+        char        line[128];
+
+        snprintf( line, sizeof( line ), "length %llu\n", length );
+        content += line;
+
+        for( size_t i = 0; i < sinks.size(); i++ )
+        {
+            // snapshot before the sync below, bytes counted are already written
+            snprintf( line, sizeof( line ), "range %llu %llu %llu\n", sinks[i].first, sinks[i].length, __sync_fetch_and_add( &sinks[i].received, 0 ) );
+            content += line;
+        }
+
+        if( fdatasync( fd ) != 0 )
+            return;
+
+        int out = open( temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+
+        if( out < 0 )
+            return;
+
+        bool written = write( out, content.data(), content.size() ) == static_cast<ssize_t>( content.size() ) && fdatasync( out ) == 0;
+
+        close( out );
+
+        if( !written || rename( temporary.c_str(), path.c_str() ) != 0 )
+            unlink( temporary.c_str() );
+    }
+
+    void Remove()
+    {
+        unlink( path.c_str() );
+    }
+
+private:
+    std::string                       path;
+    int                               fd;
+    std::string                       validator;
+    unsigned long long                length;
+    std::vector<RestClientRangeSink>& sinks;
+};
+
+/**
+ * @brief HTTP HEAD of a request, the probe of a download
+ */
+RestClient::Response RestClient::CurlSharedHead( const RestClientSession& session, const RestClient::Request& request )
+{
+    RestClient::Response response;
+    RestClient::Exchange exchange( response );
+
+    if( CurlSharedEasyInit( session, request, true, exchange ) )
+    {
+        // options do not outlive the transfer, handles are reset on their way back
+        curl_easy_setopt( exchange.curl, CURLOPT_NOBODY, 1L );
+
+        CurlSharedEasyComplete( CurlSharedEasyPerform( request.url.c_str(), exchange ), exchange );
+        CurlSharedEasyCleanUp( exchange );
+    }
+
+    return response;
+}
+
+/**
+ * @brief download to a file, in concurrent byte ranges where the server allows it
+ *
+ * A HEAD request probes the object. If it announces its length and
+ * Accept-Ranges: bytes, the file is preallocated and the object fetched
+ * in up to DownloadOptions::segments ranges at once, each written at its
+ * offset. The ranges carry If-Range with the validator of the probe, so
+ * an object that changes in between comes back whole; that, a server
+ * ignoring Range, or an object too small to split fall back to one
+ * stream through a RestClientMappedFileSink.
+ *
+ * A resumable download keeps its ranges in a checkpoint next to the file.
+ * A later call for an object with the same validator and length only
+ * fetches what the checkpoint does not cover, the checkpoint is removed
+ * once the file is complete.
+ *
+ * Ranges run as asynchronous transfers, so they open separate
+ * connections within the scheduler limits, or share one with HTTP/2, and
+ * report progress on the I/O thread.
+ *
+ * @param session providing handles, credentials and defaults
+ * @param request to query
+ * @param path of the file, created or truncated unless resumed
+ * @param options number and minimum size of the ranges, resuming
+ * @param info receiving the progress of all ranges together, NULL for none
+ *
+ * @return headers of the object with an empty body, or the response that failed
+ */
+RestClient::Response RestClient::CurlSharedDownload( const RestClientSession& session, const RestClient::Request& request, const std::string& path, const RestClient::DownloadOptions& options, const RestClientTransferCallback* info )
+{
+    RestClient::Response     probe     = CurlSharedHead( session, request );
+    RestClientHeaders::Field field;
+    unsigned long long       length    = 0;
+    size_t                   segments  = 0;
+    bool                     resumable = false;
+    std::string              validator;
+    int                      fd        = -1;
+
+    if( probe.code >= 200 && probe.code < 300 && probe.headers.Find( RestClientHeaders::kAcceptRanges, field ) &&
+        field.valueLength == 5 && strncasecmp( field.value, "bytes", 5 ) == 0 && RestClientContentLength( probe.headers, length ) && length > 0 )
+    {
+        segments = static_cast<size_t>( std::min<unsigned long long>( options.segments, length / std::max<size_t>( options.minSegmentSize, 1 ) ) );
+
+        // a weak ETag cannot be used with If-Range
+        if( probe.headers.Find( RestClientHeaders::kETag, field ) && !( field.valueLength > 2 && strncmp( field.value, "W/", 2 ) == 0 ) )
+            validator.assign( field.value, field.valueLength );
+        else if( probe.headers.Find( RestClientHeaders::kLastModified, field ) )
+            validator.assign( field.value, field.valueLength );
+
+        // bytes already in the file can only be trusted against a validator, one range still resumes
+        resumable = options.resumable && !validator.empty();
+
+        if( resumable )
+            segments = std::max<size_t>( segments, 1 );
+    }
+
+    if( segments >= 2 || resumable )
+        fd = open( path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644 );
+
+    if( fd < 0 )
+    {
+        RestClientMappedFileSink sink( path );
+
+        if( options.resumable )
+            unlink( ( path + ".resume" ).c_str() );
+
+        return CurlSharedGet( session, request, &sink, info );
+    }
+
+    std::vector<RestClientRangeSink> sinks;
+    RestClientDownloadCheckpoint     checkpoint( path, fd, validator, length, sinks );
+    struct stat                      status;
+    bool                             resumed = resumable && checkpoint.Load() && fstat( fd, &status ) == 0 && static_cast<unsigned long long>( status.st_size ) == length;
+
+    if( !resumed )
+    {
+        unsigned long long size = length / segments;
+
+        if( ftruncate( fd, 0 ) != 0 )
+            segments = 0;
+
+        int result = posix_fallocate( fd, 0, static_cast<off_t>( length ) );
+
+        if( segments == 0 || result == ENOSPC || result == EFBIG )
+        {
+            close( fd );
+
+            probe.body = "Failed to query.";
+            probe.code = RestClient::kFailed;
+
+            return probe;
+        }
+
+        sinks.assign( segments, RestClientRangeSink() );
+
+        for( size_t i = 0; i < segments; i++ )
+        {
+            sinks[i].first  = i * size;
+            sinks[i].length = ( i + 1 == segments ) ? length - sinks[i].first : size;
+        }
+
+        if( resumable )
+            checkpoint.Save();
+    }
+
+    unsigned long long done = 0;
+
+    for( size_t i = 0; i < sinks.size(); i++ )
+        done += sinks[i].received;
+
+    RestClientBatch            batch( sinks.size() );
+    RestClientDownloadProgress progress( info, length, done, resumable ? &batch : NULL );
+    RestClient::Request        segment   = request;
+    std::vector<size_t>        indices;
+    size_t                     remaining = 0;
+
+    if( !validator.empty() )
+        segment.headers["If-Range"] = validator;
+
+    for( size_t i = 0; i < sinks.size(); i++ )
+    {
+        char range[64];
+
+        sinks[i].fd       = fd;
+        sinks[i].progress = &progress;
+
+        if( sinks[i].received == sinks[i].length )
+            continue;
+
+        snprintf( range, sizeof( range ), "bytes=%llu-%llu", sinks[i].first + sinks[i].received, sinks[i].first + sinks[i].length - 1 );
+        segment.headers["Range"] = range;
+
+        remaining++;
+
+        if( !session.GetAsync( segment, &sinks[i], &batch.slots[i] ) )
+        {
+            RestClient::Response failed;
+
+            failed.body = "Failed to query.";
+            failed.code = RestClient::kFailed;
+
+            batch.Complete( i, failed );
+        }
+    }
+
+    while( remaining > 0 )
+    {
+        batch.WaitCompleted( indices );
+
+        remaining -= indices.size();
+
+        indices.clear();
+
+        // a range ended or the progress woke us, the I/O thread never syncs
+        if( resumable && remaining > 0 )
+            checkpoint.Save();
+    }
+
+    bool rejected = false;
+
+    for( size_t i = 0; i < sinks.size(); i++ )
+    {
+        if( sinks[i].Complete() )
+            continue;
+
+        if( !sinks[i].rejected )
+        {
+            if( resumable )
+                checkpoint.Save();
+
+            close( fd );
+
+            batch.results[i].swap( probe );
+            return probe;
+        }
+
+        rejected = true;
+    }
+
+    close( fd );
+
+    if( resumable )
+        checkpoint.Remove();
+
+    if( rejected )
+    {
+        RestClientMappedFileSink sink( path );
+
+        return CurlSharedGet( session, request, &sink, info );
+    }
+
+    return probe;
+}
+
+/*========================
+     PREPARED REQUESTS
+  ========================*/
+/**
+ * @brief compile the headers and credentials of a request
+ *
+ * @param request whose URL is the default of every call
+ */
+RestClientPreparedRequest::RestClientPreparedRequest( const RestClient::Request& request ) : url(), pool( NULL ), headerList( NULL ), userAgent(), userPassword(), limits()
+{
+    Compile( DefaultSession, request );
+}
+
+/**
+ * @brief compile a request against the defaults of a session
+ *
+ * @param session providing handles, credentials and defaults
+ * @param request whose URL is the default of every call
+ */
+RestClientPreparedRequest::RestClientPreparedRequest( const RestClientSession& session, const RestClient::Request& request ) : url(), pool( NULL ), headerList( NULL ), userAgent(), userPassword(), limits()
+{
+    Compile( session, request );
+}
+
+RestClientPreparedRequest::~RestClientPreparedRequest()
+{
+    if( headerList != NULL )
+        curl_slist_free_all( headerList );
+}
+
+void RestClientPreparedRequest::Compile( const RestClientSession& session, const RestClient::Request& request )
+{
+    url          = request.url;
+    pool         = session.pool;
+    headerList   = RestClient::CurlHeaderList( session.headers, request.headers );
+    userPassword = session.userPassword;
+    limits       = RestClientLimits( session.limits, request.limits );
+
+    if( request.headers.find( "User-Agent" ) == request.headers.end() && session.headers.find( "User-Agent" ) == session.headers.end() )
+        userAgent = session.userAgent;
+}
+
+/**
+ * @brief change the URL used by the calls without one
+ */
+void RestClientPreparedRequest::SetUrl( const std::string& url )
+{
+    this->url = url;
+}
+
+const std::string& RestClientPreparedRequest::Url() const
+{
+    return url;
+}
+
+RestClient::Response RestClientPreparedRequest::Get() const
+{
+    return Get( url, NULL );
+}
+
+RestClient::Response RestClientPreparedRequest::Get( const std::string& url ) const
+{
+    return Get( url, NULL );
+}
+
+/**
+ * @brief HTTP GET with the prepared headers
  *
  * @param url to query
+ * @param sink receiving the body, NULL keeps it in the response
  *
  * @return response struct
  */
-//RestClient::response RestClient::del(const std::string& url)
-//{
-//  /** create return struct */
-//  RestClient::response ret = RestClient::response();
-//
-//  /** we want HTTP DELETE */
-//  const char* http_delete = "DELETE";
-//
-//  // use libcurl
-//  CURL *curl = NULL;
-//  CURLcode res = CURLE_OK;
-//    
-//  curl = curl_easy_init();
-//  if (curl)
-//  {
-//    /** set basic authentication if present*/
-//    if(RestClient::user_pass.length()>0){
-//      curl_easy_setopt(curl, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
-//      curl_easy_setopt(curl, CURLOPT_USERPWD, RestClient::user_pass.c_str());
-//    }
-//      
-//    if(RestClient::cookies.length()>0){
-//      curl_easy_setopt(curl, CURLOPT_COOKIE, RestClient::cookies.c_str());
-//    }
-//
-//    /** set user agent */
-//    curl_easy_setopt(curl, CURLOPT_USERAGENT, RestClient::user_agent);
-//    /** set query URL */
-//    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-//    /** set HTTP DELETE METHOD */
-//    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, http_delete);
-//    /** set callback function */
-//    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, RestClient::CurlWriteCallback);
-//    /** set data object to pass to callback function */
-//    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &ret);
-//    /** set the header callback function */
-//    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, RestClient::CurlHeaderCallback);
-//    /** callback object for headers */
-//    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &ret);
-//    /** perform the actual query */
-//    res = curl_easy_perform(curl);
-//    if (res != CURLE_OK)
-//    {
-//      ret.body = "Failed to query.";
-//      ret.code = -1;
-//      return ret;
-//    }
-//    long http_code = 0;
-//    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-//    ret.code = static_cast<int>(http_code);
-//
-//    curl_easy_cleanup(curl);
-//    curl_global_cleanup();
-//  }
-//
-//  return ret;
-//}
+RestClient::Response RestClientPreparedRequest::Get( const std::string& url, RestClientBodySink* sink ) const
+{
+    RestClient::Response response;
+    RestClient::Exchange exchange( response );
+
+    exchange.limits = limits;
+
+    if( RestClient::CurlSharedEasyInit( *pool, url.c_str(), headerList, userAgent.empty() ? NULL : userAgent.c_str(), userPassword, exchange ) )
+        RestClient::CurlSharedGet( url.c_str(), sink, NULL, exchange );
+
+    return response;
+}
+
+RestClient::Response RestClientPreparedRequest::Post( const std::map<std::string, RestClient::FormItem>& form ) const
+{
+    return Post( url, form );
+}
 
 /**
- * @brief write callback function for libcurl
+ * @brief HTTP POST with the prepared headers
  *
- * @param data returned data of size (size*nmemb)
- * @param size size parameter
- * @param nmemb memblock parameter
- * @param userdata pointer to user data to save/work with return data
+ * @param url to query
+ * @param form to post
  *
- * @return (size * nmemb)
+ * @return response struct
  */
-size_t RestClient::CurlWriteCallback( void *data, size_t size, size_t nmemb, void *userdata )
+RestClient::Response RestClientPreparedRequest::Post( const std::string& url, const std::map<std::string, RestClient::FormItem>& form ) const
 {
-    RestClient::Response* response    = reinterpret_cast<RestClient::Response*>( userdata );
-    long                  httpCode    = 0;
-    char*                 contentType = NULL;
-    
-    curl_easy_getinfo( response->curl, CURLINFO_RESPONSE_CODE, &httpCode    );
-    //curl_easy_getinfo( response->curl, CURLINFO_CONTENT_TYPE , &contentType );
+    RestClient::Response response;
+    RestClient::Exchange exchange( response );
 
-    if( response->file != NULL && httpCode == 200 )
-    {
-        response->file->write( reinterpret_cast<char*>( data ), size * nmemb );
-    }
-    else
+    exchange.limits = limits;
+
+    if( RestClient::CurlSharedEasyInit( *pool, url.c_str(), headerList, userAgent.empty() ? NULL : userAgent.c_str(), userPassword, exchange ) )
+        RestClient::CurlSharedPost( url.c_str(), RestClient::CurlFormBuild( form ), exchange );
+
+    return response;
+}
+
+bool RestClientPreparedRequest::GetAsync( RestClientCompletionCallback* callback ) const
+{
+    return GetAsync( url, NULL, callback );
+}
+
+/**
+ * @brief asynchronous HTTP GET with the prepared headers
+ *
+ * @param url to query
+ * @param sink receiving the body on the I/O thread, NULL keeps it in the response
+ * @param callback called on the I/O thread once the transfer finished, NULL for none
+ *
+ * @return true if the request was queued, the callback is not called otherwise
+ */
+bool RestClientPreparedRequest::GetAsync( const std::string& url, RestClientBodySink* sink, RestClientCompletionCallback* callback ) const
+{
+    RestClient::Transfer* transfer = new RestClient::Transfer( callback );
+
+    transfer->exchange.limits = limits;
+
+    if( !RestClient::CurlSharedEasyInit( *pool, url.c_str(), headerList, userAgent.empty() ? NULL : userAgent.c_str(), userPassword, transfer->exchange ) )
     {
-        response->body.append( reinterpret_cast<char*>( data ), size * nmemb );
+        delete transfer;
+        return false;
     }
 
-    return ( size * nmemb );
+    return RestClient::CurlSharedAsync( url.c_str(), NULL, sink, transfer );
 }
 
 /**
- * @brief header callback for libcurl
+ * @brief asynchronous HTTP POST with the prepared headers
  *
- * @param data returned (header line)
- * @param size of data
- * @param nmemb memblock
- * @param userdata pointer to user data object to save headr data
- * @return size * nmemb;
+ * @param url to query
+ * @param form to post
+ * @param callback called on the I/O thread once the transfer finished, NULL for none
+ *
+ * @return true if the request was queued, the callback is not called otherwise
  */
-size_t RestClient::CurlHeaderCallback( void *data, size_t size, size_t nmemb, void *userdata )
+bool RestClientPreparedRequest::PostAsync( const std::string& url, const std::map<std::string, RestClient::FormItem>& form, RestClientCompletionCallback* callback ) const
 {
-    std::string           header( reinterpret_cast<char*>( data ), size * nmemb );
-    RestClient::Response* r         = reinterpret_cast<RestClient::Response*>( userdata );
-    size_t                seperator = header.find_first_of(":");
+    RestClient::Transfer* transfer = new RestClient::Transfer( callback );
 
-    if ( std::string::npos == seperator )
-    {
-        // roll with non seperated headers...
-        trim( header );
-        if ( 0 == header.length() )
-            return ( size * nmemb ); // blank line
+    transfer->exchange.limits = limits;
 
-        r->headers[header] = "present";
+    if( !RestClient::CurlSharedEasyInit( *pool, url.c_str(), headerList, userAgent.empty() ? NULL : userAgent.c_str(), userPassword, transfer->exchange ) )
+    {
+        delete transfer;
+        return false;
     }
-    else
+
+    return RestClient::CurlSharedAsync( url.c_str(), RestClient::CurlFormBuild( form ), NULL, transfer );
+}
+
+/*========================
+         BODY SINKS
+  ========================*/
+RestClientStringSink::RestClientStringSink( std::string& target ) : target( target )
+{
+}
+
+bool RestClientStringSink::OnData( const char* data, size_t length )
+{
+    target.append( data, length );
+
+    return true;
+}
+
+RestClientStreamSink::RestClientStreamSink( std::ostream& stream ) : stream( stream )
+{
+}
+
+bool RestClientStreamSink::OnHeaders( const RestClient::Response& response )
+{
+    return response.code >= 200 && response.code < 300;
+}
+
+bool RestClientStreamSink::OnData( const char* data, size_t length )
+{
+    stream.write( data, length );
+
+    return stream.good();
+}
+
+void RestClientStreamSink::OnComplete( const RestClient::Response& /* response */ )
+{
+    stream.flush();
+}
+
+RestClientFdSink::RestClientFdSink( int fd ) : fd( fd )
+{
+}
+
+bool RestClientFdSink::OnHeaders( const RestClient::Response& response )
+{
+    return response.code >= 200 && response.code < 300;
+}
+
+bool RestClientFdSink::OnData( const char* data, size_t length )
+{
+    while( length > 0 )
     {
-        std::string key   = header.substr( 0, seperator );
+        ssize_t written = write( fd, data, length );
 
-        trim(key);
-        std::string value = header.substr( seperator + 1 );
+        if( written < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+
+            return false;
+        }
 
-        trim (value);
-        r->headers[key] = value;
+        data   += written;
+        length -= written;
     }
 
-    return ( size * nmemb );
+    return true;
+}
+
+// pwrite bodies of unknown length in pieces this large
+static const size_t kMappedSinkFlushSize = 1024 * 1024;
+
+RestClientMappedFileSink::RestClientMappedFileSink( const std::string& path ) : path( path ), fd( -1 ), map( NULL ), mapLength( 0 ), written( 0 ), flushed( 0 ), pending(), failed( false )
+{
+}
+
+RestClientMappedFileSink::~RestClientMappedFileSink()
+{
+    Close();
 }
 
 /**
- * @brief read callback function for libcurl
- *
- * @param pointer of max size (size*nmemb) to write data to
- * @param size size parameter
- * @param nmemb memblock parameter
- * @param userdata pointer to user data to read data from
- *
- * @return (size * nmemb)
+ * @brief open the file for a 2xx body and reserve its announced length
  */
-size_t RestClient::CurlReadCallback( void *data, size_t size, size_t nmemb, void *userdata )
+bool RestClientMappedFileSink::OnHeaders( const RestClient::Response& response )
 {
-    // get upload struct
-    RestClient::UploadObject* u = reinterpret_cast<RestClient::UploadObject*>( userdata );
+    unsigned long long length = 0;
 
-    // set correct sizes
-    size_t curl_size = size * nmemb;
-    size_t copy_size = ( u->length < curl_size ) ? u->length : curl_size;
-    
-    // copy data to buffer
-    memcpy( data, u->data, copy_size );
-    
-    // decrement length and increment data pointer
-    u->length -= copy_size;
-    u->data   += copy_size;
-    
-    // return copied size
-    return copy_size;
+    if( response.code < 200 || response.code >= 300 )
+        return false;
+
+    Close();
+
+    fd = open( path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+
+    if( fd < 0 )
+    {
+        failed = true;
+        return true;
+    }
+
+    if( !RestClientContentLength( response.headers, length ) || length == 0 || length > static_cast<size_t>( -1 ) )
+        return true;
+
+    int result = posix_fallocate( fd, 0, static_cast<off_t>( length ) );
+
+    // a body that cannot fit aborts on its first chunk, without support it is written as it comes
+    if( result == ENOSPC || result == EFBIG )
+    {
+        failed = true;
+        return true;
+    }
+
+    if( result != 0 )
+        return true;
+
+    void* mapping = mmap( NULL, static_cast<size_t>( length ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+    if( mapping == MAP_FAILED )
+        return true;
+
+    madvise( mapping, static_cast<size_t>( length ), MADV_SEQUENTIAL );
+
+    map       = static_cast<char*>( mapping );
+    mapLength = static_cast<size_t>( length );
+
+    return true;
+}
+
+bool RestClientMappedFileSink::OnData( const char* data, size_t length )
+{
+    if( failed )
+        return false;
+
+    // bytes past the announced length go the buffered way
+    if( map != NULL && written < mapLength )
+    {
+        size_t copied = std::min( length, mapLength - written );
+
+        memcpy( map + written, data, copied );
+
+        data    += copied;
+        length  -= copied;
+        written += copied;
+        flushed  = written;
+    }
+
+    if( length == 0 )
+        return true;
+
+    pending.append( data, length );
+    written += length;
+
+    return pending.size() < kMappedSinkFlushSize || Flush();
 }
 
 /**
- * @brief transfer information callback function for libcurl
- *
+ * @brief write what is left and trim the file to the bytes received
  */
-size_t RestClient::CurlTransferCallback( void *p, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow )
+void RestClientMappedFileSink::OnComplete( const RestClient::Response& /* response */ )
 {
-    RestClientTransferCallback* callback = (RestClientTransferCallback*)p;
-    int                         retValue = 0;
-    
-    if( callback != NULL )
+    if( fd < 0 )
+        return;
+
+    Flush();
+
+    if( map != NULL )
     {
-        retValue = callback->UpdateTransferInfo( dltotal, dlnow, ultotal, ulnow );
+        munmap( map, mapLength );
+        map = NULL;
     }
-    
-    return retValue;
+
+    if( flushed != mapLength )
+    {
+        if( ftruncate( fd, static_cast<off_t>( flushed ) ) != 0 )
+            failed = true;
+    }
+
+    written = flushed;
+
+    close( fd );
+    fd = -1;
+}
+
+bool RestClientMappedFileSink::Mapped() const
+{
+    return mapLength > 0;
+}
+
+size_t RestClientMappedFileSink::Written() const
+{
+    return written;
+}
+
+bool RestClientMappedFileSink::Flush()
+{
+    const char* data = pending.data();
+    size_t      left = pending.size();
+
+    while( left > 0 )
+    {
+        ssize_t count = pwrite( fd, data, left, static_cast<off_t>( flushed ) );
+
+        if( count < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+
+            return false;
+        }
+
+        data    += count;
+        left    -= count;
+        flushed += count;
+    }
+
+    pending.clear();
+
+    return true;
+}
+
+void RestClientMappedFileSink::Close()
+{
+    if( map != NULL )
+        munmap( map, mapLength );
+
+    if( fd >= 0 )
+        close( fd );
+
+    fd        = -1;
+    map       = NULL;
+    mapLength = 0;
+    written   = 0;
+    flushed   = 0;
+    failed    = false;
+
+    pending.clear();
+}
+
+RestClientCallbackSink::RestClientCallbackSink( RestClientCallbackSink::DataFunction function, void* userdata ) : function( function ), userdata( userdata )
+{
+}
+
+bool RestClientCallbackSink::OnData( const char* data, size_t length )
+{
+    return function( data, length, userdata );
 }
@@ -0,0 +1,425 @@
+/**
+ * @file scheduler.cpp
+ * @brief implementation of the per host request scheduler
+ */
+
+/*========================
+         INCLUDES
+  ========================*/
+#include "scheduler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <strings.h>
+#include <time.h>
+
+// hosts remembered for the statistics once nothing runs or waits for them
+static const size_t kMaxIdleHosts = 1024;
+
+/**
+ * Parks a blocking caller until the scheduler lets its request run.
+ */
+class RestClientSchedulerTicket : public RestClientScheduledRequest
+{
+public:
+    RestClientSchedulerTicket() : mutex(), condition(), ready( false )
+    {}
+
+    virtual void Dispatch()
+    {
+        RestClientScopedLock lock( mutex );
+
+        ready = true;
+        condition.Signal();
+    }
+
+    virtual void Cancel()
+    {
+        Dispatch();
+    }
+
+    void Wait()
+    {
+        RestClientScopedLock lock( mutex );
+
+        while( !ready )
+            condition.Wait( mutex );
+    }
+
+private:
+    RestClientMutex     mutex;
+    RestClientCondition condition;
+    bool                ready;
+};
+
+RestClientHostScheduler::RestClientHostScheduler() : mutex(), settings(), hosts(), rotation(), inFlight( 0 ), limited( 0 )
+{
+}
+
+RestClientHostScheduler::~RestClientHostScheduler()
+{
+    CancelQueued();
+}
+
+/**
+ * @brief scheme://host:port key of a URL
+ *
+ * Scheme and host are lower cased and the default port is filled in, so
+ * every spelling of an origin ends up in the same queue.
+ */
+std::string RestClientHostScheduler::Origin( const std::string& url )
+{
+    return Origin( url.data(), url.size() );
+}
+
+/**
+ * @brief scheme://host:port key of a URL in a borrowed buffer
+ *
+ * Parses in place, the key is the only string built.
+ */
+std::string RestClientHostScheduler::Origin( const char* url, size_t length )
+{
+    static const char kSeparator[] = "://";
+
+    const char* last      = url + length;
+    const char* schemeEnd = std::search( url, last, kSeparator, kSeparator + 3 );
+    const char* scheme    = ( schemeEnd == last ) ? "http" : url;
+    size_t      schemeLen = ( schemeEnd == last ) ? 4 : schemeEnd - url;
+    const char* start     = ( schemeEnd == last ) ? url : schemeEnd + 3;
+    const char* end       = start;
+
+    while( end < last && *end != '/' && *end != '?' && *end != '#' )
+        end++;
+
+    // credentials do not pick a different host
+    for( const char* at = end; at > start; at-- )
+    {
+        if( at[-1] == '@' )
+        {
+            start = at;
+            break;
+        }
+    }
+
+    // the last colon outside an IPv6 literal starts the port
+    const char* hostEnd = end;
+
+    for( const char* colon = end; colon > start && colon[-1] != ']'; colon-- )
+    {
+        if( colon[-1] == ':' )
+        {
+            hostEnd = colon - 1;
+            break;
+        }
+    }
+
+    const char* port    = ( hostEnd == end ) ? end : hostEnd + 1;
+    bool        https   = schemeLen == 5 && strncasecmp( scheme, "https", 5 ) == 0;
+    std::string origin;
+
+    origin.reserve( schemeLen + 3 + ( hostEnd - start ) + 1 + ( end - port ) + 3 );
+
+    for( size_t i = 0; i < schemeLen; i++ )
+        origin.push_back( static_cast<char>( tolower( static_cast<unsigned char>( scheme[i] ) ) ) );
+
+    origin.append( kSeparator, 3 );
+
+    for( const char* c = start; c < hostEnd; c++ )
+        origin.push_back( static_cast<char>( tolower( static_cast<unsigned char>( *c ) ) ) );
+
+    origin.push_back( ':' );
+
+    if( port == end )
+        origin.append( https ? "443" : "80" );
+    else
+        origin.append( port, end - port );
+
+    return origin;
+}
+
+/**
+ * @brief run a request now or queue it behind its host
+ *
+ * @param request dispatched once admitted, possibly before Submit returns
+ * @param origin key from Origin
+ * @param multiplexed whether the request shares its connection
+ */
+void RestClientHostScheduler::Submit( RestClientScheduledRequest* request, const std::string& origin, bool multiplexed )
+{
+    mutex.Lock();
+
+    Host& host = hosts[origin];
+
+    if( host.queue.empty() && CanAdmit( host, multiplexed ) )
+    {
+        Admit( host, multiplexed, 0 );
+
+        mutex.Unlock();
+
+        request->Dispatch();
+        return;
+    }
+
+    Queue( host, request, origin, multiplexed );
+
+    mutex.Unlock();
+}
+
+/**
+ * @brief wait until a blocking request to origin may run
+ *
+ * A request admitted right away takes the scheduler lock once, only one
+ * that has to wait parks on a ticket.
+ */
+void RestClientHostScheduler::Enter( const std::string& origin )
+{
+    mutex.Lock();
+
+    Host& host = hosts[origin];
+
+    if( host.queue.empty() && CanAdmit( host, false ) )
+    {
+        Admit( host, false, 0 );
+
+        mutex.Unlock();
+        return;
+    }
+
+    RestClientSchedulerTicket ticket;
+
+    Queue( host, &ticket, origin, false );
+
+    mutex.Unlock();
+
+    ticket.Wait();
+}
+
+/**
+ * @brief give back the slot of a finished request and run whoever is next
+ */
+void RestClientHostScheduler::Leave( const std::string& origin, bool multiplexed )
+{
+    std::vector<RestClientScheduledRequest*> admitted;
+
+    mutex.Lock();
+
+    Host& host = hosts[origin];
+
+    host.inFlight--;
+    host.statistics.inFlight = host.inFlight;
+
+    if( !multiplexed )
+        host.connections--;
+
+    inFlight--;
+
+    Pump( admitted );
+
+    if( hosts.size() > kMaxIdleHosts )
+        Prune();
+
+    mutex.Unlock();
+
+    for( size_t i = 0; i < admitted.size(); i++ )
+        admitted[i]->Dispatch();
+}
+
+/**
+ * @brief drop every queued request, used on shutdown
+ */
+void RestClientHostScheduler::CancelQueued()
+{
+    std::vector<RestClientScheduledRequest*> cancelled;
+
+    mutex.Lock();
+
+    std::map<std::string, Host>::iterator iterator;
+
+    for( iterator = hosts.begin(); iterator != hosts.end(); iterator++ )
+    {
+        cancelled.insert( cancelled.end(), iterator->second.queue.begin(), iterator->second.queue.end() );
+
+        iterator->second.queue.clear();
+        iterator->second.statistics.queued = 0;
+    }
+
+    rotation.clear();
+
+    mutex.Unlock();
+
+    for( size_t i = 0; i < cancelled.size(); i++ )
+        cancelled[i]->Cancel();
+}
+
+/**
+ * @brief whether blocking requests have to Enter, taken without the lock
+ *
+ * A request that skipped Enter does not Leave either, even if a limit is
+ * set while it runs.
+ */
+bool RestClientHostScheduler::Limited()
+{
+    return __sync_fetch_and_add( &limited, 0 ) != 0;
+}
+
+/**
+ * @brief change the limits, raised limits take effect right away
+ */
+void RestClientHostScheduler::Configure( const RestClient::SchedulerSettings& newSettings )
+{
+    std::vector<RestClientScheduledRequest*> admitted;
+
+    mutex.Lock();
+
+    settings = newSettings;
+
+    __sync_lock_test_and_set( &limited, ( settings.maxInFlight > 0 || settings.maxInFlightPerHost > 0 || settings.maxConnectionsPerHost > 0 ) ? 1 : 0 );
+
+    Pump( admitted );
+
+    mutex.Unlock();
+
+    for( size_t i = 0; i < admitted.size(); i++ )
+        admitted[i]->Dispatch();
+}
+
+/**
+ * @brief snapshot of the queueing per host
+ */
+std::vector<RestClient::HostStatistics> RestClientHostScheduler::Statistics()
+{
+    RestClientScopedLock                    lock( mutex );
+    std::vector<RestClient::HostStatistics> result;
+
+    std::map<std::string, Host>::const_iterator iterator;
+
+    for( iterator = hosts.begin(); iterator != hosts.end(); iterator++ )
+    {
+        result.push_back( iterator->second.statistics );
+        result.back().host = iterator->first;
+    }
+
+    return result;
+}
+
+/**
+ * @brief put a request at the back of its host queue
+ *
+ * Must be called with the mutex held.
+ */
+void RestClientHostScheduler::Queue( Host& host, RestClientScheduledRequest* request, const std::string& origin, bool multiplexed )
+{
+    request->host        = origin;
+    request->multiplexed = multiplexed;
+    request->queuedAt    = Now();
+
+    if( host.queue.empty() )
+        rotation.push_back( origin );
+
+    host.queue.push_back( request );
+
+    host.statistics.queued = host.queue.size();
+    if( host.statistics.queued > host.statistics.peakQueued )
+        host.statistics.peakQueued = host.statistics.queued;
+}
+
+bool RestClientHostScheduler::CanAdmit( const Host& host, bool multiplexed ) const
+{
+    if( settings.maxInFlight > 0 && inFlight >= settings.maxInFlight )
+        return false;
+
+    if( settings.maxInFlightPerHost > 0 && host.inFlight >= settings.maxInFlightPerHost )
+        return false;
+
+    if( !multiplexed && settings.maxConnectionsPerHost > 0 && host.connections >= settings.maxConnectionsPerHost )
+        return false;
+
+    return true;
+}
+
+void RestClientHostScheduler::Admit( Host& host, bool multiplexed, double waited )
+{
+    host.inFlight++;
+
+    if( !multiplexed )
+        host.connections++;
+
+    inFlight++;
+
+    host.statistics.inFlight = host.inFlight;
+    host.statistics.dispatched++;
+    host.statistics.totalWait += waited;
+
+    if( waited > host.statistics.maxWait )
+        host.statistics.maxWait = waited;
+}
+
+/**
+ * @brief admit queued requests round-robin across their hosts
+ *
+ * Must be called with the mutex held, the admitted requests are dispatched
+ * by the caller once the lock is released.
+ */
+void RestClientHostScheduler::Pump( std::vector<RestClientScheduledRequest*>& admitted )
+{
+    double now     = 0;
+    size_t skipped = 0;
+
+    // stop after a full round without progress
+    while( skipped < rotation.size() )
+    {
+        std::string origin = rotation.front();
+        Host&       host   = hosts[origin];
+
+        rotation.pop_front();
+
+        RestClientScheduledRequest* request = host.queue.front();
+
+        if( !CanAdmit( host, request->multiplexed ) )
+        {
+            rotation.push_back( origin );
+            skipped++;
+            continue;
+        }
+
+        if( now == 0 )
+            now = Now();
+
+        host.queue.pop_front();
+        host.statistics.queued = host.queue.size();
+
+        Admit( host, request->multiplexed, now - request->queuedAt );
+        admitted.push_back( request );
+
+        // served hosts go to the back of the line
+        if( !host.queue.empty() )
+            rotation.push_back( origin );
+
+        skipped = 0;
+    }
+}
+
+/**
+ * @brief forget hosts nothing runs or waits for
+ */
+void RestClientHostScheduler::Prune()
+{
+    std::map<std::string, Host>::iterator iterator = hosts.begin();
+
+    while( iterator != hosts.end() )
+    {
+        if( iterator->second.inFlight == 0 && iterator->second.queue.empty() )
+            hosts.erase( iterator++ );
+        else
+            iterator++;
+    }
+}
+
+double RestClientHostScheduler::Now()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
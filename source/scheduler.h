@@ -0,0 +1,110 @@
+/**
+ * @file scheduler.h
+ * @brief per host admission of requests
+ */
+
+#ifndef SOURCE_SCHEDULER_H_
+#define SOURCE_SCHEDULER_H_
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "restclient.h"
+#include "threading.h"
+
+class RestClientHostScheduler;
+
+/**
+ * A request waiting for its turn. Dispatch is called once the request may
+ * run, Cancel if the scheduler gives up on it first. Neither is called with
+ * the scheduler lock held.
+ */
+class RestClientScheduledRequest
+{
+public:
+    RestClientScheduledRequest() : host(), multiplexed( false ), queuedAt( 0 )
+    {}
+
+    virtual ~RestClientScheduledRequest()
+    {};
+
+    virtual void Dispatch() = 0;
+    virtual void Cancel() = 0;
+
+private:
+    friend class RestClientHostScheduler;
+
+    std::string host;
+    bool        multiplexed;
+    double      queuedAt;
+};
+
+/**
+ * Sits in front of both the blocking and the asynchronous transfer paths.
+ * Requests are keyed by scheme://host:port and admitted while their host is
+ * below its in-flight and connection limits and the total stays below the
+ * global limit. Excess requests wait in a FIFO per host, hosts with waiting
+ * requests are served round-robin so a backed up host cannot take every
+ * slot that frees up.
+ *
+ * Multiplexed requests share a connection and do not count towards the
+ * connection limit, libcurl caps their connections through
+ * CURLMOPT_MAX_HOST_CONNECTIONS instead.
+ *
+ * Blocking requests only need Enter and Leave while a limit is set, so
+ * without limits they skip the scheduler lock and are not counted in
+ * its statistics; callers check Limited before Enter. A request that
+ * checked before Configure set the first limit runs uncounted.
+ */
+class RestClientHostScheduler
+{
+public:
+    RestClientHostScheduler();
+    ~RestClientHostScheduler();
+
+    static std::string Origin( const std::string& url );
+    static std::string Origin( const char* url, size_t length );
+
+    void Submit( RestClientScheduledRequest* request, const std::string& origin, bool multiplexed );
+    void Enter ( const std::string& origin );
+    void Leave ( const std::string& origin, bool multiplexed );
+    void CancelQueued();
+    bool Limited();
+
+    void                                    Configure( const RestClient::SchedulerSettings& newSettings );
+    std::vector<RestClient::HostStatistics> Statistics();
+
+private:
+    RestClientHostScheduler( const RestClientHostScheduler& );
+    RestClientHostScheduler& operator=( const RestClientHostScheduler& );
+
+    typedef struct Host_s
+    {
+        long                                    inFlight;
+        long                                    connections;
+        std::deque<RestClientScheduledRequest*> queue;
+        RestClient::HostStatistics              statistics;
+
+        Host_s() : inFlight( 0 ), connections( 0 ), queue(), statistics()
+        {}
+    } Host;
+
+    void Queue   ( Host& host, RestClientScheduledRequest* request, const std::string& origin, bool multiplexed );
+    bool CanAdmit( const Host& host, bool multiplexed ) const;
+    void Admit   ( Host& host, bool multiplexed, double waited );
+    void Pump    ( std::vector<RestClientScheduledRequest*>& admitted );
+    void Prune();
+
+    static double Now();
+
+    RestClientMutex               mutex;
+    RestClient::SchedulerSettings settings;
+    std::map<std::string, Host>   hosts;
+    std::deque<std::string>       rotation;  // hosts with queued requests, next to serve first
+    long                          inFlight;
+    long                          limited;   // 1 while settings hold a limit, read atomically
+};
+
+#endif  // SOURCE_SCHEDULER_H_
@@ -0,0 +1,142 @@
+/**
+ * @file share.cpp
+ * @brief implementation of the process wide share object
+ */
+
+/*========================
+         INCLUDES
+  ========================*/
+#include "share.h"
+#include "handlepool.h"
+
+RestClientShare::RestClientShare() : share( NULL ), mutex(), pools()
+{
+    for( int i = 0; i < CURL_LOCK_DATA_LAST; i++ )
+        pthread_rwlock_init( &locks[i], NULL );
+}
+
+RestClientShare::~RestClientShare()
+{
+    // handles still attached keep calling the lock callbacks
+    if( !CleanUp() )
+        return;
+
+    for( int i = 0; i < CURL_LOCK_DATA_LAST; i++ )
+        pthread_rwlock_destroy( &locks[i] );
+}
+
+/**
+ * @brief create the share object for the requested caches
+ *
+ * @param settings selecting the caches to share
+ *
+ * @return false if the previous share is still in use and stays in
+ *         place, or the new one could not be created
+ */
+bool RestClientShare::Init( const RestClient::ShareSettings& settings )
+{
+    if( !CleanUp() )
+        return false;
+
+    if( !settings.dns && !settings.sslSessions && !settings.connections )
+        return true;
+
+    share = curl_share_init();
+    if( share == NULL )
+        return false;
+
+    curl_share_setopt( share, CURLSHOPT_LOCKFUNC, RestClientShare::LockCallback );
+    curl_share_setopt( share, CURLSHOPT_UNLOCKFUNC, RestClientShare::UnlockCallback );
+    curl_share_setopt( share, CURLSHOPT_USERDATA, this );
+
+    if( settings.dns )
+        curl_share_setopt( share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS );
+
+    if( settings.sslSessions )
+        curl_share_setopt( share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION );
+
+    if( settings.connections )
+        curl_share_setopt( share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT );
+
+    return true;
+}
+
+/**
+ * @brief release the share object
+ *
+ * Closes the idle handles of every pool first. Handles that are still in
+ * use, by a transfer or in a thread cache, keep the share alive.
+ *
+ * @return false if handles still use the share, it is kept then
+ */
+bool RestClientShare::CleanUp()
+{
+    RestClientScopedLock                           lock( mutex );
+    std::set<RestClientHandlePool*>::const_iterator iterator;
+
+    for( iterator = pools.begin(); iterator != pools.end(); iterator++ )
+        ( *iterator )->Drain();
+
+    if( share == NULL )
+        return true;
+
+    if( curl_share_cleanup( share ) != CURLSHE_OK )
+        return false;
+
+    share = NULL;
+
+    return true;
+}
+
+/**
+ * @brief point a new easy handle at the shared caches
+ *
+ * Called once per handle, curl_easy_reset keeps CURLOPT_SHARE.
+ *
+ * @param handle to attach
+ */
+void RestClientShare::Attach( CURL* handle )
+{
+    if( share != NULL )
+        curl_easy_setopt( handle, CURLOPT_SHARE, share );
+}
+
+/**
+ * @brief let CleanUp reach the idle handles of a pool
+ */
+void RestClientShare::Register( RestClientHandlePool* pool )
+{
+    RestClientScopedLock lock( mutex );
+
+    pools.insert( pool );
+}
+
+void RestClientShare::Unregister( RestClientHandlePool* pool )
+{
+    RestClientScopedLock lock( mutex );
+
+    pools.erase( pool );
+}
+
+void RestClientShare::LockCallback( CURL* /* handle */, curl_lock_data data, curl_lock_access access, void* userptr )
+{
+    RestClientShare* self = reinterpret_cast<RestClientShare*>( userptr );
+
+    if( data < 0 || data >= CURL_LOCK_DATA_LAST )
+        return;
+
+    if( access == CURL_LOCK_ACCESS_SHARED )
+        pthread_rwlock_rdlock( &self->locks[data] );
+    else
+        pthread_rwlock_wrlock( &self->locks[data] );
+}
+
+void RestClientShare::UnlockCallback( CURL* /* handle */, curl_lock_data data, void* userptr )
+{
+    RestClientShare* self = reinterpret_cast<RestClientShare*>( userptr );
+
+    if( data < 0 || data >= CURL_LOCK_DATA_LAST )
+        return;
+
+    pthread_rwlock_unlock( &self->locks[data] );
+}
@@ -0,0 +1,55 @@
+/**
+ * @file share.h
+ * @brief process wide libcurl share object
+ */
+
+#ifndef SOURCE_SHARE_H_
+#define SOURCE_SHARE_H_
+
+#include <curl/curl.h>
+#include <pthread.h>
+#include <set>
+
+#include "restclient.h"
+#include "threading.h"
+
+class RestClientHandlePool;
+
+/**
+ * Wraps a CURLSH so all easy handles resolve, handshake and (optionally)
+ * connect through the same caches. Every shared data kind has its own
+ * reader/writer lock, so a DNS lookup never waits on a TLS session update
+ * and concurrent cache hits only take the lock shared.
+ *
+ * Handles are attached once, when their pool creates them; curl_easy_reset
+ * keeps the share, and attaching again would take the share's own lock
+ * exclusively on every request. The pools register with the share, so
+ * CleanUp can close their idle handles before the share goes away.
+ */
+class RestClientShare
+{
+public:
+    RestClientShare();
+    ~RestClientShare();
+
+    bool Init( const RestClient::ShareSettings& settings );
+    bool CleanUp();
+    void Attach( CURL* handle );
+
+    void Register  ( RestClientHandlePool* pool );
+    void Unregister( RestClientHandlePool* pool );
+
+private:
+    RestClientShare( const RestClientShare& );
+    RestClientShare& operator=( const RestClientShare& );
+
+    static void LockCallback  ( CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr );
+    static void UnlockCallback( CURL* handle, curl_lock_data data, void* userptr );
+
+    CURLSH*                         share;
+    pthread_rwlock_t                locks[CURL_LOCK_DATA_LAST];
+    RestClientMutex                 mutex;  // guards pools
+    std::set<RestClientHandlePool*> pools;  // whose handles are attached
+};
+
+#endif  // SOURCE_SHARE_H_
@@ -0,0 +1,249 @@
+/**
+ * @file threadcache.cpp
+ * @brief implementation of the per thread handle cache
+ */
+
+/*========================
+         INCLUDES
+  ========================*/
+#include "threadcache.h"
+
+RestClientThreadCache::RestClientThreadCache() : key(), mutex(), locals(), maxOrigins( 4 ), exited()
+{
+    pthread_key_create( &key, RestClientThreadCache::ThreadExit );
+}
+
+RestClientThreadCache::~RestClientThreadCache()
+{
+    std::vector<Local*> remaining;
+
+    mutex.Lock();
+
+    remaining.assign( locals.begin(), locals.end() );
+    locals.clear();
+
+    mutex.Unlock();
+
+    // threads still running lose their cache, their exit must not find it
+    pthread_key_delete( key );
+
+    for( size_t i = 0; i < remaining.size(); i++ )
+    {
+        CleanUpEntries( remaining[i]->entries );
+        delete remaining[i];
+    }
+}
+
+/**
+ * @brief take the cached handle of an origin
+ *
+ * @param origin key from RestClientHostScheduler::Origin
+ *
+ * @return handle with its options reset, NULL on a miss
+ */
+CURL* RestClientThreadCache::Acquire( const std::string& origin )
+{
+    Local* local = ThreadLocal( false );
+
+    // a disabled cache keeps its handles until the next Release hands them back
+    if( local == NULL || Capacity() == 0 )
+        return NULL;
+
+    for( size_t i = local->entries.size(); i > 0; i-- )
+    {
+        if( local->entries[i - 1].origin == origin )
+        {
+            CURL* handle = local->entries[i - 1].curl;
+
+            local->entries.erase( local->entries.begin() + ( i - 1 ) );
+            __sync_fetch_and_add( &local->hits, 1 );
+            __sync_fetch_and_sub( &local->idle, 1 );
+
+            return handle;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief keep a handle for the next request of this thread to origin
+ *
+ * @param handle to keep
+ * @param origin the handle last talked to
+ * @param transferred true if a transfer completed on the handle
+ * @param pool receiving the handle if the cache is off or full
+ */
+void RestClientThreadCache::Release( CURL* handle, const std::string& origin, bool transferred, RestClientHandlePool& pool )
+{
+    size_t capacity = Capacity();
+    Local* local    = ThreadLocal( capacity > 0 );
+
+    if( capacity == 0 )
+    {
+        // only the owning thread touches its entries, so it empties them itself
+        if( local != NULL )
+            Evict( *local, 0, pool );
+
+        pool.Release( handle, transferred );
+        return;
+    }
+
+    if( transferred )
+    {
+        long connects = 0;
+
+        curl_easy_getinfo( handle, CURLINFO_NUM_CONNECTS, &connects );
+
+        if( connects == 0 )
+            __sync_fetch_and_add( &local->connectionsReused, 1 );
+        else
+            __sync_fetch_and_add( &local->connectionsOpened, connects );
+    }
+
+    curl_easy_reset( handle );
+
+    Entry entry;
+
+    entry.origin = origin;
+    entry.curl   = handle;
+
+    local->entries.push_back( entry );
+
+    Evict( *local, capacity, pool );
+}
+
+/**
+ * @brief hand the least recently used handles of a thread back to the pool
+ *
+ * @param local cache of the calling thread
+ * @param capacity entries to keep
+ * @param pool receiving the handles
+ */
+void RestClientThreadCache::Evict( Local& local, size_t capacity, RestClientHandlePool& pool )
+{
+    while( local.entries.size() > capacity )
+    {
+        CURL* evicted = local.entries.front().curl;
+
+        local.entries.erase( local.entries.begin() );
+        pool.Release( evicted, false );
+    }
+
+    __sync_lock_test_and_set( &local.idle, local.entries.size() );
+}
+
+/**
+ * @brief close the cached handles of every thread
+ *
+ * Reaches into the caches of other threads, only RestClient::CleanUp may
+ * call it, with no request in flight.
+ */
+void RestClientThreadCache::Drain()
+{
+    std::vector<Entry>               handles;
+    std::set<Local*>::const_iterator iterator;
+
+    mutex.Lock();
+
+    for( iterator = locals.begin(); iterator != locals.end(); iterator++ )
+    {
+        handles.insert( handles.end(), ( *iterator )->entries.begin(), ( *iterator )->entries.end() );
+        ( *iterator )->entries.clear();
+        ( *iterator )->idle = 0;
+    }
+
+    mutex.Unlock();
+
+    CleanUpEntries( handles );
+}
+
+/**
+ * @brief origins each thread keeps a handle for, 0 disables the cache
+ *
+ * Safe while requests run. Each thread trims its own cache the next time
+ * it releases a handle, a disabled cache stops handing out its handles
+ * right away.
+ */
+void RestClientThreadCache::Configure( size_t newMaxOrigins )
+{
+    __sync_lock_test_and_set( &maxOrigins, newMaxOrigins );
+}
+
+size_t RestClientThreadCache::Capacity()
+{
+    return __sync_fetch_and_add( &maxOrigins, 0 );
+}
+
+/**
+ * @brief add the cache counters of all threads to the pool statistics
+ */
+void RestClientThreadCache::AddStatistics( RestClient::PoolStatistics& statistics )
+{
+    RestClientScopedLock             lock( mutex );
+    std::set<Local*>::const_iterator iterator;
+
+    statistics.handlesReused     += exited.handlesReused;
+    statistics.connectionsOpened += exited.connectionsOpened;
+    statistics.connectionsReused += exited.connectionsReused;
+
+    for( iterator = locals.begin(); iterator != locals.end(); iterator++ )
+    {
+        statistics.handlesReused     += __sync_fetch_and_add( &( *iterator )->hits, 0 );
+        statistics.connectionsOpened += __sync_fetch_and_add( &( *iterator )->connectionsOpened, 0 );
+        statistics.connectionsReused += __sync_fetch_and_add( &( *iterator )->connectionsReused, 0 );
+        statistics.idleHandles       += __sync_fetch_and_add( &( *iterator )->idle, 0 );
+    }
+}
+
+/**
+ * @brief cache of the calling thread
+ *
+ * @param create register a cache if the thread has none yet
+ */
+RestClientThreadCache::Local* RestClientThreadCache::ThreadLocal( bool create )
+{
+    Local* local = static_cast<Local*>( pthread_getspecific( key ) );
+
+    if( local != NULL || !create )
+        return local;
+
+    local        = new Local();
+    local->owner = this;
+
+    mutex.Lock();
+    locals.insert( local );
+    mutex.Unlock();
+
+    pthread_setspecific( key, local );
+
+    return local;
+}
+
+void RestClientThreadCache::ThreadExit( void* data )
+{
+    Local*                 local = static_cast<Local*>( data );
+    RestClientThreadCache* cache = local->owner;
+
+    cache->mutex.Lock();
+
+    cache->locals.erase( local );
+
+    cache->exited.handlesReused     += local->hits;
+    cache->exited.connectionsOpened += local->connectionsOpened;
+    cache->exited.connectionsReused += local->connectionsReused;
+
+    cache->mutex.Unlock();
+
+    CleanUpEntries( local->entries );
+
+    delete local;
+}
+
+void RestClientThreadCache::CleanUpEntries( std::vector<Entry>& entries )
+{
+    for( size_t i = 0; i < entries.size(); i++ )
+        curl_easy_cleanup( entries[i].curl );
+
+    entries.clear();
+}
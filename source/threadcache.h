@@ -0,0 +1,82 @@
+/**
+ * @file threadcache.h
+ * @brief per thread cache of easy handles for the blocking static API
+ */
+
+#ifndef SOURCE_THREADCACHE_H_
+#define SOURCE_THREADCACHE_H_
+
+#include <curl/curl.h>
+#include <pthread.h>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "handlepool.h"
+#include "threading.h"
+
+/**
+ * Every thread keeps the handles of its last few origins, so a thread
+ * calling the blocking methods in a loop gets its warm connection back
+ * without taking the pool lock. A miss falls back to the shared pool and
+ * handles pushed out of a full cache go back to it.
+ *
+ * The caches live in thread specific data and are torn down when their
+ * thread exits. Only the owning thread changes its entries, Configure
+ * just publishes the new capacity. Drain empties all of them,
+ * RestClient::CleanUp calls it before the share the handles are attached
+ * to goes away; like CleanUp itself it must not run while requests are in
+ * flight.
+ */
+class RestClientThreadCache
+{
+public:
+    RestClientThreadCache();
+    ~RestClientThreadCache();
+
+    CURL* Acquire( const std::string& origin );
+    void  Release( CURL* handle, const std::string& origin, bool transferred, RestClientHandlePool& pool );
+    void  Drain();
+
+    void Configure( size_t maxOrigins );
+    void AddStatistics( RestClient::PoolStatistics& statistics );
+
+private:
+    RestClientThreadCache( const RestClientThreadCache& );
+    RestClientThreadCache& operator=( const RestClientThreadCache& );
+
+    typedef struct Entry_s
+    {
+        std::string origin;
+        CURL*       curl;
+    } Entry;
+
+    // written by its own thread only, counters are read atomically
+    typedef struct Local_s
+    {
+        RestClientThreadCache* owner;
+        std::vector<Entry>     entries;  // least recently used first
+        unsigned long          hits;
+        unsigned long          connectionsOpened;
+        unsigned long          connectionsReused;
+        unsigned long          idle;     // entries.size() for the statistics
+
+        Local_s() : owner( NULL ), entries(), hits( 0 ), connectionsOpened( 0 ), connectionsReused( 0 ), idle( 0 )
+        {}
+    } Local;
+
+    Local* ThreadLocal( bool create );
+    size_t Capacity();
+    void   Evict( Local& local, size_t capacity, RestClientHandlePool& pool );
+
+    static void ThreadExit( void* local );
+    static void CleanUpEntries( std::vector<Entry>& entries );
+
+    pthread_key_t     key;
+    RestClientMutex   mutex;       // guards locals, never taken on a hit
+    std::set<Local*>  locals;
+    size_t            maxOrigins;  // 0 disables the cache, accessed atomically
+    RestClient::PoolStatistics exited;  // counters of threads that are gone
+};
+
+#endif  // SOURCE_THREADCACHE_H_
@@ -0,0 +1,98 @@
+/**
+ * @file threading.h
+ * @brief small pthread wrappers shared by the restclient internals
+ */
+
+#ifndef SOURCE_THREADING_H_
+#define SOURCE_THREADING_H_
+
+#include <pthread.h>
+
+class RestClientMutex
+{
+public:
+    RestClientMutex()
+    {
+        pthread_mutex_init( &mutex, NULL );
+    }
+
+    ~RestClientMutex()
+    {
+        pthread_mutex_destroy( &mutex );
+    }
+
+    void Lock()
+    {
+        pthread_mutex_lock( &mutex );
+    }
+
+    void Unlock()
+    {
+        pthread_mutex_unlock( &mutex );
+    }
+
+private:
+    friend class RestClientCondition;
+
+    RestClientMutex( const RestClientMutex& );
+    RestClientMutex& operator=( const RestClientMutex& );
+
+    pthread_mutex_t mutex;
+};
+
+class RestClientCondition
+{
+public:
+    RestClientCondition()
+    {
+        pthread_cond_init( &condition, NULL );
+    }
+
+    ~RestClientCondition()
+    {
+        pthread_cond_destroy( &condition );
+    }
+
+    void Wait( RestClientMutex& m )
+    {
+        pthread_cond_wait( &condition, &m.mutex );
+    }
+
+    void Signal()
+    {
+        pthread_cond_signal( &condition );
+    }
+
+    void Broadcast()
+    {
+        pthread_cond_broadcast( &condition );
+    }
+
+private:
+    RestClientCondition( const RestClientCondition& );
+    RestClientCondition& operator=( const RestClientCondition& );
+
+    pthread_cond_t condition;
+};
+
+class RestClientScopedLock
+{
+public:
+    explicit RestClientScopedLock( RestClientMutex& m ) : mutex( m )
+    {
+        mutex.Lock();
+    }
+
+    ~RestClientScopedLock()
+    {
+        mutex.Unlock();
+    }
+
+private:
+    RestClientScopedLock( const RestClientScopedLock& );
+    RestClientScopedLock& operator=( const RestClientScopedLock& );
+
+    RestClientMutex& mutex;
+};
+
+#endif  // SOURCE_THREADING_H_
@@ -0,0 +1,275 @@
+/**
+ * @file tokenizer.cpp
+ * @brief header line tokenizer with SSE2 and AVX2 paths
+ */
+
+/*========================
+         INCLUDES
+  ========================*/
+#include "headers.h"
+
+#include <cstring>
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define RESTCLIENT_X86 1
+#include <immintrin.h>
+#endif
+
+/*
+ * Whitespace is what isspace accepts in the C locale: space and \t \n \v
+ * \f \r, the last five being the bytes 9 to 13.
+ *
+ * The colon is found with memchr, which the C library already vectorizes
+ * for the running CPU. Trimming is where the levels differ: a header line
+ * is usually surrounded by a byte or two of whitespace, which the scalar
+ * loop handles faster than a vector load, so the vector code only takes
+ * over for runs longer than kScalarRun. Tails shorter than a vector go
+ * through the scalar code as well.
+ */
+
+static const size_t kScalarRun = 16;
+
+static inline bool IsSpace( unsigned char c )
+{
+    return c == ' ' || static_cast<unsigned char>( c - 9 ) <= 4;
+}
+
+static inline size_t FindColon( const char* data, size_t length )
+{
+    const void* colon = memchr( data, ':', length );
+
+    return ( colon == NULL ) ? length : static_cast<const char*>( colon ) - data;
+}
+
+static inline size_t LeadingSpaceScalar( const char* data, size_t length )
+{
+    size_t i = 0;
+
+    while( i < length && IsSpace( static_cast<unsigned char>( data[i] ) ) )
+        i++;
+
+    return i;
+}
+
+static inline size_t TrailingSpaceScalar( const char* data, size_t length )
+{
+    size_t i = length;
+
+    while( i > 0 && IsSpace( static_cast<unsigned char>( data[i - 1] ) ) )
+        i--;
+
+    return length - i;
+}
+
+#ifdef RESTCLIENT_X86
+
+// bit per byte of a 16 byte block, set for whitespace
+__attribute__(( target( "sse2" ) ))
+static inline unsigned int SpaceMask16( __m128i block )
+{
+    __m128i control   = _mm_sub_epi8( block, _mm_set1_epi8( 9 ) );
+    __m128i isControl = _mm_cmpeq_epi8( _mm_min_epu8( control, _mm_set1_epi8( 4 ) ), control );
+    __m128i isBlank   = _mm_cmpeq_epi8( block, _mm_set1_epi8( ' ' ) );
+
+    return static_cast<unsigned int>( _mm_movemask_epi8( _mm_or_si128( isControl, isBlank ) ) );
+}
+
+__attribute__(( target( "sse2" ) ))
+static size_t LeadingSpaceSSE2( const char* data, size_t length )
+{
+    size_t i = 0;
+
+    for( ; i + 16 <= length; i += 16 )
+    {
+        unsigned int other = ~SpaceMask16( _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + i ) ) ) & 0xffff;
+
+        if( other != 0 )
+            return i + __builtin_ctz( other );
+    }
+
+    return i + LeadingSpaceScalar( data + i, length - i );
+}
+
+__attribute__(( target( "sse2" ) ))
+static size_t TrailingSpaceSSE2( const char* data, size_t length )
+{
+    size_t i = length;
+
+    for( ; i >= 16; i -= 16 )
+    {
+        unsigned int other = ~SpaceMask16( _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + i - 16 ) ) ) & 0xffff;
+
+        if( other != 0 )
+            return length - ( i - 16 + 32 - __builtin_clz( other ) );
+    }
+
+    return length - i + TrailingSpaceScalar( data, i );
+}
+
+// bit per byte of a 32 byte block, set for whitespace
+__attribute__(( target( "avx2" ) ))
+static inline unsigned int SpaceMask32( __m256i block )
+{
+    __m256i control   = _mm256_sub_epi8( block, _mm256_set1_epi8( 9 ) );
+    __m256i isControl = _mm256_cmpeq_epi8( _mm256_min_epu8( control, _mm256_set1_epi8( 4 ) ), control );
+    __m256i isBlank   = _mm256_cmpeq_epi8( block, _mm256_set1_epi8( ' ' ) );
+
+    return static_cast<unsigned int>( _mm256_movemask_epi8( _mm256_or_si256( isControl, isBlank ) ) );
+}
+
+__attribute__(( target( "avx2" ) ))
+static size_t LeadingSpaceAVX2( const char* data, size_t length )
+{
+    size_t i = 0;
+
+    for( ; i + 32 <= length; i += 32 )
+    {
+        unsigned int other = ~SpaceMask32( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( data + i ) ) );
+
+        if( other != 0 )
+            return i + __builtin_ctz( other );
+    }
+
+    _mm256_zeroupper();
+
+    return i + LeadingSpaceSSE2( data + i, length - i );
+}
+
+__attribute__(( target( "avx2" ) ))
+static size_t TrailingSpaceAVX2( const char* data, size_t length )
+{
+    size_t i = length;
+
+    for( ; i >= 32; i -= 32 )
+    {
+        unsigned int other = ~SpaceMask32( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( data + i - 32 ) ) );
+
+        if( other != 0 )
+            return length - ( i - __builtin_clz( other ) );
+    }
+
+    _mm256_zeroupper();
+
+    return length - i + TrailingSpaceSSE2( data, i );
+}
+
+#endif  // RESTCLIENT_X86
+
+/**
+ * @brief widest instruction set the running CPU offers the tokenizer
+ */
+RestClientHeaders::Isa RestClientHeaders::BestIsa()
+{
+#ifdef RESTCLIENT_X86
+    if( __builtin_cpu_supports( "avx2" ) )
+        return kAVX2;
+
+    if( __builtin_cpu_supports( "sse2" ) )
+        return kSSE2;
+#endif
+
+    return kScalar;
+}
+
+/**
+ * @brief number of whitespace bytes a span starts with
+ */
+size_t RestClientHeaders::LeadingSpace( const char* data, size_t length, RestClientHeaders::Isa isa )
+{
+    size_t prefix = length < kScalarRun ? length : kScalarRun;
+    size_t i      = LeadingSpaceScalar( data, prefix );
+
+    if( i < kScalarRun )
+        return i;
+
+    switch( isa )
+    {
+#ifdef RESTCLIENT_X86
+        case kAVX2:
+            return i + LeadingSpaceAVX2( data + i, length - i );
+        case kSSE2:
+            return i + LeadingSpaceSSE2( data + i, length - i );
+#endif
+        default:
+            return i + LeadingSpaceScalar( data + i, length - i );
+    }
+}
+
+size_t RestClientHeaders::LeadingSpace( const char* data, size_t length )
+{
+    return LeadingSpace( data, length, BestIsa() );
+}
+
+/**
+ * @brief number of whitespace bytes a span ends with
+ */
+size_t RestClientHeaders::TrailingSpace( const char* data, size_t length, RestClientHeaders::Isa isa )
+{
+    size_t suffix = length < kScalarRun ? length : kScalarRun;
+    size_t i      = TrailingSpaceScalar( data + length - suffix, suffix );
+
+    if( i < kScalarRun )
+        return i;
+
+    switch( isa )
+    {
+#ifdef RESTCLIENT_X86
+        case kAVX2:
+            return i + TrailingSpaceAVX2( data, length - i );
+        case kSSE2:
+            return i + TrailingSpaceSSE2( data, length - i );
+#endif
+        default:
+            return i + TrailingSpaceScalar( data, length - i );
+    }
+}
+
+size_t RestClientHeaders::TrailingSpace( const char* data, size_t length )
+{
+    return TrailingSpace( data, length, BestIsa() );
+}
+
+/**
+ * @brief split a header line into its trimmed name and value
+ *
+ * The name ends at the first colon. Whitespace around both, the line
+ * break included, is stripped like the trim helpers always did.
+ *
+ * @param line header line as handed over by libcurl
+ * @param length of the line
+ * @param field set to name and value, pointing into line
+ * @param isa instruction set to use, at most BestIsa
+ *
+ * @return false for lines without a colon
+ */
+bool RestClientHeaders::Tokenize( const char* line, size_t length, RestClientHeaders::Field& field, RestClientHeaders::Isa isa )
+{
+    size_t colon = FindColon( line, length );
+
+    if( colon == length )
+        return false;
+
+    size_t nameStart  = LeadingSpace( line, colon, isa );
+    size_t nameLength = colon - nameStart;
+
+    nameLength -= TrailingSpace( line + nameStart, nameLength, isa );
+
+    const char* value       = line + colon + 1;
+    size_t      valueLength = length - colon - 1;
+    size_t      valueStart  = LeadingSpace( value, valueLength, isa );
+
+    valueLength -= valueStart;
+    valueLength -= TrailingSpace( value + valueStart, valueLength, isa );
+
+    field.name        = line + nameStart;
+    field.nameLength  = nameLength;
+    field.value       = value + valueStart;
+    field.valueLength = valueLength;
+
+    return true;
+}
+
+bool RestClientHeaders::Tokenize( const char* line, size_t length, RestClientHeaders::Field& field )
+{
+    return Tokenize( line, length, field, BestIsa() );
+}
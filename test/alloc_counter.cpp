@@ -0,0 +1,106 @@
+/**
+ * @file alloc_counter.cpp
+ * @brief replaces the global allocation functions to feed AllocCounter
+ */
+
+#include "alloc_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    struct ThreadCounter
+    {
+        bool               active;
+        size_t             minimumSize;
+        unsigned long      count;
+        unsigned long long bytes;
+    };
+
+    thread_local ThreadCounter counter = { false, 0, 0, 0 };
+
+    void* Allocate( size_t size )
+    {
+        if( counter.active && size >= counter.minimumSize )
+        {
+            counter.count++;
+            counter.bytes += size;
+        }
+
+        return malloc( size == 0 ? 1 : size );
+    }
+}
+
+AllocCounter::AllocCounter( size_t minimumSize )
+{
+    counter.active      = true;
+    counter.minimumSize = minimumSize;
+    counter.count       = 0;
+    counter.bytes       = 0;
+}
+
+AllocCounter::~AllocCounter()
+{
+    counter.active = false;
+}
+
+unsigned long AllocCounter::Count() const
+{
+    return counter.count;
+}
+
+unsigned long long AllocCounter::Bytes() const
+{
+    return counter.bytes;
+}
+
+void* operator new( size_t size )
+{
+    void* p = Allocate( size );
+
+    if( p == NULL )
+        throw std::bad_alloc();
+
+    return p;
+}
+
+void* operator new[]( size_t size )
+{
+    void* p = Allocate( size );
+
+    if( p == NULL )
+        throw std::bad_alloc();
+
+    return p;
+}
+
+void* operator new( size_t size, const std::nothrow_t& ) noexcept
+{
+    return Allocate( size );
+}
+
+void* operator new[]( size_t size, const std::nothrow_t& ) noexcept
+{
+    return Allocate( size );
+}
+
+void operator delete( void* p ) noexcept
+{
+    free( p );
+}
+
+void operator delete[]( void* p ) noexcept
+{
+    free( p );
+}
+
+void operator delete( void* p, size_t ) noexcept
+{
+    free( p );
+}
+
+void operator delete[]( void* p, size_t ) noexcept
+{
+    free( p );
+}
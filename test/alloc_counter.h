@@ -0,0 +1,31 @@
+/**
+ * @file alloc_counter.h
+ * @brief counts heap allocations made by the current thread
+ */
+
+#ifndef TEST_ALLOC_COUNTER_H_
+#define TEST_ALLOC_COUNTER_H_
+
+#include <cstddef>
+
+/**
+ * Counts operator new calls on the constructing thread for as long as it
+ * lives. Only allocations of at least minimumSize bytes are counted, which
+ * lets a test single out large buffers from libcurl's small bookkeeping.
+ * One counter per thread at a time.
+ */
+class AllocCounter
+{
+public:
+    explicit AllocCounter( size_t minimumSize = 0 );
+    ~AllocCounter();
+
+    unsigned long      Count() const;
+    unsigned long long Bytes() const;
+
+private:
+    AllocCounter( const AllocCounter& );
+    AllocCounter& operator=( const AllocCounter& );
+};
+
+#endif  // TEST_ALLOC_COUNTER_H_
@@ -0,0 +1,526 @@
+/**
+ * @file local_server.cpp
+ * @brief implementation of the in-process test server
+ */
+
+#include "local_server.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    const size_t kPatternPeriod = 251;
+    const size_t kChunkSize     = 64 * 1024;
+
+    // pattern bytes laid out so any offset can be sent straight from the table
+    char PatternTable[kChunkSize + kPatternPeriod];
+
+    struct PatternInit
+    {
+        PatternInit()
+        {
+            for( size_t i = 0; i < sizeof( PatternTable ); i++ )
+                PatternTable[i] = LocalServer::PatternByte( i );
+        }
+    } patternInit;
+
+    std::string Lower( std::string value )
+    {
+        for( size_t i = 0; i < value.size(); i++ )
+            value[i] = static_cast<char>( std::tolower( static_cast<unsigned char>( value[i] ) ) );
+
+        return value;
+    }
+
+    std::string Trim( const std::string& value )
+    {
+        size_t first = value.find_first_not_of( " \t" );
+        size_t last  = value.find_last_not_of( " \t\r\n" );
+
+        if( first == std::string::npos )
+            return std::string();
+
+        return value.substr( first, last - first + 1 );
+    }
+
+    void SetNonBlocking( int fd )
+    {
+        fcntl( fd, F_SETFL, fcntl( fd, F_GETFL, 0 ) | O_NONBLOCK );
+    }
+}
+
+struct LocalServer::Connection
+{
+    int                fd;
+    std::string        in;
+    std::string        out;
+    size_t             outOffset;
+    unsigned long long patternOffset;
+    unsigned long long patternRemaining;
+    bool               closeAfter;
+};
+
+LocalServer::LocalServer() : listenFd( -1 ), epollFd( -1 ), wakeFd( -1 ), port( 0 ), running( false ), thread()
+{
+    pthread_mutex_init( &mutex, NULL );
+    memset( &statistics, 0, sizeof( statistics ) );
+}
+
+LocalServer::~LocalServer()
+{
+    Stop();
+    pthread_mutex_destroy( &mutex );
+}
+
+char LocalServer::PatternByte( unsigned long long offset )
+{
+    return static_cast<char>( 'a' + offset % kPatternPeriod % 26 );
+}
+
+bool LocalServer::Start()
+{
+    struct sockaddr_in address;
+    socklen_t          length = sizeof( address );
+    int                one    = 1;
+
+    listenFd = socket( AF_INET, SOCK_STREAM, 0 );
+    setsockopt( listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof( one ) );
+
+    memset( &address, 0, sizeof( address ) );
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    address.sin_port        = 0;
+
+    if( bind( listenFd, reinterpret_cast<struct sockaddr*>( &address ), sizeof( address ) ) != 0 || listen( listenFd, 65535 ) != 0 )
+    {
+        close( listenFd );
+        listenFd = -1;
+        return false;
+    }
+
+    getsockname( listenFd, reinterpret_cast<struct sockaddr*>( &address ), &length );
+    port = ntohs( address.sin_port );
+
+    SetNonBlocking( listenFd );
+
+    epollFd = epoll_create1( 0 );
+    wakeFd  = eventfd( 0, EFD_NONBLOCK );
+
+    struct epoll_event event;
+    memset( &event, 0, sizeof( event ) );
+
+    event.events   = EPOLLIN;
+    event.data.ptr = NULL;
+    epoll_ctl( epollFd, EPOLL_CTL_ADD, listenFd, &event );
+
+    event.data.ptr = &wakeFd;
+    epoll_ctl( epollFd, EPOLL_CTL_ADD, wakeFd, &event );
+
+    running = true;
+
+    return pthread_create( &thread, NULL, LocalServer::ThreadMain, this ) == 0;
+}
+
+void LocalServer::Stop()
+{
+    unsigned long long value = 1;
+
+    if( !running )
+        return;
+
+    running = false;
+
+    if( write( wakeFd, &value, sizeof( value ) ) < 0 )
+        perror( "write" );
+
+    pthread_join( thread, NULL );
+
+    close( wakeFd );
+    close( epollFd );
+    close( listenFd );
+
+    listenFd = epollFd = wakeFd = -1;
+}
+
+int LocalServer::Port() const
+{
+    return port;
+}
+
+std::string LocalServer::Url( const std::string& path ) const
+{
+    char prefix[64];
+
+    snprintf( prefix, sizeof( prefix ), "http://127.0.0.1:%d", port );
+
+    return std::string( prefix ) + path;
+}
+
+LocalServer::Statistics LocalServer::GetStatistics()
+{
+    pthread_mutex_lock( &mutex );
+    Statistics result = statistics;
+    pthread_mutex_unlock( &mutex );
+
+    return result;
+}
+
+void LocalServer::Handle( const Request& /* request */, Response& response )
+{
+    response.body = "GET succesful.";
+}
+
+void* LocalServer::ThreadMain( void* userdata )
+{
+    reinterpret_cast<LocalServer*>( userdata )->Run();
+
+    return NULL;
+}
+
+void LocalServer::Run()
+{
+    std::vector<struct epoll_event> events( 1024 );
+    std::vector<Connection*>        connections;
+
+    while( running )
+    {
+        int ready = epoll_wait( epollFd, &events[0], static_cast<int>( events.size() ), -1 );
+
+        for( int i = 0; i < ready; i++ )
+        {
+            if( events[i].data.ptr == NULL )
+            {
+                Accept();
+                continue;
+            }
+
+            if( events[i].data.ptr == &wakeFd )
+                continue;
+
+            Connection* connection = reinterpret_cast<Connection*>( events[i].data.ptr );
+
+            if( events[i].events & ( EPOLLERR | EPOLLHUP ) )
+            {
+                Close( connection );
+                continue;
+            }
+
+            if( events[i].events & EPOLLOUT )
+            {
+                if( !Write( connection ) )
+                    continue;
+            }
+
+            if( events[i].events & EPOLLIN )
+                Read( connection );
+        }
+    }
+
+    // connections still open at shutdown are reclaimed with the process
+}
+
+void LocalServer::Accept()
+{
+    for( ;; )
+    {
+        int fd  = accept( listenFd, NULL, NULL );
+        int one = 1;
+
+        if( fd < 0 )
+            return;
+
+        SetNonBlocking( fd );
+        setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof( one ) );
+
+        Connection* connection       = new Connection();
+        connection->fd               = fd;
+        connection->outOffset        = 0;
+        connection->patternOffset    = 0;
+        connection->patternRemaining = 0;
+        connection->closeAfter       = false;
+
+        struct epoll_event event;
+        memset( &event, 0, sizeof( event ) );
+
+        event.events   = EPOLLIN;
+        event.data.ptr = connection;
+        epoll_ctl( epollFd, EPOLL_CTL_ADD, fd, &event );
+
+        pthread_mutex_lock( &mutex );
+        statistics.connections++;
+        pthread_mutex_unlock( &mutex );
+    }
+}
+
+void LocalServer::Read( Connection* connection )
+{
+    char buffer[16384];
+
+    for( ;; )
+    {
+        ssize_t count = read( connection->fd, buffer, sizeof( buffer ) );
+
+        if( count == 0 || ( count < 0 && errno != EAGAIN && errno != EINTR ) )
+        {
+            Close( connection );
+            return;
+        }
+
+        if( count < 0 )
+            break;
+
+        connection->in.append( buffer, count );
+    }
+
+    // answer one request at a time, the next one is parsed once this one is written
+    if( connection->out.empty() && connection->patternRemaining == 0 )
+    {
+        if( ParseRequest( connection ) )
+            Write( connection );
+    }
+}
+
+/**
+ * @return false if the connection was closed
+ */
+bool LocalServer::Write( Connection* connection )
+{
+    for( ;; )
+    {
+        while( connection->outOffset < connection->out.size() )
+        {
+            ssize_t count = send( connection->fd, connection->out.data() + connection->outOffset, connection->out.size() - connection->outOffset, MSG_NOSIGNAL );
+
+            if( count < 0 && errno == EAGAIN )
+                goto blocked;
+
+            if( count <= 0 )
+            {
+                Close( connection );
+                return false;
+            }
+
+            connection->outOffset += count;
+        }
+
+        while( connection->patternRemaining > 0 )
+        {
+            size_t  chunk = static_cast<size_t>( std::min<unsigned long long>( connection->patternRemaining, kChunkSize ) );
+            ssize_t count = send( connection->fd, PatternTable + connection->patternOffset % kPatternPeriod, chunk, MSG_NOSIGNAL );
+
+            if( count < 0 && errno == EAGAIN )
+                goto blocked;
+
+            if( count <= 0 )
+            {
+                Close( connection );
+                return false;
+            }
+
+            connection->patternOffset    += count;
+            connection->patternRemaining -= count;
+        }
+
+        connection->out.clear();
+        connection->outOffset = 0;
+
+        if( connection->closeAfter )
+        {
+            Close( connection );
+            return false;
+        }
+
+        // serve a request that was pipelined behind the one just written
+        if( !ParseRequest( connection ) )
+            break;
+    }
+
+    {
+        struct epoll_event event;
+        memset( &event, 0, sizeof( event ) );
+
+        event.events   = EPOLLIN;
+        event.data.ptr = connection;
+        epoll_ctl( epollFd, EPOLL_CTL_MOD, connection->fd, &event );
+    }
+
+    return true;
+
+blocked:
+    {
+        struct epoll_event event;
+        memset( &event, 0, sizeof( event ) );
+
+        event.events   = EPOLLIN | EPOLLOUT;
+        event.data.ptr = connection;
+        epoll_ctl( epollFd, EPOLL_CTL_MOD, connection->fd, &event );
+    }
+
+    return true;
+}
+
+void LocalServer::Close( Connection* connection )
+{
+    epoll_ctl( epollFd, EPOLL_CTL_DEL, connection->fd, NULL );
+    close( connection->fd );
+
+    delete connection;
+}
+
+/**
+ * @brief parse one complete request from the input buffer and queue the answer
+ *
+ * @return true if a response was queued
+ */
+bool LocalServer::ParseRequest( Connection* connection )
+{
+    size_t headerEnd = connection->in.find( "\r\n\r\n" );
+
+    if( headerEnd == std::string::npos )
+        return false;
+
+    Request request;
+    size_t  lineEnd = connection->in.find( "\r\n" );
+    std::string line = connection->in.substr( 0, lineEnd );
+
+    size_t firstSpace  = line.find( ' ' );
+    size_t secondSpace = line.find( ' ', firstSpace + 1 );
+
+    request.method = line.substr( 0, firstSpace );
+    request.path   = line.substr( firstSpace + 1, secondSpace - firstSpace - 1 );
+
+    size_t position = lineEnd + 2;
+
+    while( position < headerEnd )
+    {
+        size_t end   = connection->in.find( "\r\n", position );
+        size_t colon = connection->in.find( ':', position );
+
+        if( colon != std::string::npos && colon < end )
+            request.headers[Lower( connection->in.substr( position, colon - position ) )] = Trim( connection->in.substr( colon + 1, end - colon - 1 ) );
+
+        position = end + 2;
+    }
+
+    size_t bodyLength = 0;
+
+    if( request.headers.count( "content-length" ) > 0 )
+        bodyLength = strtoul( request.headers["content-length"].c_str(), NULL, 10 );
+
+    if( connection->in.size() < headerEnd + 4 + bodyLength )
+        return false;
+
+    request.body = connection->in.substr( headerEnd + 4, bodyLength );
+    connection->in.erase( 0, headerEnd + 4 + bodyLength );
+
+    Respond( connection, request );
+
+    return true;
+}
+
+void LocalServer::Respond( Connection* connection, const Request& request )
+{
+    Response response;
+
+    Handle( request, response );
+
+    unsigned long long total  = response.body.empty() ? response.generatedSize : response.body.size();
+    unsigned long long first  = 0;
+    unsigned long long length = total;
+    int                code   = response.code;
+    char               line[256];
+
+    if( response.ranges && code == 200 && request.headers.count( "range" ) > 0 )
+    {
+        std::map<std::string, std::string>::const_iterator ifRange = request.headers.find( "if-range" );
+        bool                                               matches = true;
+
+        if( ifRange != request.headers.end() )
+        {
+            matches = false;
+
+            for( size_t i = 0; i < response.headers.size(); i++ )
+            {
+                std::string name = Lower( response.headers[i].first );
+
+                if( ( name == "etag" || name == "last-modified" ) && response.headers[i].second == ifRange->second )
+                    matches = true;
+            }
+        }
+
+        unsigned long long rangeFirst = 0;
+        unsigned long long rangeLast  = 0;
+        const std::string& range      = request.headers.find( "range" )->second;
+        int                fields     = sscanf( range.c_str(), "bytes=%llu-%llu", &rangeFirst, &rangeLast );
+
+        if( matches && fields >= 1 && rangeFirst < total )
+        {
+            if( fields == 1 || rangeLast >= total )
+                rangeLast = total - 1;
+
+            first  = rangeFirst;
+            length = rangeLast - rangeFirst + 1;
+            code   = 206;
+
+            snprintf( line, sizeof( line ), "bytes %llu-%llu/%llu", first, rangeLast, total );
+            response.headers.push_back( std::make_pair( std::string( "Content-Range" ), std::string( line ) ) );
+        }
+    }
+
+    if( response.ranges )
+        response.headers.push_back( std::make_pair( std::string( "Accept-Ranges" ), std::string( "bytes" ) ) );
+
+    if( response.closeDelimited )
+        snprintf( line, sizeof( line ), "HTTP/1.1 %d %s\r\nConnection: close\r\n", code, code < 300 ? "OK" : "Error" );
+    else
+        snprintf( line, sizeof( line ), "HTTP/1.1 %d %s\r\nContent-Length: %llu\r\n", code, code < 300 ? "OK" : "Error", length );
+
+    connection->out.append( line );
+
+    for( size_t i = 0; i < response.headers.size(); i++ )
+        connection->out.append( response.headers[i].first + ": " + response.headers[i].second + "\r\n" );
+
+    connection->out.append( "\r\n" );
+
+    unsigned long long sent = length;
+
+    if( request.method == "HEAD" )
+        sent = 0;
+
+    if( response.closeDelimited )
+        connection->closeAfter = true;
+
+    if( response.dropAfter > 0 && response.dropAfter < sent )
+    {
+        sent                   = response.dropAfter;
+        connection->closeAfter = true;
+    }
+
+    if( response.body.empty() )
+    {
+        connection->patternOffset    = first;
+        connection->patternRemaining = sent;
+    }
+    else
+    {
+        connection->out.append( response.body, static_cast<size_t>( first ), static_cast<size_t>( sent ) );
+    }
+
+    pthread_mutex_lock( &mutex );
+    statistics.requests++;
+    statistics.bodyBytesSent += sent;
+    pthread_mutex_unlock( &mutex );
+}
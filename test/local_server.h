@@ -0,0 +1,95 @@
+/**
+ * @file local_server.h
+ * @brief in-process HTTP/1.1 server for tests and benchmarks
+ */
+
+#ifndef TEST_LOCAL_SERVER_H_
+#define TEST_LOCAL_SERVER_H_
+
+#include <pthread.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Minimal epoll based HTTP/1.1 server running on its own thread. It keeps
+ * connections alive, answers HEAD and single byte range requests and can
+ * serve large generated bodies without holding them in memory, which is
+ * enough to exercise the client against a local peer.
+ */
+class LocalServer
+{
+public:
+    typedef struct Request_s
+    {
+        std::string                        method;
+        std::string                        path;
+        std::map<std::string, std::string> headers;  // lower case names
+        std::string                        body;
+    } Request;
+
+    typedef struct Response_s
+    {
+        int                                              code;
+        std::vector<std::pair<std::string, std::string>> headers;
+        std::string                                      body;
+        unsigned long long                               generatedSize;  // pattern body used when body is empty
+        unsigned long long                               dropAfter;      // close after this many body bytes, 0 never
+        bool                                             ranges;         // honour Range/If-Range against the full body
+        bool                                             closeDelimited; // no Content-Length, the body ends with the connection
+
+        Response_s() : code( 200 ), headers(), body(), generatedSize( 0 ), dropAfter( 0 ), ranges( false ), closeDelimited( false )
+        {}
+    } Response;
+
+    typedef struct Statistics_s
+    {
+        unsigned long      connections;
+        unsigned long      requests;
+        unsigned long long bodyBytesSent;
+    } Statistics;
+
+    LocalServer();
+    virtual ~LocalServer();
+
+    bool        Start();
+    void        Stop();
+    int         Port() const;
+    std::string Url( const std::string& path = "/" ) const;
+    Statistics  GetStatistics();
+
+    /** byte at offset of a generated body */
+    static char PatternByte( unsigned long long offset );
+
+protected:
+    /** called on the server thread, the default answers every path with "GET succesful." */
+    virtual void Handle( const Request& request, Response& response );
+
+private:
+    LocalServer( const LocalServer& );
+    LocalServer& operator=( const LocalServer& );
+
+    struct Connection;
+
+    static void* ThreadMain( void* userdata );
+
+    void Run();
+    void Accept();
+    void Read( Connection* connection );
+    bool Write( Connection* connection );
+    void Close( Connection* connection );
+    bool ParseRequest( Connection* connection );
+    void Respond( Connection* connection, const Request& request );
+
+    int             listenFd;
+    int             epollFd;
+    int             wakeFd;
+    int             port;
+    bool            running;
+    pthread_t       thread;
+    pthread_mutex_t mutex;
+    Statistics      statistics;
+};
+
+#endif  // TEST_LOCAL_SERVER_H_
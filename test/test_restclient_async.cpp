@@ -0,0 +1,100 @@
+#include "restclient-cpp/restclient.h"
+#include "local_server.h"
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <future>
+#include <string>
+#include <vector>
+
+class RestClientAsyncTest : public ::testing::Test
+{
+ protected:
+    LocalServer         server;
+    RestClient::Request request;
+
+    RestClientAsyncTest()
+    {
+    }
+
+    virtual ~RestClientAsyncTest()
+    {
+    }
+
+    virtual void SetUp()
+    {
+      ASSERT_TRUE(server.Start());
+      request.url = server.Url("/");
+    }
+
+    virtual void TearDown()
+    {
+      server.Stop();
+    }
+
+};
+
+class CountingCallback : public RestClientCompletionCallback
+{
+ public:
+    std::promise<void> done;
+    int                remaining;
+    int                succeeded;
+
+    explicit CountingCallback(int count) : remaining(count), succeeded(0)
+    {
+    }
+
+    virtual void OnComplete(RestClient::Response& response)
+    {
+      if (response.code == 200 && response.body == "GET succesful.")
+        succeeded++;
+      if (--remaining == 0)
+        done.set_value();
+    }
+};
+
+// Tests
+TEST_F(RestClientAsyncTest, TestRestClientGetAsyncFuture)
+{
+  RestClient::Response res = RestClient::GetAsync(request).get();
+  EXPECT_EQ(200, res.code);
+  EXPECT_EQ("GET succesful.", res.body);
+}
+// check many transfers in flight on the single I/O thread
+TEST_F(RestClientAsyncTest, TestRestClientGetAsyncCallback)
+{
+  CountingCallback callback(500);
+  for (int i = 0; i < 500; i++)
+    ASSERT_TRUE(RestClient::GetAsync(request, &callback));
+  callback.done.get_future().wait();
+  EXPECT_EQ(500, callback.succeeded);
+}
+// check requests without a callback run and leave the I/O thread alone
+TEST_F(RestClientAsyncTest, TestRestClientGetAsyncNoCallback)
+{
+  ASSERT_TRUE(RestClient::GetAsync(request, static_cast<RestClientCompletionCallback*>(NULL)));
+  RestClient::Response res = RestClient::GetAsync(request).get();
+  EXPECT_EQ(200, res.code);
+  for (int i = 0; i < 100 && server.GetStatistics().requests < 2; i++)
+    usleep(10000);
+  EXPECT_EQ(2u, server.GetStatistics().requests);
+}
+// check post through the multi engine
+TEST_F(RestClientAsyncTest, TestRestClientPostAsyncCode)
+{
+  std::map<std::string, RestClient::FormItem> form;
+  RestClient::FormItem item;
+  item.value = "data";
+  item.type = RestClient::kString;
+  form["field"] = item;
+  RestClient::Response res = RestClient::PostAsync(request, form).get();
+  EXPECT_EQ(200, res.code);
+}
+// check for failure
+TEST_F(RestClientAsyncTest, TestRestClientFailureCode)
+{
+  RestClient::Request failing;
+  failing.url = "http://nonexistent";
+  RestClient::Response res = RestClient::GetAsync(failing).get();
+  EXPECT_EQ(-1, res.code);
+}
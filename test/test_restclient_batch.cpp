@@ -0,0 +1,90 @@
+#include "restclient-cpp/restclient.h"
+#include "local_server.h"
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+#include <vector>
+
+class EchoPathServer : public LocalServer
+{
+ protected:
+    virtual void Handle(const Request& request, Response& response)
+    {
+      response.body = request.path;
+    }
+};
+
+class StreamingCallback : public RestClientBatchCallback
+{
+ public:
+    std::vector<size_t> order;
+
+    virtual void OnResponse(size_t index, RestClient::Response& /* response */)
+    {
+      order.push_back(index);
+    }
+};
+
+class RestClientBatchTest : public ::testing::Test
+{
+ protected:
+    EchoPathServer                   server;
+    std::vector<RestClient::Request> requests;
+
+    RestClientBatchTest()
+    {
+    }
+
+    virtual ~RestClientBatchTest()
+    {
+    }
+
+    virtual void SetUp()
+    {
+      ASSERT_TRUE(server.Start());
+      for (int i = 0; i < 200; i++)
+      {
+        RestClient::Request request;
+        request.url = server.Url("/shard/" + std::to_string(i));
+        requests.push_back(request);
+      }
+    }
+
+    virtual void TearDown()
+    {
+      server.Stop();
+    }
+
+};
+
+// Tests
+TEST_F(RestClientBatchTest, TestRestClientPerformOrder)
+{
+  std::vector<RestClient::Response> res = RestClient::Perform(requests);
+  ASSERT_EQ(requests.size(), res.size());
+  for (size_t i = 0; i < res.size(); i++)
+  {
+    EXPECT_EQ(200, res[i].code);
+    EXPECT_EQ("/shard/" + std::to_string(i), res[i].body);
+  }
+}
+// check every completion is streamed exactly once
+TEST_F(RestClientBatchTest, TestRestClientPerformStreaming)
+{
+  StreamingCallback        callback;
+  RestClient::BatchOptions options;
+  options.maxParallel = 4;
+  options.callback = &callback;
+  std::vector<RestClient::Response> res = RestClient::Perform(requests, options);
+  ASSERT_EQ(requests.size(), callback.order.size());
+  EXPECT_EQ(requests.size(), std::set<size_t>(callback.order.begin(), callback.order.end()).size());
+  EXPECT_EQ("/shard/199", res[199].body);
+}
+// check for failure in the middle of a batch
+TEST_F(RestClientBatchTest, TestRestClientFailureCode)
+{
+  requests[3].url = "http://nonexistent";
+  std::vector<RestClient::Response> res = RestClient::Perform(requests);
+  EXPECT_EQ(-1, res[3].code);
+  EXPECT_EQ(200, res[4].code);
+}
@@ -0,0 +1,72 @@
+#include "restclient-cpp/restclient.h"
+#include "alloc_counter.h"
+#include "local_server.h"
+#include <gtest/gtest.h>
+#include <string>
+
+class SizedServer : public LocalServer
+{
+ protected:
+    virtual void Handle(const Request& /* request */, Response& response)
+    {
+      response.generatedSize = 1024 * 1024;
+    }
+};
+
+class RestClientBodyTest : public ::testing::Test
+{
+ protected:
+    SizedServer         server;
+    RestClient::Request request;
+
+    RestClientBodyTest()
+    {
+    }
+
+    virtual ~RestClientBodyTest()
+    {
+    }
+
+    virtual void SetUp()
+    {
+      ASSERT_TRUE(server.Start());
+      request.url = server.Url("/");
+      // open the connection so only the transfer itself is counted
+      RestClient::Get(request);
+    }
+
+    virtual void TearDown()
+    {
+      RestClient::SetBodySettings(RestClient::BodySettings());
+      server.Stop();
+    }
+};
+
+// Tests
+// check a known size body is allocated once
+TEST_F(RestClientBodyTest, TestRestClientReserveContentLength)
+{
+  RestClient::Response res;
+  {
+    AllocCounter counter(64 * 1024);
+    res = RestClient::Get(request);
+    EXPECT_EQ(1u, counter.Count());
+  }
+  EXPECT_EQ(200, res.code);
+  ASSERT_EQ(1024u * 1024u, res.body.size());
+  EXPECT_EQ(LocalServer::PatternByte(1024 * 1024 - 1), res.body[1024 * 1024 - 1]);
+}
+// check lengths above the limit are not reserved
+TEST_F(RestClientBodyTest, TestRestClientReserveLimit)
+{
+  RestClient::BodySettings settings;
+  settings.reserveLimit = 1024;
+  RestClient::SetBodySettings(settings);
+  RestClient::Response res;
+  {
+    AllocCounter counter(64 * 1024);
+    res = RestClient::Get(request);
+    EXPECT_LT(1u, counter.Count());
+  }
+  EXPECT_EQ(1024u * 1024u, res.body.size());
+}
@@ -0,0 +1,125 @@
+#include "restclient-cpp/restclient.h"
+#include "alloc_counter.h"
+#include "local_server.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+static const size_t kBodySize = 256 * 1024;
+
+class QuarterMegabyteServer : public LocalServer
+{
+ protected:
+    virtual void Handle(const Request& /* request */, Response& response)
+    {
+      response.generatedSize = kBodySize;
+    }
+};
+
+class RestClientBodyPoolTest : public ::testing::Test
+{
+ protected:
+    QuarterMegabyteServer server;
+    RestClient::Request   request;
+
+    RestClientBodyPoolTest()
+    {
+    }
+
+    virtual ~RestClientBodyPoolTest()
+    {
+    }
+
+    virtual void SetUp()
+    {
+      ASSERT_TRUE(server.Start());
+      request.url = server.Url("/");
+      RestClient::Get(request);
+    }
+
+    virtual void TearDown()
+    {
+      RestClient::SetBodyPoolSettings(RestClient::BodyPoolSettings());
+      server.Stop();
+    }
+
+    static void Enable(size_t maxBytes)
+    {
+      RestClient::BodyPoolSettings settings;
+      settings.maxBytes = maxBytes;
+      RestClient::SetBodyPoolSettings(settings);
+    }
+};
+
+// Tests
+// check a poller stops allocating bodies once the pool is warm
+TEST_F(RestClientBodyPoolTest, TestRestClientBodyPoolSteadyState)
+{
+  Enable(4 * 1024 * 1024);
+  RestClient::Get(request);
+  RestClient::BodyPoolStatistics before = RestClient::GetBodyPoolStatistics();
+  {
+    AllocCounter counter(64 * 1024);
+    for (int i = 0; i < 100; i++)
+    {
+      RestClient::Response res = RestClient::Get(request);
+      ASSERT_EQ(kBodySize, res.body.size());
+      EXPECT_EQ(LocalServer::PatternByte(kBodySize - 1), res.body[kBodySize - 1]);
+    }
+    EXPECT_EQ(0u, counter.Count());
+  }
+  RestClient::BodyPoolStatistics after = RestClient::GetBodyPoolStatistics();
+  EXPECT_EQ(100u, after.hits - before.hits);
+  EXPECT_EQ(0u, after.misses - before.misses);
+  EXPECT_EQ(100u, after.recycled - before.recycled);
+  EXPECT_EQ(kBodySize, after.pooledBytes);
+}
+// check the pool never holds more than its cap
+TEST_F(RestClientBodyPoolTest, TestRestClientBodyPoolCap)
+{
+  Enable(kBodySize * 3);
+  RestClient::BodyPoolStatistics before = RestClient::GetBodyPoolStatistics();
+  {
+    std::vector<RestClient::Response> held;
+    for (int i = 0; i < 5; i++)
+      held.push_back(RestClient::Get(request));
+  }
+  RestClient::BodyPoolStatistics after = RestClient::GetBodyPoolStatistics();
+  EXPECT_EQ(kBodySize * 3, after.pooledBytes);
+  EXPECT_EQ(3u, after.recycled - before.recycled);
+  EXPECT_EQ(2u, after.dropped - before.dropped);
+}
+// check buffers released by the caller serve bodies received on the I/O thread
+TEST_F(RestClientBodyPoolTest, TestRestClientBodyPoolAsync)
+{
+  Enable(4 * 1024 * 1024);
+  std::vector<RestClient::Request> requests(6, request);
+  RestClient::Perform(requests);
+  RestClient::BodyPoolStatistics before = RestClient::GetBodyPoolStatistics();
+  std::vector<RestClient::Response> responses = RestClient::Perform(requests);
+  RestClient::BodyPoolStatistics after = RestClient::GetBodyPoolStatistics();
+  // two buffers stayed with this thread, the shared list had the rest
+  EXPECT_EQ(4u, after.hits - before.hits);
+  for (size_t i = 0; i < responses.size(); i++)
+    EXPECT_EQ(kBodySize, responses[i].body.size());
+  responses.clear();
+  // the buffers counted are the buffers kept
+  RestClient::CleanUp();
+  EXPECT_EQ(0u, RestClient::GetBodyPoolStatistics().pooledBytes);
+  RestClient::Init();
+}
+// check the pool is off by default and disabling it frees the buffers
+TEST_F(RestClientBodyPoolTest, TestRestClientBodyPoolDisabled)
+{
+  RestClient::BodyPoolStatistics before = RestClient::GetBodyPoolStatistics();
+  RestClient::Get(request);
+  RestClient::BodyPoolStatistics after = RestClient::GetBodyPoolStatistics();
+  EXPECT_EQ(before.recycled, after.recycled);
+  EXPECT_EQ(before.misses, after.misses);
+  Enable(4 * 1024 * 1024);
+  RestClient::Get(request);
+  EXPECT_EQ(kBodySize, RestClient::GetBodyPoolStatistics().pooledBytes);
+  RestClient::SetBodyPoolSettings(RestClient::BodyPoolSettings());
+  RestClient::Get(request);
+  EXPECT_EQ(0u, RestClient::GetBodyPoolStatistics().pooledBytes);
+}
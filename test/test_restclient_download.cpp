@@ -0,0 +1,203 @@
+#include "restclient-cpp/restclient.h"
+#include "local_server.h"
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+static const size_t kObjectSize = 1024 * 1024 + 123;
+
+class RangeServer : public LocalServer
+{
+ public:
+    int  served;
+    int  heads;
+    int  ranged;
+    int  whole;
+    bool changing;
+    unsigned long long dropAfter;
+
+    RangeServer() : served(0), heads(0), ranged(0), whole(0), changing(false), dropAfter(0)
+    {
+    }
+
+ protected:
+    virtual void Handle(const Request& request, Response& response)
+    {
+      response.generatedSize = request.path == "/small" ? 1000 : kObjectSize;
+      response.ranges = request.path != "/plain";
+      // a changing object gets a new ETag with every request
+      int version = changing ? __sync_fetch_and_add(&served, 1) : 0;
+      response.headers.push_back(std::make_pair("ETag", "\"v" + std::to_string(version) + "\""));
+      if (request.method == "HEAD")
+        __sync_fetch_and_add(&heads, 1);
+      else if (request.headers.count("range") > 0)
+      {
+        __sync_fetch_and_add(&ranged, 1);
+        response.dropAfter = dropAfter;
+      }
+      else
+        __sync_fetch_and_add(&whole, 1);
+    }
+};
+
+class ProgressRecorder : public RestClientTransferCallback
+{
+ public:
+    long calls;
+    long total;
+    long now;
+    bool monotonic;
+
+    ProgressRecorder() : calls(0), total(0), now(0), monotonic(true)
+    {
+    }
+
+    virtual int UpdateTransferInfo(long dltotal, long dlnow, long /* ultotal */, long /* ulnow */)
+    {
+      if (dlnow < now)
+        monotonic = false;
+      calls++;
+      total = dltotal;
+      now = dlnow;
+      return 0;
+    }
+};
+
+class RestClientDownloadTest : public ::testing::Test
+{
+ protected:
+    RangeServer                 server;
+    RestClient::Request         request;
+    RestClient::DownloadOptions options;
+    std::string                 path;
+
+    RestClientDownloadTest() : path("/tmp/restclient-download")
+    {
+    }
+
+    virtual ~RestClientDownloadTest()
+    {
+    }
+
+    virtual void SetUp()
+    {
+      ASSERT_TRUE(server.Start());
+      request.url = server.Url("/");
+      options.segments = 4;
+      options.minSegmentSize = 64 * 1024;
+    }
+
+    virtual void TearDown()
+    {
+      unlink(path.c_str());
+      unlink((path + ".resume").c_str());
+      server.Stop();
+    }
+
+    std::string ReadFile()
+    {
+      std::ifstream file(path.c_str(), std::ios::binary);
+      return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    bool MatchesPattern(const std::string& content)
+    {
+      for (size_t i = 0; i < content.size(); i++)
+      {
+        if (content[i] != LocalServer::PatternByte(i))
+          return false;
+      }
+      return true;
+    }
+};
+
+// Tests
+// check an object is fetched in concurrent ranges written at their offsets
+TEST_F(RestClientDownloadTest, TestRestClientDownloadSegments)
+{
+  RestClient::Response res = RestClient::Download(request, path, options, NULL);
+  EXPECT_EQ(200, res.code);
+  EXPECT_TRUE(res.body.empty());
+  EXPECT_EQ(1, server.heads);
+  EXPECT_EQ(4, server.ranged);
+  EXPECT_EQ(0, server.whole);
+  EXPECT_LE(2u, server.GetStatistics().connections);
+  std::string content = ReadFile();
+  ASSERT_EQ(kObjectSize, content.size());
+  EXPECT_TRUE(MatchesPattern(content));
+}
+// check the progress covers all ranges together
+TEST_F(RestClientDownloadTest, TestRestClientDownloadProgress)
+{
+  ProgressRecorder progress;
+  RestClient::Response res = RestClient::Download(request, path, options, &progress);
+  EXPECT_EQ(200, res.code);
+  EXPECT_LT(0, progress.calls);
+  EXPECT_TRUE(progress.monotonic);
+  EXPECT_EQ(static_cast<long>(kObjectSize), progress.total);
+  EXPECT_EQ(static_cast<long>(kObjectSize), progress.now);
+}
+// check servers without Accept-Ranges and small objects get one stream
+TEST_F(RestClientDownloadTest, TestRestClientDownloadSingleStream)
+{
+  request.url = server.Url("/plain");
+  RestClient::Response res = RestClient::Download(request, path, options, NULL);
+  EXPECT_EQ(200, res.code);
+  EXPECT_EQ(0, server.ranged);
+  EXPECT_EQ(1, server.whole);
+  EXPECT_EQ(kObjectSize, ReadFile().size());
+  request.url = server.Url("/small");
+  res = RestClient::Download(request, path, options, NULL);
+  EXPECT_EQ(200, res.code);
+  EXPECT_EQ(0, server.ranged);
+  EXPECT_EQ(2, server.whole);
+  std::string content = ReadFile();
+  ASSERT_EQ(1000u, content.size());
+  EXPECT_TRUE(MatchesPattern(content));
+}
+// check an object that changes between the probe and the ranges comes back whole
+TEST_F(RestClientDownloadTest, TestRestClientDownloadChanged)
+{
+  server.changing = true;
+  RestClient::Response res = RestClient::Download(request, path, options, NULL);
+  EXPECT_EQ(200, res.code);
+  EXPECT_EQ(1, server.whole);
+  std::string content = ReadFile();
+  ASSERT_EQ(kObjectSize, content.size());
+  EXPECT_TRUE(MatchesPattern(content));
+}
+// check a session download sees the session's limits
+TEST_F(RestClientDownloadTest, TestRestClientDownloadSessionLimits)
+{
+  RestClientSession session;
+  RestClient::Limits limits;
+  limits.maxBodyBytes = 64 * 1024;
+  session.SetLimits(limits);
+  RestClient::Response res = session.Download(request, path, options, NULL);
+  EXPECT_EQ(RestClient::kBodyTooLarge, res.code);
+}
+// check a resumed download only fetches the bytes the dropped ranges missed
+TEST_F(RestClientDownloadTest, TestRestClientDownloadResume)
+{
+  options.segments = 2;
+  options.resumable = true;
+  server.dropAfter = 300 * 1024;
+  RestClient::Response res = RestClient::Download(request, path, options, NULL);
+  EXPECT_EQ(RestClient::kFailed, res.code);
+  EXPECT_EQ(0, access((path + ".resume").c_str(), F_OK));
+  EXPECT_EQ(2, server.ranged);
+  server.dropAfter = 0;
+  ProgressRecorder progress;
+  res = RestClient::Download(request, path, options, &progress);
+  EXPECT_EQ(200, res.code);
+  EXPECT_EQ(4, server.ranged);
+  EXPECT_EQ(0, server.whole);
+  EXPECT_EQ(static_cast<long>(kObjectSize), progress.now);
+  EXPECT_EQ(kObjectSize, server.GetStatistics().bodyBytesSent);
+  EXPECT_NE(0, access((path + ".resume").c_str(), F_OK));
+  std::string content = ReadFile();
+  ASSERT_EQ(kObjectSize, content.size());
+  EXPECT_TRUE(MatchesPattern(content));
+}
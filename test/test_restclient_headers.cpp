@@ -0,0 +1,246 @@
+#include "restclient-cpp/restclient.h"
+#include "alloc_counter.h"
+#include "local_server.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+
+class HeaderServer : public LocalServer
+{
+ protected:
+    virtual void Handle(const Request& /* request */, Response& response)
+    {
+      response.body = "ok";
+      response.headers.push_back(std::make_pair(std::string("Content-Type"), std::string("application/json")));
+      response.headers.push_back(std::make_pair(std::string("Set-Cookie"), std::string("a=1")));
+      response.headers.push_back(std::make_pair(std::string("Vary"), std::string("Accept")));
+      response.headers.push_back(std::make_pair(std::string("set-cookie"), std::string("b=2")));
+      for (int i = 0; i < 30; i++)
+        response.headers.push_back(std::make_pair("X-Header-" + std::to_string(i), "value " + std::to_string(i)));
+    }
+};
+
+static void AddLine(RestClientHeaders& headers, const std::string& line)
+{
+  headers.Add(line.data(), line.size());
+}
+
+class RestClientHeadersTest : public ::testing::Test
+{
+ protected:
+    HeaderServer        server;
+    RestClient::Request request;
+
+    RestClientHeadersTest()
+    {
+    }
+
+    virtual ~RestClientHeadersTest()
+    {
+    }
+
+    virtual void SetUp()
+    {
+      ASSERT_TRUE(server.Start());
+      request.url = server.Url("/");
+    }
+
+    virtual void TearDown()
+    {
+      RestClient::SetHeaderSettings(RestClient::HeaderSettings());
+      server.Stop();
+    }
+};
+
+// Tests
+TEST_F(RestClientHeadersTest, TestRestClientHeadersTrim)
+{
+  RestClientHeaders headers;
+  AddLine(headers, "  Content-Type :\t text/plain  \r\n");
+  AddLine(headers, "Empty:\r\n");
+  AddLine(headers, "no separator\r\n");
+  ASSERT_EQ(2u, headers.size());
+  EXPECT_EQ("text/plain", headers["Content-Type"]);
+  EXPECT_TRUE(headers.Has("Empty"));
+  EXPECT_EQ("", headers["Empty"]);
+  EXPECT_EQ(0u, headers.count("no separator"));
+}
+TEST_F(RestClientHeadersTest, TestRestClientHeadersCaseInsensitive)
+{
+  RestClientHeaders headers;
+  AddLine(headers, "ETag: \"abc\"\r\n");
+  AddLine(headers, "content-length: 12\r\n");
+  RestClientHeaders::Field field;
+  ASSERT_TRUE(headers.Find("Content-Length", strlen("Content-Length"), field));
+  EXPECT_EQ("12", std::string(field.value, field.valueLength));
+  EXPECT_EQ("\"abc\"", headers["etag"]);
+  EXPECT_FALSE(headers.Has("Content"));
+  EXPECT_FALSE(headers.Has("Content-Length-Extra"));
+}
+// check the map replaced by the flat store is still available
+TEST_F(RestClientHeadersTest, TestRestClientHeadersMap)
+{
+  RestClientHeaders headers;
+  AddLine(headers, "B: 2\r\n");
+  AddLine(headers, "A: 1\r\n");
+  RestClient::headermap map = headers;
+  ASSERT_EQ(2u, map.size());
+  EXPECT_EQ("1", map["A"]);
+  EXPECT_EQ("2", map["B"]);
+  EXPECT_STREQ("B", std::string(headers.At(0).name, headers.At(0).nameLength).c_str());
+}
+TEST_F(RestClientHeadersTest, TestRestClientResponseHeaders)
+{
+  RestClient::Response res = RestClient::Get(request);
+  EXPECT_EQ(200, res.code);
+  EXPECT_EQ("application/json", res.headers["Content-Type"]);
+  EXPECT_EQ("value 29", res.headers["x-header-29"]);
+  EXPECT_EQ("2", res.headers["Content-Length"]);
+}
+TEST_F(RestClientHeadersTest, TestRestClientHeadersRepeated)
+{
+  RestClientHeaders headers;
+  AddLine(headers, "Link: <a>\r\n");
+  AddLine(headers, "Vary: Accept\r\n");
+  AddLine(headers, "link: <b>\r\n");
+  AddLine(headers, "LINK: <c>\r\n");
+  EXPECT_EQ(3u, headers.Count("Link"));
+  EXPECT_EQ("<c>", headers["Link"]);
+
+  RestClientHeaders::ValueRange range = headers.Values("link");
+  RestClientHeaders::Field field;
+  EXPECT_EQ(3u, range.Size());
+  ASSERT_TRUE(range.Next(field));
+  EXPECT_EQ("<a>", std::string(field.value, field.valueLength));
+  ASSERT_TRUE(range.Next(field));
+  EXPECT_EQ("<b>", std::string(field.value, field.valueLength));
+  ASSERT_TRUE(range.Next(field));
+  EXPECT_EQ("<c>", std::string(field.value, field.valueLength));
+  EXPECT_FALSE(range.Next(field));
+  EXPECT_FALSE(headers.Values("Set-Cookie").Next(field));
+}
+// check the buffers survive a reset so the next hop does not allocate
+TEST_F(RestClientHeadersTest, TestRestClientHeadersClear)
+{
+  RestClientHeaders headers;
+  AddLine(headers, "Location: /next\r\n");
+  AddLine(headers, "Vary: Accept\r\n");
+  AllocCounter counter;
+  headers.Clear();
+  EXPECT_TRUE(headers.empty());
+  EXPECT_FALSE(headers.Has("Location"));
+  AddLine(headers, "Vary: Cookie\r\n");
+  EXPECT_EQ(1u, headers.Count("vary"));
+  EXPECT_EQ("Cookie", headers["Vary"]);
+  EXPECT_EQ(0u, counter.Count());
+}
+TEST_F(RestClientHeadersTest, TestRestClientResponseRepeatedHeaders)
+{
+  RestClient::Response res = RestClient::Get(request);
+  RestClientHeaders::ValueRange range = res.headers.Values("Set-Cookie");
+  RestClientHeaders::Field field;
+  ASSERT_EQ(2u, range.Size());
+  ASSERT_TRUE(range.Next(field));
+  EXPECT_EQ("a=1", std::string(field.value, field.valueLength));
+  ASSERT_TRUE(range.Next(field));
+  EXPECT_EQ("b=2", std::string(field.value, field.valueLength));
+}
+// check the perfect hash sends every well-known name to its own slot
+TEST_F(RestClientHeadersTest, TestRestClientHeadersClassify)
+{
+  for (int i = 0; i < RestClientHeaders::kUnknown; i++)
+  {
+    RestClientHeaders::Known known = static_cast<RestClientHeaders::Known>(i);
+    std::string name = RestClientHeaders::Name(known);
+    std::string lower = name;
+    for (size_t j = 0; j < lower.size(); j++)
+      lower[j] = static_cast<char>(tolower(lower[j]));
+    EXPECT_EQ(known, RestClientHeaders::Classify(name.data(), name.size())) << name;
+    EXPECT_EQ(known, RestClientHeaders::Classify(lower.data(), lower.size())) << name;
+  }
+  EXPECT_EQ(RestClientHeaders::kUnknown, RestClientHeaders::Classify("X-Custom", 8));
+  EXPECT_EQ(RestClientHeaders::kUnknown, RestClientHeaders::Classify("Content-Types", 13));
+  EXPECT_EQ(RestClientHeaders::kUnknown, RestClientHeaders::Classify("", 0));
+  EXPECT_TRUE(RestClientHeaders::Name(RestClientHeaders::kUnknown) == NULL);
+}
+TEST_F(RestClientHeadersTest, TestRestClientHeadersKnown)
+{
+  RestClientHeaders headers;
+  RestClientHeaders::Field field;
+  AddLine(headers, "etag: \"1\"\r\n");
+  AddLine(headers, "X-Custom: yes\r\n");
+  AddLine(headers, "ETAG: \"2\"\r\n");
+  ASSERT_TRUE(headers.Find(RestClientHeaders::kETag, field));
+  EXPECT_EQ("\"2\"", std::string(field.value, field.valueLength));
+  EXPECT_FALSE(headers.Find(RestClientHeaders::kContentType, field));
+  EXPECT_EQ("yes", headers["x-custom"]);
+  headers.Clear();
+  EXPECT_FALSE(headers.Find(RestClientHeaders::kETag, field));
+}
+TEST_F(RestClientHeadersTest, TestRestClientResponseKnownHeaders)
+{
+  RestClient::Response res = RestClient::Get(request);
+  RestClientHeaders::Field field;
+  ASSERT_TRUE(res.headers.Find(RestClientHeaders::kContentType, field));
+  EXPECT_EQ("application/json", std::string(field.value, field.valueLength));
+  ASSERT_TRUE(res.headers.Find(RestClientHeaders::kContentLength, field));
+  EXPECT_EQ("2", std::string(field.value, field.valueLength));
+}
+// check a response with 30 headers does not allocate per header
+TEST_F(RestClientHeadersTest, TestRestClientHeadersAllocations)
+{
+  std::string lines;
+  for (int i = 0; i < 30; i++)
+    lines += "X-Header-" + std::to_string(i) + ": value " + std::to_string(i) + "\r\n";
+  AllocCounter counter;
+  RestClientHeaders headers;
+  for (size_t start = 0; start < lines.size();)
+  {
+    size_t end = lines.find('\n', start) + 1;
+    headers.Add(lines.data() + start, end - start);
+    start = end;
+  }
+  EXPECT_EQ(30u, headers.size());
+  EXPECT_GE(3u, counter.Count());
+}
+// check lazy headers only copy the block until they are looked at
+TEST_F(RestClientHeadersTest, TestRestClientHeadersLazy)
+{
+  std::string lines;
+  for (int i = 0; i < 30; i++)
+    lines += "X-Header-" + std::to_string(i) + ": value " + std::to_string(i) + "\r\n";
+  RestClientHeaders headers;
+  headers.SetLazy(true);
+  {
+    AllocCounter counter;
+    for (size_t start = 0; start < lines.size();)
+    {
+      size_t end = lines.find('\n', start) + 1;
+      headers.Add(lines.data() + start, end - start);
+      start = end;
+    }
+    EXPECT_GE(1u, counter.Count());
+  }
+  AddLine(headers, "Content-Length: 12\r\n");
+  RestClientHeaders::Field field;
+  ASSERT_TRUE(headers.Find(RestClientHeaders::kContentLength, field));
+  EXPECT_EQ("12", std::string(field.value, field.valueLength));
+  EXPECT_EQ(31u, headers.size());
+  EXPECT_EQ("value 7", headers["x-header-7"]);
+  AddLine(headers, "X-Header-7: again\r\n");
+  EXPECT_EQ(2u, headers.Count("X-Header-7"));
+  EXPECT_EQ("again", headers["X-Header-7"]);
+}
+TEST_F(RestClientHeadersTest, TestRestClientResponseLazyHeaders)
+{
+  RestClient::HeaderSettings settings;
+  settings.lazy = true;
+  RestClient::SetHeaderSettings(settings);
+  RestClient::Response res = RestClient::Get(request);
+  EXPECT_EQ(200, res.code);
+  EXPECT_EQ("ok", res.body);
+  EXPECT_TRUE(res.headers.Lazy());
+  EXPECT_EQ("application/json", res.headers["Content-Type"]);
+  EXPECT_EQ(2u, res.headers.Count("Set-Cookie"));
+  EXPECT_EQ(35u, res.headers.size());
+}
@@ -0,0 +1,211 @@
+#include "restclient-cpp/restclient.h"
+#include "local_server.h"
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// nghttpd serving a directory over TLS, libcurl only multiplexes h2 over TLS
+class Http2Peer
+{
+ public:
+    pid_t       pid;
+    int         port;
+    std::string directory;
+
+    Http2Peer() : pid(-1), port(0), directory("/tmp/restclient-h2peer")
+    {
+    }
+
+    ~Http2Peer()
+    {
+      Stop();
+    }
+
+    bool Start()
+    {
+      if (system("command -v nghttpd >/dev/null 2>&1 && command -v openssl >/dev/null 2>&1") != 0)
+        return false;
+      std::string setup = "mkdir -p " + directory + " && cd " + directory +
+                          " && echo hello > index.html && openssl req -x509 -newkey rsa:2048 -nodes"
+                          " -keyout key.pem -out cert.pem -days 1 -subj /CN=localhost"
+                          " -addext subjectAltName=DNS:localhost >/dev/null 2>&1";
+      if (system(setup.c_str()) != 0)
+        return false;
+      port = FreePort();
+      pid = fork();
+      if (pid == 0)
+      {
+        std::string number = std::to_string(port);
+        execlp("nghttpd", "nghttpd", "-a", "127.0.0.1", "-d", directory.c_str(), number.c_str(),
+               (directory + "/key.pem").c_str(), (directory + "/cert.pem").c_str(), (char*)NULL);
+        _exit(127);
+      }
+      // wait for the listener
+      for (int i = 0; i < 100; i++)
+      {
+        if (Connects())
+          return true;
+        usleep(50 * 1000);
+      }
+      return false;
+    }
+
+    void Stop()
+    {
+      if (pid > 0)
+      {
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+        pid = -1;
+      }
+    }
+
+ private:
+    static int FreePort()
+    {
+      int fd = socket(AF_INET, SOCK_STREAM, 0);
+      struct sockaddr_in address = sockaddr_in();
+      socklen_t length = sizeof(address);
+      address.sin_family = AF_INET;
+      address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      bind(fd, (struct sockaddr*)&address, sizeof(address));
+      getsockname(fd, (struct sockaddr*)&address, &length);
+      close(fd);
+      return ntohs(address.sin_port);
+    }
+
+    bool Connects() const
+    {
+      int fd = socket(AF_INET, SOCK_STREAM, 0);
+      struct sockaddr_in address = sockaddr_in();
+      address.sin_family = AF_INET;
+      address.sin_port = htons(port);
+      address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      bool connected = connect(fd, (struct sockaddr*)&address, sizeof(address)) == 0;
+      close(fd);
+      return connected;
+    }
+};
+
+class RestClientHttp2Test : public ::testing::Test
+{
+ protected:
+    LocalServer                      server;
+    std::vector<RestClient::Request> requests;
+
+    RestClientHttp2Test()
+    {
+    }
+
+    virtual ~RestClientHttp2Test()
+    {
+    }
+
+    virtual void SetUp()
+    {
+      ASSERT_TRUE(server.Start());
+      requests.resize(100);
+      for (size_t i = 0; i < requests.size(); i++)
+        requests[i].url = server.Url("/");
+    }
+
+    virtual void TearDown()
+    {
+      RestClient::SetHttp2Settings(RestClient::Http2Settings());
+      RestClient::SetTlsSettings(RestClient::TlsSettings());
+      server.Stop();
+    }
+
+    // connections of the engine that went to this test's server
+    std::vector<RestClient::ConnectionStatistics> ServerConnections()
+    {
+      return Connections(server.Port());
+    }
+
+    std::vector<RestClient::ConnectionStatistics> Connections(int serverPort)
+    {
+      std::vector<RestClient::ConnectionStatistics> all = RestClient::GetConnectionStatistics();
+      std::vector<RestClient::ConnectionStatistics> result;
+      std::string port = ":" + std::to_string(serverPort);
+      for (size_t i = 0; i < all.size(); i++)
+      {
+        if (all[i].remote.size() > port.size() &&
+            all[i].remote.compare(all[i].remote.size() - port.size(), port.size(), port) == 0)
+          result.push_back(all[i]);
+      }
+      return result;
+    }
+};
+
+// Tests
+// the local server only speaks HTTP/1.1, streams are counted all the same
+TEST_F(RestClientHttp2Test, TestRestClientConnectionStatistics)
+{
+  RestClient::Http2Settings settings;
+  settings.enabled = true;
+  RestClient::SetHttp2Settings(settings);
+  std::vector<RestClient::Response> res = RestClient::Perform(requests);
+  for (size_t i = 0; i < res.size(); i++)
+    EXPECT_EQ(200, res[i].code);
+  std::vector<RestClient::ConnectionStatistics> connections = ServerConnections();
+  unsigned long streams = 0;
+  for (size_t i = 0; i < connections.size(); i++)
+  {
+    streams += connections[i].streams;
+    EXPECT_EQ(0u, connections[i].activeStreams);
+    EXPECT_LE(1u, connections[i].peakStreams);
+  }
+  EXPECT_EQ(requests.size(), streams);
+}
+// check the stream limit holds transfers back per origin
+TEST_F(RestClientHttp2Test, TestRestClientStreamLimit)
+{
+  RestClient::Http2Settings settings;
+  settings.enabled = true;
+  settings.maxConcurrentStreams = 2;
+  RestClient::SetHttp2Settings(settings);
+  RestClient::BatchOptions options;
+  options.maxParallel = 50;
+  std::vector<RestClient::Response> res = RestClient::Perform(requests, options);
+  for (size_t i = 0; i < res.size(); i++)
+    EXPECT_EQ(200, res[i].code);
+  EXPECT_GE(2u, server.GetStatistics().connections);
+}
+// check requests to an HTTP/2 peer share one connection as concurrent streams
+TEST_F(RestClientHttp2Test, TestRestClientMultiplexed)
+{
+  Http2Peer peer;
+  if (!peer.Start())
+  {
+    std::cout << "nghttpd or openssl not available, skipped" << std::endl;
+    return;
+  }
+  RestClient::TlsSettings tls;
+  tls.caFile = peer.directory + "/cert.pem";
+  RestClient::SetTlsSettings(tls);
+  RestClient::Http2Settings settings;
+  settings.enabled = true;
+  RestClient::SetHttp2Settings(settings);
+  for (size_t i = 0; i < requests.size(); i++)
+    requests[i].url = "https://localhost:" + std::to_string(peer.port) + "/index.html";
+  RestClient::BatchOptions options;
+  options.maxParallel = 0;
+  std::vector<RestClient::Response> res = RestClient::Perform(requests, options);
+  for (size_t i = 0; i < res.size(); i++)
+  {
+    EXPECT_EQ(200, res[i].code);
+    EXPECT_EQ("hello\n", res[i].body);
+  }
+  std::vector<RestClient::ConnectionStatistics> connections = Connections(peer.port);
+  ASSERT_EQ(1u, connections.size());
+  EXPECT_EQ(requests.size(), connections[0].streams);
+  EXPECT_LT(1u, connections[0].peakStreams);
+}
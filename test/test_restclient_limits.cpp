@@ -0,0 +1,139 @@
+#include "restclient-cpp/restclient.h"
+#include "local_server.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+static const size_t kBodySize = 1024 * 1024;
+
+class LimitedServer : public LocalServer
+{
+ protected:
+    virtual void Handle(const Request& request, Response& response)
+    {
+      response.generatedSize = kBodySize;
+      if (request.path == "/headers")
+      {
+        for (int i = 0; i < 64; i++)
+          response.headers.push_back(std::make_pair("X-Filler", std::string(100, 'x')));
+      }
+    }
+};
+
+class RestClientLimitsTest : public ::testing::Test
+{
+ protected:
+    LimitedServer       server;
+    RestClient::Request request;
+
+    RestClientLimitsTest()
+    {
+    }
+
+    virtual ~RestClientLimitsTest()
+    {
+    }
+
+    virtual void SetUp()
+    {
+      ASSERT_TRUE(server.Start());
+      request.url = server.Url("/");
+    }
+
+    virtual void TearDown()
+    {
+      RestClient::SetLimits(RestClient::Limits());
+      RestClient::SetBodySettings(RestClient::BodySettings());
+      server.Stop();
+    }
+};
+
+// Tests
+// check a body past the request limit aborts the transfer
+TEST_F(RestClientLimitsTest, TestRestClientBodyLimit)
+{
+  request.limits.maxBodyBytes = 64 * 1024;
+  RestClient::Response res = RestClient::Get(request);
+  EXPECT_EQ(RestClient::kBodyTooLarge, res.code);
+  EXPECT_EQ("Response body too large.", res.body);
+  request.limits.maxBodyBytes = kBodySize;
+  res = RestClient::Get(request);
+  EXPECT_EQ(200, res.code);
+  EXPECT_EQ(kBodySize, res.body.size());
+}
+// check the limit holds for bodies streamed into a sink
+TEST_F(RestClientLimitsTest, TestRestClientBodyLimitSink)
+{
+  std::string target;
+  RestClientStringSink sink(target);
+  request.limits.maxBodyBytes = 64 * 1024;
+  RestClient::Response res = RestClient::Get(request, &sink);
+  EXPECT_EQ(RestClient::kBodyTooLarge, res.code);
+  EXPECT_GE(64u * 1024u, target.size());
+}
+// check headers past the limit abort the transfer
+TEST_F(RestClientLimitsTest, TestRestClientHeaderLimit)
+{
+  request.url = server.Url("/headers");
+  request.limits.maxHeaderBytes = 1024;
+  RestClient::Response res = RestClient::Get(request);
+  EXPECT_EQ(RestClient::kHeadersTooLarge, res.code);
+  EXPECT_EQ("Response headers too large.", res.body);
+  request.limits.maxHeaderBytes = 64 * 1024;
+  res = RestClient::Get(request);
+  EXPECT_EQ(200, res.code);
+  EXPECT_EQ(64u, res.headers.Count("X-Filler"));
+}
+// check session limits apply unless the request sets its own
+TEST_F(RestClientLimitsTest, TestRestClientSessionLimits)
+{
+  RestClientSession session;
+  RestClient::Limits limits;
+  limits.maxBodyBytes = 64 * 1024;
+  session.SetLimits(limits);
+  EXPECT_EQ(RestClient::kBodyTooLarge, session.Get(request).code);
+  RestClientPreparedRequest prepared(session, request);
+  EXPECT_EQ(RestClient::kBodyTooLarge, prepared.Get().code);
+  request.limits.maxBodyBytes = kBodySize;
+  EXPECT_EQ(200, session.Get(request).code);
+  RestClient::SetLimits(limits);
+  RestClient::Request plain;
+  plain.url = request.url;
+  EXPECT_EQ(RestClient::kBodyTooLarge, RestClient::Get(plain).code);
+  EXPECT_EQ(RestClient::kBodyTooLarge, RestClient::GetAsync(plain).get().code);
+}
+// check the budget caps the bodies held in memory
+TEST_F(RestClientLimitsTest, TestRestClientBufferBudget)
+{
+  RestClient::BodySettings settings;
+  settings.bufferBudget = kBodySize / 2;
+  RestClient::SetBodySettings(settings);
+  RestClient::Response res = RestClient::Get(request);
+  EXPECT_EQ(RestClient::kOverBudget, res.code);
+  EXPECT_EQ("Response bodies over budget.", res.body);
+  EXPECT_EQ(0u, RestClient::GetBufferedBytes());
+  settings.bufferBudget = kBodySize * 3 / 2;
+  RestClient::SetBodySettings(settings);
+  std::vector<RestClient::Request> requests(4, request);
+  std::vector<RestClient::Response> responses = RestClient::Perform(requests);
+  for (size_t i = 0; i < responses.size(); i++)
+  {
+    if (responses[i].code == 200)
+      EXPECT_EQ(kBodySize, responses[i].body.size());
+    else
+      EXPECT_EQ(RestClient::kOverBudget, responses[i].code);
+  }
+  EXPECT_EQ(0u, RestClient::GetBufferedBytes());
+}
+// check bodies moved to disk stop counting against the budget
+TEST_F(RestClientLimitsTest, TestRestClientBufferBudgetSpill)
+{
+  RestClient::BodySettings settings;
+  settings.bufferBudget = kBodySize / 2;
+  settings.spillThreshold = 64 * 1024;
+  RestClient::SetBodySettings(settings);
+  RestClient::Response res = RestClient::Get(request);
+  EXPECT_EQ(200, res.code);
+  EXPECT_EQ(kBodySize, res.BodySize());
+  EXPECT_EQ(0u, RestClient::GetBufferedBytes());
+}
@@ -0,0 +1,100 @@
+#include "restclient-cpp/restclient.h"
+#include "local_server.h"
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <string>
+#include <thread>
+
+class DelayedServer : public LocalServer
+{
+ protected:
+    virtual void Handle(const Request& /* request */, Response& response)
+    {
+      usleep(200000);
+      response.body = "delayed";
+    }
+};
+
+class RestClientPoolTest : public ::testing::Test
+{
+ protected:
+    LocalServer         server;
+    DelayedServer       delayedServer;
+    RestClientSession   session;
+    RestClient::Request request;
+
+    RestClientPoolTest()
+    {
+    }
+
+    virtual ~RestClientPoolTest()
+    {
+    }
+
+    virtual void SetUp()
+    {
+      ASSERT_TRUE(server.Start());
+      ASSERT_TRUE(delayedServer.Start());
+      request.url = server.Url("/");
+    }
+
+    virtual void TearDown()
+    {
+      delayedServer.Stop();
+      server.Stop();
+    }
+};
+
+// Tests
+// check sequential requests share one handle and its connection
+TEST_F(RestClientPoolTest, TestRestClientPoolReuse)
+{
+  for (int i = 0; i < 5; i++)
+    EXPECT_EQ(200, session.Get(request).code);
+  RestClient::PoolStatistics statistics = session.GetPoolStatistics();
+  EXPECT_EQ(1u, statistics.handlesCreated);
+  EXPECT_EQ(4u, statistics.handlesReused);
+  EXPECT_EQ(1u, statistics.connectionsOpened);
+  EXPECT_EQ(4u, statistics.connectionsReused);
+  EXPECT_EQ(1u, statistics.idleHandles);
+}
+// check handles idle past the timeout are closed
+TEST_F(RestClientPoolTest, TestRestClientPoolIdleTimeout)
+{
+  RestClient::PoolSettings settings;
+  settings.idleTimeout = 1;
+  session.SetPoolSettings(settings);
+  EXPECT_EQ(200, session.Get(request).code);
+  EXPECT_EQ(1u, session.GetPoolStatistics().idleHandles);
+  usleep(2100000);
+  RestClient::PoolStatistics statistics = session.GetPoolStatistics();
+  EXPECT_EQ(0u, statistics.idleHandles);
+  EXPECT_EQ(1u, statistics.handlesEvicted);
+  EXPECT_EQ(200, session.Get(request).code);
+  EXPECT_EQ(2u, session.GetPoolStatistics().connectionsOpened);
+}
+// check a full pool drops its least recently used handle
+TEST_F(RestClientPoolTest, TestRestClientPoolEvictsLeastRecentlyUsed)
+{
+  RestClient::PoolSettings settings;
+  settings.maxIdleHandles = 1;
+  session.SetPoolSettings(settings);
+  RestClient::Request delayed;
+  delayed.url = delayedServer.Url("/");
+  // the fast request releases its handle first, the delayed one comes back to a full pool
+  std::thread worker([this, delayed]() {
+    EXPECT_EQ(200, session.Get(delayed).code);
+  });
+  usleep(50000);
+  EXPECT_EQ(200, session.Get(request).code);
+  worker.join();
+  RestClient::PoolStatistics before = session.GetPoolStatistics();
+  EXPECT_EQ(2u, before.handlesCreated);
+  EXPECT_EQ(1u, before.handlesEvicted);
+  EXPECT_EQ(1u, before.idleHandles);
+  // the handle kept is the one connected to the delayed server
+  EXPECT_EQ(200, session.Get(delayed).code);
+  RestClient::PoolStatistics after = session.GetPoolStatistics();
+  EXPECT_EQ(1u, after.connectionsReused - before.connectionsReused);
+  EXPECT_EQ(0u, after.connectionsOpened - before.connectionsOpened);
+}
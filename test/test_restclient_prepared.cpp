@@ -0,0 +1,123 @@
+#include "restclient-cpp/restclient.h"
+#include "local_server.h"
+#include <gtest/gtest.h>
+#include <malloc.h>
+#include <future>
+#include <string>
+
+class EchoHeaderServer : public LocalServer
+{
+ protected:
+    virtual void Handle(const Request& request, Response& response)
+    {
+      std::map<std::string, std::string>::const_iterator token = request.headers.find("x-token");
+      std::map<std::string, std::string>::const_iterator agent = request.headers.find("user-agent");
+      response.body = request.method + " " + request.path + " " +
+                      (token == request.headers.end() ? "-" : token->second) + " " +
+                      (agent == request.headers.end() ? "-" : agent->second);
+    }
+};
+
+class PromiseCallback : public RestClientCompletionCallback
+{
+ public:
+    std::promise<RestClient::Response> done;
+
+    virtual void OnComplete(RestClient::Response& response)
+    {
+      done.set_value(std::move(response));
+    }
+};
+
+class RestClientPreparedTest : public ::testing::Test
+{
+ protected:
+    EchoHeaderServer    server;
+    RestClient::Request request;
+
+    RestClientPreparedTest()
+    {
+    }
+
+    virtual ~RestClientPreparedTest()
+    {
+    }
+
+    virtual void SetUp()
+    {
+      ASSERT_TRUE(server.Start());
+      request.url = server.Url("/");
+      request.headers["X-Token"] = "secret";
+    }
+
+    virtual void TearDown()
+    {
+      server.Stop();
+    }
+};
+
+// Tests
+TEST_F(RestClientPreparedTest, TestRestClientPreparedGet)
+{
+  RestClientPreparedRequest prepared(request);
+  std::string agent = std::string(" restclient-cpp-mfr/") + VERSION;
+  for (int i = 0; i < 3; i++)
+  {
+    std::string path = "/item/" + std::to_string(i);
+    RestClient::Response res = prepared.Get(server.Url(path));
+    EXPECT_EQ(200, res.code);
+    EXPECT_EQ("GET " + path + " secret" + agent, res.body);
+  }
+  RestClient::Response res = prepared.Get();
+  EXPECT_EQ("GET / secret" + agent, res.body);
+}
+TEST_F(RestClientPreparedTest, TestRestClientPreparedSetUrl)
+{
+  request.headers["User-Agent"] = "worker/1.0";
+  RestClientPreparedRequest prepared(request);
+  prepared.SetUrl(server.Url("/other"));
+  EXPECT_EQ(server.Url("/other"), prepared.Url());
+  RestClient::Response res = prepared.Get();
+  EXPECT_EQ("GET /other secret worker/1.0", res.body);
+}
+// check the request is compiled once, later changes do not leak in
+TEST_F(RestClientPreparedTest, TestRestClientPreparedCompiledOnce)
+{
+  RestClientPreparedRequest prepared(request);
+  request.headers["X-Token"] = "changed";
+  RestClient::Response res = prepared.Get();
+  EXPECT_EQ(0u, res.body.find("GET / secret "));
+}
+TEST_F(RestClientPreparedTest, TestRestClientPreparedPost)
+{
+  RestClientPreparedRequest prepared(request);
+  std::map<std::string, RestClient::FormItem> form;
+  RestClient::FormItem item;
+  item.value = "value";
+  item.type = RestClient::kString;
+  form["field"] = item;
+  RestClient::Response res = prepared.Post(server.Url("/form"), form);
+  EXPECT_EQ(200, res.code);
+  EXPECT_EQ(0u, res.body.find("POST /form secret "));
+}
+TEST_F(RestClientPreparedTest, TestRestClientPreparedGetAsync)
+{
+  RestClientPreparedRequest prepared(request);
+  PromiseCallback callback;
+  ASSERT_TRUE(prepared.GetAsync(server.Url("/async"), NULL, &callback));
+  RestClient::Response res = callback.done.get_future().get();
+  EXPECT_EQ(200, res.code);
+  EXPECT_EQ(0u, res.body.find("GET /async secret "));
+}
+// check calls with headers no longer leak their curl_slist
+TEST_F(RestClientPreparedTest, TestRestClientHeaderListReleased)
+{
+  request.headers["X-Padding"] = std::string(200, 'p');
+  for (int i = 0; i < 50; i++)
+    RestClient::Get(request);
+  size_t before = mallinfo2().uordblks;
+  for (int i = 0; i < 500; i++)
+    RestClient::Get(request);
+  size_t after = mallinfo2().uordblks;
+  EXPECT_GT(before + 16 * 1024, after);
+}
@@ -0,0 +1,108 @@
+#include "restclient-cpp/restclient.h"
+#include "alloc_counter.h"
+#include "local_server.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+static_assert(!std::is_copy_constructible<RestClient::Response>::value, "responses are moved, not copied");
+static_assert(!std::is_copy_assignable<RestClient::Response>::value, "responses are moved, not copied");
+static_assert(std::is_nothrow_move_constructible<RestClient::Response>::value, "vectors of responses move on growth");
+static_assert(std::is_nothrow_move_assignable<RestClient::Response>::value, "vectors of responses move on growth");
+
+static const size_t kBodySize = 1024 * 1024;
+
+class MegabyteServer : public LocalServer
+{
+ protected:
+    virtual void Handle(const Request& /* request */, Response& response)
+    {
+      response.generatedSize = kBodySize;
+    }
+};
+
+class RestClientResponseTest : public ::testing::Test
+{
+ protected:
+    MegabyteServer      server;
+    RestClient::Request request;
+
+    RestClientResponseTest()
+    {
+    }
+
+    virtual ~RestClientResponseTest()
+    {
+    }
+
+    virtual void SetUp()
+    {
+      ASSERT_TRUE(server.Start());
+      request.url = server.Url("/");
+      RestClient::Get(request);
+    }
+
+    virtual void TearDown()
+    {
+      server.Stop();
+    }
+};
+
+// Tests
+// check the body written by libcurl is the one the caller gets, for every blocking entry point
+TEST_F(RestClientResponseTest, TestRestClientResponseBlockingNoCopy)
+{
+  RestClientSession session;
+  RestClientPreparedRequest prepared(request);
+  std::map<std::string, RestClient::FormItem> form;
+  RestClient::Response responses[4];
+  {
+    AllocCounter counter(64 * 1024);
+    responses[0] = RestClient::Get(request);
+    responses[1] = session.Get(request);
+    responses[2] = prepared.Get();
+    responses[3] = RestClient::Post(request, form);
+    // one reservation per body and nothing else of its size
+    EXPECT_EQ(4u, counter.Count());
+    EXPECT_GT(5 * kBodySize, counter.Bytes());
+  }
+  for (size_t i = 0; i < 4; i++)
+    EXPECT_EQ(kBodySize, responses[i].body.size());
+}
+// check asynchronous bodies reach the calling thread without a copy
+TEST_F(RestClientResponseTest, TestRestClientResponseAsyncNoCopy)
+{
+  std::future<RestClient::Response> future = RestClient::GetAsync(request);
+  future.wait();
+  std::vector<RestClient::Request> requests(3, request);
+  AllocCounter counter(64 * 1024);
+  RestClient::Response res = future.get();
+  std::vector<RestClient::Response> responses = RestClient::Perform(requests);
+  // the bodies were allocated on the I/O thread, the caller only takes them over
+  EXPECT_EQ(0u, counter.Count());
+  EXPECT_EQ(kBodySize, res.body.size());
+  ASSERT_EQ(3u, responses.size());
+  for (size_t i = 0; i < responses.size(); i++)
+    EXPECT_EQ(kBodySize, responses[i].body.size());
+}
+// check moving and swapping hand the buffers over
+TEST_F(RestClientResponseTest, TestRestClientResponseMove)
+{
+  RestClient::Response res = RestClient::Get(request);
+  const char* data = res.body.data();
+  AllocCounter counter;
+  RestClient::Response moved(std::move(res));
+  EXPECT_EQ(data, moved.body.data());
+  RestClient::Response swapped;
+  swapped.swap(moved);
+  EXPECT_EQ(data, swapped.body.data());
+  EXPECT_EQ(200, swapped.code);
+  EXPECT_EQ(0, moved.code);
+  std::vector<RestClient::Response> grown;
+  grown.push_back(std::move(swapped));
+  grown.resize(64);
+  EXPECT_EQ(data, grown[0].body.data());
+  // only the vector's own storage was allocated
+  EXPECT_GE(8u, counter.Count());
+}
@@ -0,0 +1,141 @@
+#include "restclient-cpp/restclient.h"
+#include "local_server.h"
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <future>
+#include <string>
+#include <vector>
+
+class SlowServer : public LocalServer
+{
+ protected:
+    virtual void Handle(const Request& /* request */, Response& response)
+    {
+      usleep(50000);
+      response.body = "slow";
+    }
+};
+
+class WaitingCallback : public RestClientCompletionCallback
+{
+ public:
+    std::promise<void> done;
+    int                remaining;
+
+    explicit WaitingCallback(int count) : remaining(count)
+    {
+    }
+
+    virtual void OnComplete(RestClient::Response& /* response */)
+    {
+      if (--remaining == 0)
+        done.set_value();
+    }
+};
+
+class RestClientSchedulerTest : public ::testing::Test
+{
+ protected:
+    LocalServer server;
+    SlowServer  slowServer;
+
+    RestClientSchedulerTest()
+    {
+    }
+
+    virtual ~RestClientSchedulerTest()
+    {
+    }
+
+    virtual void SetUp()
+    {
+      ASSERT_TRUE(server.Start());
+      ASSERT_TRUE(slowServer.Start());
+    }
+
+    virtual void TearDown()
+    {
+      RestClient::SetSchedulerSettings(RestClient::SchedulerSettings());
+      slowServer.Stop();
+      server.Stop();
+    }
+
+    RestClient::HostStatistics Host(const LocalServer& local)
+    {
+      std::vector<RestClient::HostStatistics> hosts = RestClient::GetHostStatistics();
+      std::string key = "http://127.0.0.1:" + std::to_string(local.Port());
+      for (size_t i = 0; i < hosts.size(); i++)
+      {
+        if (hosts[i].host == key)
+          return hosts[i];
+      }
+      return RestClient::HostStatistics();
+    }
+};
+
+// Tests
+// check spellings of one origin share a queue
+TEST_F(RestClientSchedulerTest, TestRestClientOriginKey)
+{
+  // blocking requests only go through the scheduler while a limit is set
+  RestClient::SchedulerSettings settings;
+  settings.maxInFlightPerHost = 100;
+  RestClient::SetSchedulerSettings(settings);
+  RestClient::Request request;
+  request.url = server.Url("/a");
+  EXPECT_EQ(200, RestClient::Get(request).code);
+  request.url = "HTTP://user@127.0.0.1:" + std::to_string(server.Port()) + "?b";
+  EXPECT_EQ(200, RestClient::Get(request).code);
+  EXPECT_EQ(2u, Host(server).dispatched);
+  EXPECT_EQ(0u, Host(server).inFlight);
+}
+// check blocking requests bypass the scheduler while no limit is set
+TEST_F(RestClientSchedulerTest, TestRestClientUnlimitedBypass)
+{
+  RestClient::Request request;
+  request.url = server.Url("/");
+  EXPECT_EQ(200, RestClient::Get(request).code);
+  EXPECT_EQ(0u, Host(server).dispatched);
+  EXPECT_EQ(200, RestClient::GetAsync(request).get().code);
+  EXPECT_EQ(1u, Host(server).dispatched);
+}
+// check excess requests queue behind the per host limit
+TEST_F(RestClientSchedulerTest, TestRestClientInFlightPerHost)
+{
+  RestClient::SchedulerSettings settings;
+  settings.maxInFlightPerHost = 2;
+  RestClient::SetSchedulerSettings(settings);
+  std::vector<RestClient::Request> requests(50);
+  for (size_t i = 0; i < requests.size(); i++)
+    requests[i].url = server.Url("/");
+  std::vector<RestClient::Response> res = RestClient::Perform(requests);
+  for (size_t i = 0; i < res.size(); i++)
+    EXPECT_EQ(200, res[i].code);
+  RestClient::HostStatistics host = Host(server);
+  EXPECT_EQ(50u, host.dispatched);
+  EXPECT_EQ(0u, host.queued);
+  EXPECT_LT(0u, host.peakQueued);
+  EXPECT_LT(0.0, host.totalWait);
+  EXPECT_GE(2u, server.GetStatistics().connections);
+}
+// check a backed up host does not starve a healthy one
+TEST_F(RestClientSchedulerTest, TestRestClientSlowHostFairness)
+{
+  RestClient::SchedulerSettings settings;
+  settings.maxInFlightPerHost = 2;
+  settings.maxInFlight = 4;
+  RestClient::SetSchedulerSettings(settings);
+  RestClient::Request slow;
+  slow.url = slowServer.Url("/");
+  WaitingCallback slowDone(10);
+  for (int i = 0; i < 10; i++)
+    ASSERT_TRUE(RestClient::GetAsync(slow, &slowDone));
+  std::vector<RestClient::Request> requests(20);
+  for (size_t i = 0; i < requests.size(); i++)
+    requests[i].url = server.Url("/");
+  std::vector<RestClient::Response> res = RestClient::Perform(requests);
+  EXPECT_EQ(200, res[19].code);
+  EXPECT_LT(0u, Host(slowServer).queued);
+  slowDone.done.get_future().wait();
+  EXPECT_EQ(10u, Host(slowServer).dispatched);
+}
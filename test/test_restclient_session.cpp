@@ -0,0 +1,134 @@
+#include "restclient-cpp/restclient.h"
+#include "local_server.h"
+#include <gtest/gtest.h>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+class EchoAuthServer : public LocalServer
+{
+ protected:
+    virtual void Handle(const Request& request, Response& response)
+    {
+      response.body = Header(request, "authorization") + "|" + Header(request, "user-agent") + "|" + Header(request, "x-service");
+    }
+
+    static std::string Header(const Request& request, const std::string& name)
+    {
+      std::map<std::string, std::string>::const_iterator iterator = request.headers.find(name);
+      return iterator == request.headers.end() ? "-" : iterator->second;
+    }
+};
+
+class RestClientSessionTest : public ::testing::Test
+{
+ protected:
+    EchoAuthServer      server;
+    RestClient::Request request;
+
+    RestClientSessionTest()
+    {
+    }
+
+    virtual ~RestClientSessionTest()
+    {
+    }
+
+    virtual void SetUp()
+    {
+      ASSERT_TRUE(server.Start());
+      request.url = server.Url("/");
+    }
+
+    virtual void TearDown()
+    {
+      RestClient::ClearAuth();
+      server.Stop();
+    }
+};
+
+// Tests
+// check sessions on different threads keep their own credentials
+TEST_F(RestClientSessionTest, TestRestClientSessionAuthPerThread)
+{
+  RestClientSession first;
+  RestClientSession second;
+  first.SetAuth("first", "one");
+  second.SetAuth("second", "two");
+
+  std::vector<std::future<int> > results;
+  RestClientSession* sessions[] = {&first, &second};
+  const char* expected[] = {"Basic Zmlyc3Q6b25l|", "Basic c2Vjb25kOnR3bw==|"};
+  for (int i = 0; i < 2; i++)
+  {
+    RestClientSession* session = sessions[i];
+    std::string prefix = expected[i];
+    RestClient::Request copy = request;
+    results.push_back(std::async(std::launch::async, [session, prefix, copy]() {
+      int matched = 0;
+      for (int n = 0; n < 50; n++)
+        if (session->Get(copy).body.compare(0, prefix.size(), prefix) == 0)
+          matched++;
+      return matched;
+    }));
+  }
+  EXPECT_EQ(50, results[0].get());
+  EXPECT_EQ(50, results[1].get());
+
+  RestClient::Response res = RestClient::Get(request);
+  EXPECT_EQ(0u, res.body.find("-|"));
+}
+TEST_F(RestClientSessionTest, TestRestClientSessionDefaults)
+{
+  RestClientSession session;
+  RestClient::headermap headers;
+  headers["X-Service"] = "billing";
+  session.SetDefaultHeaders(headers);
+  session.SetUserAgent("billing-worker/2");
+  EXPECT_EQ("-|billing-worker/2|billing", session.Get(request).body);
+
+  request.headers["X-Service"] = "override";
+  request.headers["User-Agent"] = "custom";
+  EXPECT_EQ("-|custom|override", session.Get(request).body);
+
+  RestClient::Request plain;
+  plain.url = request.url;
+  EXPECT_EQ("-|restclient-cpp-mfr/" VERSION "|-", RestClient::Get(plain).body);
+}
+TEST_F(RestClientSessionTest, TestRestClientSessionPool)
+{
+  RestClient::PoolStatistics before = RestClient::GetPoolStatistics();
+  RestClientSession session;
+  for (int i = 0; i < 5; i++)
+    EXPECT_EQ(200, session.Get(request).code);
+  RestClient::PoolStatistics stats = session.GetPoolStatistics();
+  EXPECT_EQ(1u, stats.handlesCreated);
+  EXPECT_EQ(4u, stats.handlesReused);
+  EXPECT_EQ(1u, stats.idleHandles);
+  EXPECT_EQ(before.handlesCreated, RestClient::GetPoolStatistics().handlesCreated);
+  EXPECT_EQ(before.handlesReused, RestClient::GetPoolStatistics().handlesReused);
+}
+TEST_F(RestClientSessionTest, TestRestClientSessionAsync)
+{
+  RestClientSession session;
+  session.SetAuth("async", "pass");
+  std::vector<RestClient::Request> requests(4, request);
+  std::vector<RestClient::Response> responses = session.Perform(requests);
+  ASSERT_EQ(4u, responses.size());
+  for (size_t i = 0; i < responses.size(); i++)
+    EXPECT_EQ("Basic YXN5bmM6cGFzcw==|restclient-cpp-mfr/" VERSION "|-", responses[i].body);
+  EXPECT_EQ(0u, session.GetPoolStatistics().handlesCreated - session.GetPoolStatistics().idleHandles);
+}
+TEST_F(RestClientSessionTest, TestRestClientSessionPrepared)
+{
+  RestClientSession session;
+  RestClient::headermap headers;
+  headers["X-Service"] = "search";
+  session.SetDefaultHeaders(headers);
+  session.SetAuth("prepared", "pass");
+  RestClientPreparedRequest prepared(session, request);
+  session.ClearAuth();
+  EXPECT_EQ("Basic cHJlcGFyZWQ6cGFzcw==|restclient-cpp-mfr/" VERSION "|search", prepared.Get().body);
+  EXPECT_EQ(1u, session.GetPoolStatistics().handlesCreated);
+}
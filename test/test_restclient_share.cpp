@@ -0,0 +1,81 @@
+#include "restclient-cpp/restclient.h"
+#include "local_server.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+class RestClientShareTest : public ::testing::Test
+{
+ protected:
+    LocalServer                server;
+    RestClient::Request        request;
+    RestClient::ShareSettings  everything;
+
+    RestClientShareTest()
+    {
+      everything.dns = true;
+      everything.sslSessions = true;
+      everything.connections = true;
+    }
+
+    virtual ~RestClientShareTest()
+    {
+    }
+
+    virtual void SetUp()
+    {
+      ASSERT_TRUE(server.Start());
+      request.url = server.Url("/");
+    }
+
+    virtual void TearDown()
+    {
+      EXPECT_TRUE(RestClient::CleanUp());
+      EXPECT_TRUE(RestClient::Init());
+      server.Stop();
+    }
+};
+
+// Tests
+// check threads resolve and connect through one share with every cache enabled
+TEST_F(RestClientShareTest, TestRestClientShareConcurrent)
+{
+  ASSERT_TRUE(RestClient::Init(everything));
+  std::vector<std::thread> workers;
+  std::vector<int> succeeded(8, 0);
+  for (size_t i = 0; i < succeeded.size(); i++)
+  {
+    workers.push_back(std::thread([this, &succeeded, i]() {
+      RestClientSession session;
+      for (int j = 0; j < 20; j++)
+      {
+        if (RestClient::Get(request).code == 200)
+          succeeded[i]++;
+        if (session.Get(request).code == 200)
+          succeeded[i]++;
+      }
+    }));
+  }
+  for (size_t i = 0; i < workers.size(); i++)
+    workers[i].join();
+  for (size_t i = 0; i < succeeded.size(); i++)
+    EXPECT_EQ(40, succeeded[i]);
+}
+// check Init and CleanUp replace the share while sessions hold idle handles
+TEST_F(RestClientShareTest, TestRestClientShareReInit)
+{
+  RestClientSession session;
+  EXPECT_EQ(200, session.Get(request).code);
+  EXPECT_EQ(200, RestClient::Get(request).code);
+  EXPECT_EQ(1u, session.GetPoolStatistics().idleHandles);
+  // the idle handles were attached to the share being replaced
+  ASSERT_TRUE(RestClient::Init(everything));
+  EXPECT_EQ(0u, session.GetPoolStatistics().idleHandles);
+  EXPECT_EQ(200, session.Get(request).code);
+  EXPECT_EQ(200, RestClient::Get(request).code);
+  EXPECT_TRUE(RestClient::CleanUp());
+  EXPECT_EQ(0u, session.GetPoolStatistics().idleHandles);
+  ASSERT_TRUE(RestClient::Init());
+  EXPECT_EQ(200, session.Get(request).code);
+}
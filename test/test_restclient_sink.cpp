@@ -0,0 +1,229 @@
+#include "restclient-cpp/restclient.h"
+#include "local_server.h"
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+class SinkServer : public LocalServer
+{
+ protected:
+    virtual void Handle(const Request& request, Response& response)
+    {
+      if (request.path == "/missing")
+      {
+        response.code = 404;
+        response.body = "not here";
+        return;
+      }
+      if (request.path == "/unsized")
+        response.closeDelimited = true;
+      if (request.path == "/dropped")
+        response.dropAfter = 50000;
+      if (request.path == "/large")
+        response.generatedSize = 3 * 1024 * 1024 + 17;
+      else
+        response.generatedSize = 100000;
+      response.ranges = true;
+    }
+};
+
+class RecordingSink : public RestClientBodySink
+{
+ public:
+    int         headers;
+    int         completed;
+    int         code;
+    std::string data;
+
+    RecordingSink() : headers(0), completed(0), code(0)
+    {
+    }
+
+    virtual bool OnHeaders(const RestClient::Response& /* response */)
+    {
+      headers++;
+      return true;
+    }
+
+    virtual bool OnData(const char* chunk, size_t length)
+    {
+      data.append(chunk, length);
+      return true;
+    }
+
+    virtual void OnComplete(const RestClient::Response& response)
+    {
+      completed++;
+      code = response.code;
+    }
+};
+
+class CompletionPromise : public RestClientCompletionCallback
+{
+ public:
+    std::promise<int> done;
+
+    virtual void OnComplete(RestClient::Response& response)
+    {
+      done.set_value(response.code);
+    }
+};
+
+static bool StopAfterFirstChunk(const char* /* data */, size_t /* length */, void* userdata)
+{
+  (*static_cast<int*>(userdata))++;
+  return false;
+}
+
+class RestClientSinkTest : public ::testing::Test
+{
+ protected:
+    SinkServer          server;
+    RestClient::Request request;
+
+    RestClientSinkTest()
+    {
+    }
+
+    virtual ~RestClientSinkTest()
+    {
+    }
+
+    virtual void SetUp()
+    {
+      ASSERT_TRUE(server.Start());
+      request.url = server.Url("/");
+    }
+
+    virtual void TearDown()
+    {
+      server.Stop();
+    }
+
+    std::string ReadFile(const std::string& path)
+    {
+      std::ifstream file(path.c_str(), std::ios::binary);
+      return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    std::string Pattern(unsigned long long offset, size_t length)
+    {
+      std::string expected;
+      for (size_t i = 0; i < length; i++)
+        expected += LocalServer::PatternByte(offset + i);
+      return expected;
+    }
+};
+
+// Tests
+TEST_F(RestClientSinkTest, TestRestClientSinkCallOrder)
+{
+  RecordingSink sink;
+  RestClient::Response res = RestClient::Get(request, &sink);
+  EXPECT_EQ(200, res.code);
+  EXPECT_EQ("", res.body);
+  EXPECT_EQ(1, sink.headers);
+  EXPECT_EQ(1, sink.completed);
+  EXPECT_EQ(200, sink.code);
+  EXPECT_EQ(Pattern(0, 100000), sink.data);
+}
+// a 206 used to end up in the body instead of the stream
+TEST_F(RestClientSinkTest, TestRestClientStreamPartialContent)
+{
+  std::ostringstream stream;
+  request.headers["Range"] = "bytes=1000-1999";
+  RestClient::Response res = RestClient::Get(request, &stream, NULL);
+  EXPECT_EQ(206, res.code);
+  EXPECT_EQ("", res.body);
+  EXPECT_EQ(Pattern(1000, 1000), stream.str());
+}
+// error bodies stay in the response
+TEST_F(RestClientSinkTest, TestRestClientStreamErrorBody)
+{
+  std::ostringstream stream;
+  request.url = server.Url("/missing");
+  RestClient::Response res = RestClient::Get(request, &stream, NULL);
+  EXPECT_EQ(404, res.code);
+  EXPECT_EQ("not here", res.body);
+  EXPECT_EQ("", stream.str());
+}
+TEST_F(RestClientSinkTest, TestRestClientFdSink)
+{
+  FILE* file = tmpfile();
+  ASSERT_TRUE(file != NULL);
+  RestClientFdSink sink(fileno(file));
+  RestClient::Response res = RestClient::Get(request, &sink);
+  EXPECT_EQ(200, res.code);
+  EXPECT_EQ(100000, lseek(fileno(file), 0, SEEK_END));
+  fclose(file);
+}
+// check returning false from a sink aborts the transfer
+TEST_F(RestClientSinkTest, TestRestClientCallbackSinkAbort)
+{
+  int chunks = 0;
+  RestClientCallbackSink sink(StopAfterFirstChunk, &chunks);
+  RestClient::Response res = RestClient::Get(request, &sink);
+  EXPECT_EQ(-1, res.code);
+  EXPECT_EQ(1, chunks);
+}
+TEST_F(RestClientSinkTest, TestRestClientGetAsyncSink)
+{
+  std::string body;
+  RestClientStringSink sink(body);
+  CompletionPromise callback;
+  ASSERT_TRUE(RestClient::GetAsync(request, &sink, &callback));
+  EXPECT_EQ(200, callback.done.get_future().get());
+  EXPECT_EQ(Pattern(0, 100000), body);
+}
+// check a body of known length is copied into a preallocated mapping
+TEST_F(RestClientSinkTest, TestRestClientMappedFileSink)
+{
+  std::string path = "/tmp/restclient-mapped-sink";
+  RestClientMappedFileSink sink(path);
+  RestClient::Response res = RestClient::Get(request, &sink);
+  EXPECT_EQ(200, res.code);
+  EXPECT_TRUE(res.body.empty());
+  EXPECT_TRUE(sink.Mapped());
+  EXPECT_EQ(100000u, sink.Written());
+  EXPECT_EQ(Pattern(0, 100000), ReadFile(path));
+  unlink(path.c_str());
+}
+// check a body of unknown length goes through buffered writes
+TEST_F(RestClientSinkTest, TestRestClientMappedFileSinkUnknownLength)
+{
+  std::string path = "/tmp/restclient-mapped-sink";
+  request.url = server.Url("/unsized");
+  RestClientMappedFileSink sink(path);
+  RestClient::Response res = RestClient::Get(request, &sink);
+  EXPECT_EQ(200, res.code);
+  EXPECT_FALSE(sink.Mapped());
+  EXPECT_EQ(100000u, sink.Written());
+  EXPECT_EQ(Pattern(0, 100000), ReadFile(path));
+  unlink(path.c_str());
+}
+// check a large body and a truncated one leave a file of the received size
+TEST_F(RestClientSinkTest, TestRestClientMappedFileSinkSizes)
+{
+  std::string path = "/tmp/restclient-mapped-sink";
+  request.url = server.Url("/large");
+  RestClientMappedFileSink sink(path);
+  RestClient::Response res = RestClient::Get(request, &sink);
+  EXPECT_EQ(200, res.code);
+  std::string content = ReadFile(path);
+  ASSERT_EQ(3u * 1024u * 1024u + 17u, content.size());
+  EXPECT_EQ(Pattern(content.size() - 100, 100), content.substr(content.size() - 100));
+  request.url = server.Url("/dropped");
+  res = RestClient::Get(request, &sink);
+  EXPECT_EQ(-1, res.code);
+  EXPECT_EQ(Pattern(0, 50000), ReadFile(path));
+  request.url = server.Url("/missing");
+  res = RestClient::Get(request, &sink);
+  EXPECT_EQ(404, res.code);
+  EXPECT_EQ("not here", res.body);
+  unlink(path.c_str());
+}
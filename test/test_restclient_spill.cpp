@@ -0,0 +1,122 @@
+#include "restclient-cpp/restclient.h"
+#include "alloc_counter.h"
+#include "local_server.h"
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <string>
+
+static const size_t kBodySize  = 4 * 1024 * 1024;
+static const size_t kThreshold = 256 * 1024;
+
+class LargeBodyServer : public LocalServer
+{
+ protected:
+    virtual void Handle(const Request& request, Response& response)
+    {
+      response.generatedSize = request.path == "/small" ? 1024 : kBodySize;
+    }
+};
+
+class RestClientSpillTest : public ::testing::Test
+{
+ protected:
+    LargeBodyServer     server;
+    RestClient::Request request;
+
+    RestClientSpillTest()
+    {
+    }
+
+    virtual ~RestClientSpillTest()
+    {
+    }
+
+    virtual void SetUp()
+    {
+      ASSERT_TRUE(server.Start());
+      request.url = server.Url("/");
+      RestClient::BodySettings settings;
+      settings.spillThreshold = kThreshold;
+      RestClient::SetBodySettings(settings);
+    }
+
+    virtual void TearDown()
+    {
+      RestClient::SetBodySettings(RestClient::BodySettings());
+      server.Stop();
+    }
+};
+
+// Tests
+// check a body past the threshold ends up in a file without being held in memory
+TEST_F(RestClientSpillTest, TestRestClientSpillLargeBody)
+{
+  RestClient::Response res;
+  {
+    AllocCounter counter(64 * 1024);
+    res = RestClient::Get(request);
+    EXPECT_GT(2 * kThreshold, counter.Bytes());
+  }
+  EXPECT_EQ(200, res.code);
+  EXPECT_TRUE(res.body.empty());
+  ASSERT_TRUE(res.bodyFile.Open());
+  EXPECT_EQ(kBodySize, res.BodySize());
+  // the file is already gone from the directory
+  struct stat status;
+  ASSERT_EQ(0, fstat(res.bodyFile.Fd(), &status));
+  EXPECT_EQ(0u, status.st_nlink);
+}
+// check the reader and the mapped view see the whole body
+TEST_F(RestClientSpillTest, TestRestClientSpillRead)
+{
+  RestClient::Response res = RestClient::Get(request);
+  ASSERT_EQ(kBodySize, res.BodySize());
+  char buffer[16];
+  ASSERT_EQ(16u, res.ReadBody(kThreshold - 8, buffer, sizeof(buffer)));
+  for (size_t i = 0; i < sizeof(buffer); i++)
+    EXPECT_EQ(LocalServer::PatternByte(kThreshold - 8 + i), buffer[i]);
+  EXPECT_EQ(4u, res.ReadBody(kBodySize - 4, buffer, sizeof(buffer)));
+  EXPECT_EQ(0u, res.ReadBody(kBodySize, buffer, sizeof(buffer)));
+  const char* data = res.BodyData();
+  ASSERT_TRUE(data != NULL);
+  for (size_t i = 0; i < kBodySize; i += 4093)
+    ASSERT_EQ(LocalServer::PatternByte(i), data[i]);
+  EXPECT_EQ(data, res.BodyView().data());
+  EXPECT_EQ(kBodySize, res.BodyView().size());
+}
+// check bodies below the threshold stay in memory behind the same reader
+TEST_F(RestClientSpillTest, TestRestClientSpillSmallBody)
+{
+  request.url = server.Url("/small");
+  RestClient::Response res = RestClient::Get(request);
+  EXPECT_FALSE(res.bodyFile.Open());
+  ASSERT_EQ(1024u, res.body.size());
+  EXPECT_EQ(1024u, res.BodySize());
+  EXPECT_EQ(res.body.data(), res.BodyData());
+  char buffer[8];
+  EXPECT_EQ(8u, res.ReadBody(1016, buffer, sizeof(buffer)));
+  EXPECT_EQ(LocalServer::PatternByte(1023), buffer[7]);
+}
+// check spilled bodies of asynchronous requests reach the caller
+TEST_F(RestClientSpillTest, TestRestClientSpillAsync)
+{
+  std::vector<RestClient::Request> requests(3, request);
+  std::vector<RestClient::Response> responses = RestClient::Perform(requests);
+  for (size_t i = 0; i < responses.size(); i++)
+  {
+    EXPECT_TRUE(responses[i].bodyFile.Open());
+    EXPECT_EQ(kBodySize, responses[i].BodySize());
+  }
+}
+// check a body that cannot be spilled fails the request instead of growing
+TEST_F(RestClientSpillTest, TestRestClientSpillFailure)
+{
+  RestClient::BodySettings settings;
+  settings.spillThreshold = kThreshold;
+  settings.spillDirectory = "/nonexistent/restclient";
+  RestClient::SetBodySettings(settings);
+  RestClient::Response res = RestClient::Get(request);
+  EXPECT_EQ(-1, res.code);
+  EXPECT_EQ("Failed to query.", res.body);
+  EXPECT_FALSE(res.bodyFile.Open());
+}
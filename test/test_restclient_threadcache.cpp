@@ -0,0 +1,191 @@
+#include "restclient-cpp/restclient.h"
+#include "local_server.h"
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <string>
+#include <thread>
+
+// the test program is linked with --wrap for these, so every lock the
+// library takes on the counting thread is seen here
+extern "C" int __real_pthread_mutex_lock(pthread_mutex_t* mutex);
+extern "C" int __real_pthread_rwlock_rdlock(pthread_rwlock_t* lock);
+extern "C" int __real_pthread_rwlock_wrlock(pthread_rwlock_t* lock);
+
+static thread_local bool countLocks = false;
+static thread_local int  mutexesTaken = 0;
+static thread_local int  rwlocksTaken = 0;
+
+extern "C" int __wrap_pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+  if (countLocks)
+    mutexesTaken++;
+  return __real_pthread_mutex_lock(mutex);
+}
+
+extern "C" int __wrap_pthread_rwlock_rdlock(pthread_rwlock_t* lock)
+{
+  if (countLocks)
+    rwlocksTaken++;
+  return __real_pthread_rwlock_rdlock(lock);
+}
+
+extern "C" int __wrap_pthread_rwlock_wrlock(pthread_rwlock_t* lock)
+{
+  if (countLocks)
+    rwlocksTaken++;
+  return __real_pthread_rwlock_wrlock(lock);
+}
+
+class RestClientThreadCacheTest : public ::testing::Test
+{
+ protected:
+    LocalServer         server;
+    RestClient::Request request;
+
+    RestClientThreadCacheTest()
+    {
+    }
+
+    virtual ~RestClientThreadCacheTest()
+    {
+    }
+
+    virtual void SetUp()
+    {
+      // start from empty pool and thread caches
+      RestClient::CleanUp();
+      RestClient::Init();
+      ASSERT_TRUE(server.Start());
+      request.url = server.Url("/");
+    }
+
+    virtual void TearDown()
+    {
+      RestClient::SetPoolSettings(RestClient::PoolSettings());
+      server.Stop();
+    }
+
+    static void GetTimes(const RestClient::Request& request, int times)
+    {
+      for (int i = 0; i < times; i++)
+        EXPECT_EQ(200, RestClient::Get(request).code);
+    }
+};
+
+// Tests
+// check a thread gets its handle and connection back for the same origin
+TEST_F(RestClientThreadCacheTest, TestRestClientThreadCacheReuse)
+{
+  RestClient::PoolStatistics before = RestClient::GetPoolStatistics();
+  std::thread worker(GetTimes, request, 10);
+  worker.join();
+  RestClient::PoolStatistics after = RestClient::GetPoolStatistics();
+  EXPECT_EQ(1u, after.handlesCreated - before.handlesCreated);
+  EXPECT_EQ(9u, after.handlesReused - before.handlesReused);
+  EXPECT_EQ(1u, after.connectionsOpened - before.connectionsOpened);
+  EXPECT_EQ(9u, after.connectionsReused - before.connectionsReused);
+}
+// check the cache of a thread is cleaned up when the thread exits
+TEST_F(RestClientThreadCacheTest, TestRestClientThreadCacheThreadExit)
+{
+  std::thread worker([this]() {
+    GetTimes(request, 2);
+    EXPECT_EQ(1u, RestClient::GetPoolStatistics().idleHandles);
+  });
+  worker.join();
+  EXPECT_EQ(0u, RestClient::GetPoolStatistics().idleHandles);
+}
+// check RestClient::CleanUp empties the cache of running threads
+TEST_F(RestClientThreadCacheTest, TestRestClientThreadCacheCleanUp)
+{
+  RestClient::PoolStatistics before = RestClient::GetPoolStatistics();
+  GetTimes(request, 2);
+  EXPECT_EQ(1u, RestClient::GetPoolStatistics().idleHandles);
+  RestClient::CleanUp();
+  RestClient::Init();
+  EXPECT_EQ(0u, RestClient::GetPoolStatistics().idleHandles);
+  GetTimes(request, 1);
+  EXPECT_EQ(2u, RestClient::GetPoolStatistics().handlesCreated - before.handlesCreated);
+}
+// check origins beyond the limit hand their handle back to the pool
+TEST_F(RestClientThreadCacheTest, TestRestClientThreadCacheEviction)
+{
+  RestClient::PoolSettings settings;
+  settings.threadCacheOrigins = 1;
+  RestClient::SetPoolSettings(settings);
+  RestClient::Request other;
+  other.url = "http://localhost:" + std::to_string(server.Port()) + "/";
+  std::thread worker([this, other]() {
+    RestClient::PoolStatistics before = RestClient::GetPoolStatistics();
+    GetTimes(request, 1);
+    GetTimes(other, 1);
+    // the first origin's handle went back to the pool, the second is cached
+    RestClient::PoolStatistics after = RestClient::GetPoolStatistics();
+    EXPECT_EQ(2u, after.handlesCreated - before.handlesCreated);
+    EXPECT_EQ(2u, after.idleHandles);
+    GetTimes(request, 1);
+    EXPECT_EQ(1u, RestClient::GetPoolStatistics().handlesReused - before.handlesReused);
+  });
+  worker.join();
+}
+// check the cache can be switched off
+TEST_F(RestClientThreadCacheTest, TestRestClientThreadCacheDisabled)
+{
+  RestClient::PoolSettings settings;
+  settings.threadCacheOrigins = 0;
+  RestClient::SetPoolSettings(settings);
+  RestClient::PoolStatistics before = RestClient::GetPoolStatistics();
+  std::thread worker(GetTimes, request, 3);
+  worker.join();
+  RestClient::PoolStatistics after = RestClient::GetPoolStatistics();
+  EXPECT_EQ(1u, after.handlesCreated - before.handlesCreated);
+  EXPECT_EQ(2u, after.handlesReused - before.handlesReused);
+  // the handle outlived its thread in the pool
+  EXPECT_EQ(1u, after.idleHandles);
+}
+// check a cache hit without scheduler limits takes no lock of its own
+TEST_F(RestClientThreadCacheTest, TestRestClientThreadCacheHitLockFree)
+{
+  GetTimes(request, 1);
+  RestClient::PoolStatistics before = RestClient::GetPoolStatistics();
+  mutexesTaken = 0;
+  rwlocksTaken = 0;
+  countLocks = true;
+  GetTimes(request, 1);
+  countLocks = false;
+  EXPECT_EQ(0, mutexesTaken);
+  // libcurl locks the shared DNS cache once to let go of the resolved entry
+  EXPECT_GE(1, rwlocksTaken);
+  EXPECT_EQ(1u, RestClient::GetPoolStatistics().handlesReused - before.handlesReused);
+  // without shared caches nothing is locked at all
+  RestClient::ShareSettings unshared;
+  unshared.dns = false;
+  unshared.sslSessions = false;
+  ASSERT_TRUE(RestClient::Init(unshared));
+  GetTimes(request, 1);
+  mutexesTaken = 0;
+  rwlocksTaken = 0;
+  countLocks = true;
+  GetTimes(request, 1);
+  countLocks = false;
+  EXPECT_EQ(0, mutexesTaken);
+  EXPECT_EQ(0, rwlocksTaken);
+  ASSERT_TRUE(RestClient::Init());
+}
+// check disabling the cache leaves its handles to their thread until it releases the next one
+TEST_F(RestClientThreadCacheTest, TestRestClientThreadCacheDisabledLater)
+{
+  RestClient::PoolStatistics before = RestClient::GetPoolStatistics();
+  GetTimes(request, 1);
+  RestClient::PoolSettings settings;
+  settings.threadCacheOrigins = 0;
+  RestClient::SetPoolSettings(settings);
+  EXPECT_EQ(1u, RestClient::GetPoolStatistics().idleHandles);
+  // the cached handle is not handed out any more, it goes to the pool with the new one
+  GetTimes(request, 1);
+  RestClient::PoolStatistics after = RestClient::GetPoolStatistics();
+  EXPECT_EQ(2u, after.handlesCreated - before.handlesCreated);
+  EXPECT_EQ(2u, after.idleHandles);
+  GetTimes(request, 1);
+  EXPECT_EQ(1u, RestClient::GetPoolStatistics().handlesReused - after.handlesReused);
+}
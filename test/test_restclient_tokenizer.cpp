@@ -0,0 +1,178 @@
+#include "restclient-cpp/restclient.h"
+#include <gtest/gtest.h>
+#include <cctype>
+#include <string>
+#include <vector>
+
+// trim semantics of the helpers the tokenizer replaces
+static std::string LegacyTrim(const std::string& s)
+{
+  size_t start = 0;
+  size_t end = s.size();
+  while (start < end && std::isspace(static_cast<unsigned char>(s[start])))
+    start++;
+  while (end > start && std::isspace(static_cast<unsigned char>(s[end - 1])))
+    end--;
+  return s.substr(start, end - start);
+}
+
+class RestClientTokenizerTest : public ::testing::Test
+{
+ protected:
+    std::vector<RestClientHeaders::Isa> isas;
+    size_t                              checked;
+
+    RestClientTokenizerTest() : checked(0)
+    {
+    }
+
+    virtual ~RestClientTokenizerTest()
+    {
+    }
+
+    virtual void SetUp()
+    {
+      for (int isa = RestClientHeaders::kScalar; isa <= RestClientHeaders::BestIsa(); isa++)
+        isas.push_back(static_cast<RestClientHeaders::Isa>(isa));
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+    // compare every available instruction set against the legacy split
+    void Check(const std::string& line)
+    {
+      size_t colon = line.find(':');
+      std::string name = colon == std::string::npos ? "" : LegacyTrim(line.substr(0, colon));
+      std::string value = colon == std::string::npos ? "" : LegacyTrim(line.substr(colon + 1));
+      std::string trimmed = LegacyTrim(line);
+      size_t leading = trimmed.empty() ? line.size() : line.find(trimmed);
+      size_t trailing = trimmed.empty() ? line.size() : line.size() - leading - trimmed.size();
+
+      for (size_t i = 0; i < isas.size(); i++)
+      {
+        RestClientHeaders::Field field;
+        bool found = RestClientHeaders::Tokenize(line.data(), line.size(), field, isas[i]);
+        ASSERT_EQ(colon != std::string::npos, found) << Describe(line, isas[i]);
+        if (found)
+        {
+          ASSERT_EQ(name, std::string(field.name, field.nameLength)) << Describe(line, isas[i]);
+          ASSERT_EQ(value, std::string(field.value, field.valueLength)) << Describe(line, isas[i]);
+        }
+        ASSERT_EQ(leading, RestClientHeaders::LeadingSpace(line.data(), line.size(), isas[i])) << Describe(line, isas[i]);
+        ASSERT_EQ(trailing, RestClientHeaders::TrailingSpace(line.data(), line.size(), isas[i])) << Describe(line, isas[i]);
+      }
+      checked++;
+    }
+
+    static std::string Describe(const std::string& line, RestClientHeaders::Isa isa)
+    {
+      std::string text = "isa " + std::to_string(isa) + " line \"";
+      for (size_t i = 0; i < line.size(); i++)
+      {
+        unsigned char c = static_cast<unsigned char>(line[i]);
+        text += std::isprint(c) ? std::string(1, line[i]) : "\\x" + std::to_string(c);
+      }
+      return text + "\"";
+    }
+};
+
+// bytes that matter to the tokenizer, the high byte checks signed compares
+static const char kAlphabet[] = {' ', '\t', '\n', '\v', '\f', '\r', ':', 'a', '\x80'};
+static const size_t kAlphabetSize = sizeof(kAlphabet);
+
+// Tests
+// check every line up to 6 bytes from the alphabet
+TEST_F(RestClientTokenizerTest, TestRestClientTokenizerExhaustive)
+{
+  std::string line;
+  for (size_t length = 0; length <= 6; length++)
+  {
+    size_t combinations = 1;
+    for (size_t i = 0; i < length; i++)
+      combinations *= kAlphabetSize;
+    line.resize(length);
+    for (size_t n = 0; n < combinations; n++)
+    {
+      size_t rest = n;
+      for (size_t i = 0; i < length; i++, rest /= kAlphabetSize)
+        line[i] = kAlphabet[rest % kAlphabetSize];
+      Check(line);
+      if (HasFatalFailure())
+        return;
+    }
+  }
+  EXPECT_EQ(597871u, checked);
+}
+// check every short line inside paddings that cross the 16 and 32 byte blocks
+TEST_F(RestClientTokenizerTest, TestRestClientTokenizerBlocks)
+{
+  std::vector<std::string> prefixes;
+  prefixes.push_back("");
+  prefixes.push_back(std::string(15, ' '));
+  prefixes.push_back(std::string(31, '\t'));
+  prefixes.push_back(std::string(33, ' '));
+  prefixes.push_back("Content-Type-Of-A-Long-Name");
+
+  std::vector<std::string> suffixes;
+  suffixes.push_back("");
+  suffixes.push_back("\r\n");
+  suffixes.push_back(std::string(17, ' ') + "\r\n");
+  suffixes.push_back(std::string(30, '\f'));
+  suffixes.push_back(std::string(40, 'x') + "\r\n");
+
+  std::string core;
+  for (size_t length = 0; length <= 4; length++)
+  {
+    size_t combinations = 1;
+    for (size_t i = 0; i < length; i++)
+      combinations *= kAlphabetSize;
+    core.resize(length);
+    for (size_t n = 0; n < combinations; n++)
+    {
+      size_t rest = n;
+      for (size_t i = 0; i < length; i++, rest /= kAlphabetSize)
+        core[i] = kAlphabet[rest % kAlphabetSize];
+      for (size_t p = 0; p < prefixes.size(); p++)
+        for (size_t s = 0; s < suffixes.size(); s++)
+        {
+          Check(prefixes[p] + core + suffixes[s]);
+          if (HasFatalFailure())
+            return;
+        }
+    }
+  }
+}
+// check long random lines with few non-whitespace bytes
+TEST_F(RestClientTokenizerTest, TestRestClientTokenizerRandom)
+{
+  unsigned int state = 12345;
+  std::string line;
+  for (int n = 0; n < 20000; n++)
+  {
+    state = state * 1103515245u + 12345u;
+    line.resize((state >> 8) % 100);
+    for (size_t i = 0; i < line.size(); i++)
+    {
+      state = state * 1103515245u + 12345u;
+      unsigned int pick = (state >> 8) % 64;
+      line[i] = pick < kAlphabetSize ? kAlphabet[pick] : (pick < 48 ? ' ' : '\r');
+    }
+    Check(line);
+    if (HasFatalFailure())
+      return;
+  }
+}
+TEST_F(RestClientTokenizerTest, TestRestClientTokenizerHeaderLine)
+{
+  RestClientHeaders::Field field;
+  std::string line = "Content-Type:   application/json; charset=utf-8 \r\n";
+  ASSERT_TRUE(RestClientHeaders::Tokenize(line.data(), line.size(), field));
+  EXPECT_EQ("Content-Type", std::string(field.name, field.nameLength));
+  EXPECT_EQ("application/json; charset=utf-8", std::string(field.value, field.valueLength));
+  line = "Location: http://example.com:8080/\r\n";
+  ASSERT_TRUE(RestClientHeaders::Tokenize(line.data(), line.size(), field));
+  EXPECT_EQ("Location", std::string(field.name, field.nameLength));
+  EXPECT_EQ("http://example.com:8080/", std::string(field.value, field.valueLength));
+}
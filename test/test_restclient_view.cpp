@@ -0,0 +1,129 @@
+#include "restclient-cpp/restclient.h"
+#include "alloc_counter.h"
+#include "local_server.h"
+#include <gtest/gtest.h>
+#include <future>
+#include <string>
+#include <string_view>
+
+class EchoRequestServer : public LocalServer
+{
+ protected:
+    virtual void Handle(const Request& request, Response& response)
+    {
+      std::map<std::string, std::string>::const_iterator token = request.headers.find("x-token");
+      std::map<std::string, std::string>::const_iterator agent = request.headers.find("user-agent");
+      response.body = request.method + " " + request.path + " " +
+                      (token == request.headers.end() ? "-" : token->second) + " " +
+                      (agent == request.headers.end() ? "-" : agent->second) + " " +
+                      std::to_string(request.body.size());
+    }
+};
+
+class PromiseCallback : public RestClientCompletionCallback
+{
+ public:
+    std::promise<RestClient::Response> done;
+
+    virtual void OnComplete(RestClient::Response& response)
+    {
+      done.set_value(std::move(response));
+    }
+};
+
+class RestClientViewTest : public ::testing::Test
+{
+ protected:
+    EchoRequestServer server;
+    std::string       buffer;  // URL followed by unrelated bytes, views are not NUL terminated
+    std::string_view  url;
+
+    RestClientViewTest()
+    {
+    }
+
+    virtual ~RestClientViewTest()
+    {
+    }
+
+    virtual void SetUp()
+    {
+      ASSERT_TRUE(server.Start());
+      std::string target = server.Url("/view");
+      buffer = target + "/not-part-of-the-url";
+      url = std::string_view(buffer).substr(0, target.size());
+      RestClient::Get(url);
+    }
+
+    virtual void TearDown()
+    {
+      server.Stop();
+    }
+};
+
+// Tests
+// check URL and headers are read from the views
+TEST_F(RestClientViewTest, TestRestClientViewGet)
+{
+  std::string_view values("secret;agent/1.0");
+  RestClient::Response res = RestClient::Get(url, {RestClient::Header("X-Token", values.substr(0, 6)),
+                                                   RestClient::Header("user-agent", values.substr(7))});
+  EXPECT_EQ(200, res.code);
+  EXPECT_EQ("GET /view secret agent/1.0 0", res.BodyView());
+  EXPECT_EQ(res.body.data(), res.BodyView().data());
+}
+// check the session user agent and default headers still apply
+TEST_F(RestClientViewTest, TestRestClientViewSession)
+{
+  RestClientSession session;
+  RestClient::headermap defaults;
+  defaults["X-Token"] = "default";
+  session.SetDefaultHeaders(defaults);
+  EXPECT_EQ("GET /view default restclient-cpp-mfr/" VERSION " 0", session.Get(url).BodyView());
+  EXPECT_EQ("GET /view mine restclient-cpp-mfr/" VERSION " 0", session.Get(url, {RestClient::Header("x-token", "mine")}).BodyView());
+}
+// check form items are posted from the views
+TEST_F(RestClientViewTest, TestRestClientViewPost)
+{
+  std::string_view field("name=value");
+  RestClient::Response res = RestClient::Post(url, {}, {RestClient::Form(field.substr(0, 4), field.substr(5))});
+  EXPECT_EQ(200, res.code);
+  EXPECT_EQ(0u, res.body.find("POST /view - "));
+  EXPECT_NE("0", res.body.substr(res.body.rfind(' ') + 1));
+}
+// check the views may go away once an asynchronous call returns
+TEST_F(RestClientViewTest, TestRestClientViewAsync)
+{
+  PromiseCallback callback;
+  std::future<RestClient::Response> future = callback.done.get_future();
+  {
+    std::string scratch(buffer);
+    std::string token("async");
+    ASSERT_TRUE(RestClient::GetAsync(std::string_view(scratch).substr(0, url.size()), {RestClient::Header("X-Token", token)}, &callback));
+    scratch.assign(scratch.size(), 'x');
+    token.assign("xxxxx");
+  }
+  EXPECT_EQ("GET /view async restclient-cpp-mfr/" VERSION " 0", future.get().body);
+}
+// check the view API allocates less than building a Request
+TEST_F(RestClientViewTest, TestRestClientViewAllocations)
+{
+  std::string token("a-token-long-enough-to-leave-the-small-string-buffer");
+  unsigned long viewAllocations = 0;
+  unsigned long requestAllocations = 0;
+  {
+    AllocCounter counter;
+    RestClient::Response res = RestClient::Get(url, {RestClient::Header("X-Token", token)});
+    viewAllocations = counter.Count();
+  }
+  {
+    AllocCounter counter;
+    RestClient::Request request;
+    request.url = std::string(url);
+    request.headers["X-Token"] = token;
+    RestClient::Response res = RestClient::Get(request);
+    requestAllocations = counter.Count();
+  }
+  // url, map node and header value
+  EXPECT_LE(viewAllocations + 3, requestAllocations);
+}